@@ -16,6 +16,12 @@ import ctypes
 from ctypes import CDLL
 from ctypes import c_char_p
 from ctypes import c_int
+from ctypes import c_void_p
+from ctypes import c_size_t
+from ctypes import c_ulong
+from ctypes import c_char
+from ctypes import Structure
+from ctypes import POINTER
 
 
 
@@ -26,12 +32,88 @@ lib = CDLL(lib_path)
 
 
 #set the arguement and return types of the wrapper function
+#getCardSummary returns a string we own, so it comes back as a raw pointer that can be given back to freeCardString.
+#c_char_p would copy it into a python string and lose the pointer
 lib.getCardSummary.argtypes = [c_char_p]
-lib.getCardSummary.restype = c_char_p
+lib.getCardSummary.restype = c_void_p
+
+lib.freeCardString.argtypes = [c_void_p]
+lib.freeCardString.restype = None
 
 lib.updateCard.argtypes = [c_char_p, c_char_p]
 lib.updateCard.restype = c_int
 
+#must match CARD_FIELD_LENGTH and struct cardFields in vcwrapper.c
+CARD_FIELD_LENGTH = 256
+
+class CardFields(Structure):
+    _fields_ = [("error", c_int),
+                ("otherCount", c_int),
+                ("truncated", c_int),
+                ("fn", c_char * CARD_FIELD_LENGTH),
+                ("birthday", c_char * CARD_FIELD_LENGTH),
+                ("anniversary", c_char * CARD_FIELD_LENGTH)]
+
+lib.getCardFields.argtypes = [c_char_p, POINTER(CardFields)]
+lib.getCardFields.restype = c_int
+
+#batch versions take arrays and a thread count, 0 means one thread per CPU
+lib.getCardFieldsBatch.argtypes = [POINTER(c_char_p), c_int, POINTER(CardFields), c_int]
+lib.getCardFieldsBatch.restype = c_int
+
+lib.updateCardBatch.argtypes = [POINTER(c_char_p), POINTER(c_char_p), c_int, POINTER(c_int), c_int]
+lib.updateCardBatch.restype = c_int
+
+lib.createNewCardBatch.argtypes = [POINTER(c_char_p), POINTER(c_char_p), c_int, POINTER(c_int), c_int]
+lib.createNewCardBatch.restype = c_int
+
+#must match CardCacheStats in VCCache.h
+class CardCacheStats(Structure):
+    _fields_ = [("hits", c_ulong),
+                ("misses", c_ulong),
+                ("evictions", c_ulong),
+                ("invalidations", c_ulong),
+                ("entries", c_size_t),
+                ("memoryUsed", c_size_t),
+                ("memoryBudget", c_size_t)]
+
+lib.enableCardCache.argtypes = [c_size_t]
+lib.enableCardCache.restype = c_int
+
+lib.invalidateCardCache.argtypes = [c_char_p]
+lib.invalidateCardCache.restype = c_int
+
+lib.getCardCacheCounters.argtypes = [POINTER(CardCacheStats)]
+lib.getCardCacheCounters.restype = None
+
+#must match WatchedCard in VCWatch.h, the strings belong to the watcher
+class WatchedCard(Structure):
+    _fields_ = [("fileName", c_char_p),
+                ("fn", c_char_p),
+                ("birthday", c_char_p),
+                ("anniversary", c_char_p),
+                ("error", c_int),
+                ("otherCount", c_int)]
+
+lib.createCardWatcher.argtypes = [c_char_p, c_int, c_void_p]
+lib.createCardWatcher.restype = c_void_p
+
+lib.updateCardWatcher.argtypes = [c_void_p, c_int]
+lib.updateCardWatcher.restype = c_int
+
+lib.watchedCardCount.argtypes = [c_void_p]
+lib.watchedCardCount.restype = c_int
+
+lib.watchedCardAt.argtypes = [c_void_p, c_int]
+lib.watchedCardAt.restype = POINTER(WatchedCard)
+
+lib.deleteCardWatcher.argtypes = [c_void_p]
+lib.deleteCardWatcher.restype = None
+
+#keep parsed cards between scans so going back to the list view only re-reads files that changed
+CARD_CACHE_BUDGET = 64 * 1024 * 1024
+lib.enableCardCache(CARD_CACHE_BUDGET)
+
 
 def get_vcard_summary(filename):
 
@@ -41,11 +123,57 @@ def get_vcard_summary(filename):
     if not summary_ptr:
         return "Error: Could not get summary"
     
-    #convert the returned c string to a python string
-    summary = summary_ptr.decode('utf-8')
+    #copy the returned c string into a python string, then free the c string
+    try:
+        summary = ctypes.string_at(summary_ptr).decode('utf-8', 'replace')
+    finally:
+        lib.freeCardString(summary_ptr)
 
     return summary
 
+#returns (error, fn, birthday, anniversary, other_count) straight from the parsed card
+def get_vcard_fields(filename):
+    fields = CardFields()
+    lib.getCardFields(filename.encode('utf-8'), ctypes.byref(fields))
+    return (fields.error,
+            fields.fn.decode('utf-8', 'replace'),
+            fields.birthday.decode('utf-8', 'replace'),
+            fields.anniversary.decode('utf-8', 'replace'),
+            fields.otherCount)
+
+#returns the card cache counters as a dict
+def get_card_cache_stats():
+    stats = CardCacheStats()
+    lib.getCardCacheCounters(ctypes.byref(stats))
+    return {name: getattr(stats, name) for name, _ in CardCacheStats._fields_}
+
+#get_vcard_fields for many files in one call, returns a list of the same tuples in the same order
+def get_vcard_fields_batch(filenames):
+    count = len(filenames)
+    paths = (c_char_p * count)(*[f.encode('utf-8') for f in filenames])
+    results = (CardFields * count)()
+    lib.getCardFieldsBatch(paths, count, results, 0)
+    return [(r.error,
+             r.fn.decode('utf-8', 'replace'),
+             r.birthday.decode('utf-8', 'replace'),
+             r.anniversary.decode('utf-8', 'replace'),
+             r.otherCount) for r in results]
+
+#runs one of the C batch writers over (filename, fn) pairs, returns the error code for each
+def _run_card_batch(function, pairs):
+    count = len(pairs)
+    paths = (c_char_p * count)(*[p[0].encode('utf-8') for p in pairs])
+    values = (c_char_p * count)(*[p[1].encode('utf-8') for p in pairs])
+    errors = (c_int * count)()
+    function(paths, values, count, errors, 0)
+    return list(errors)
+
+def update_vcards(pairs):
+    return _run_card_batch(lib.updateCardBatch, pairs)
+
+def create_new_cards(pairs):
+    return _run_card_batch(lib.createNewCardBatch, pairs)
+
 def update_vcard(filename, new_fn):
     return lib.updateCard(filename.encode('utf-8'), new_fn.encode('utf-8'))
 
@@ -162,61 +290,6 @@ def run_display_all_contacts(conn):
 
 
 #-------------------HELPER-------------------
-def parse_vcard_summary_for_main_fields(summary):
-    
-    lines = summary.splitlines()
-    fn = ""
-    birthday = ""
-    anniversary = ""
-
-    found_fn_block = False
-    found_bday_block = False
-    found_anniv_block = False
-
-    for line in lines:
-        line = line.strip()
-        if line.startswith("Full Name:"):
-            found_fn_block = True
-            continue
-        
-        if found_fn_block:
-            #watch for lines starting with "- "
-            if line.startswith("- "):
-                fn = line[1:].strip()
-                found_fn_block = False
-            if line == "" or line.startswith("---Optional"):
-                found_fn_block = False
-        
-        if line.startswith("Birthday:"):
-            found_bday_block = True
-            continue
-        
-        if found_bday_block:
-            if line.strip() and not line.startswith("---"):
-                birthday = line.strip()
-            found_bday_block = False
-        
-        if line.startswith("Anniversary:"):
-            found_anniv_block = True
-            continue
-        
-        if found_anniv_block:
-            if line.strip() and not line.startswith("---"):
-                anniversary = line.strip()
-            found_anniv_block = False
-
-    #convert null placeholders to empty strings
-    if birthday == "NULL":
-        birthday = ""
-    
-    if anniversary == "NULL":
-        anniversary = ""
-    
-    return fn, birthday, anniversary
-
-
-
-
 #helper to parse date time to make the output look like the assignment instructions.
 def format_datetime_for_display(raw_dt):
     #maybe partial or text based
@@ -243,13 +316,11 @@ def format_datetime_for_display(raw_dt):
 #helper to populate the DB from the cards
 def populate_db_from_cards(conn, folder):
     all_files = [f for f in os.listdir(folder) if f.endswith((".vcf", ".vcard"))]
-    for f in all_files:
+    #parse every file in one call
+    all_fields = get_vcard_fields_batch([os.path.join(folder, f) for f in all_files])
+    for f, (error, fn, bday, anniv, _) in zip(all_files, all_fields):
         full_path = os.path.join(folder, f)
-        #get summary
-        summary = get_vcard_summary(full_path)
-        #parse out the fields
-        fn, bday, anniv = parse_vcard_summary_for_main_fields(summary)
-        if not fn:
+        if error != 0 or not fn:
             print(f"Error: Could not parse name from {f}")
             continue
         #insert into FILE
@@ -272,24 +343,45 @@ def populate_db_from_cards(conn, folder):
 class VCardModel():
     def __init__(self, folder="cards"):
         self.folder = folder
+        #the watcher keeps an index of the folder up to date, so a scan only re-reads files that changed
+        self.watcher = None
+        if os.path.isdir(self.folder):
+            self.watcher = lib.createCardWatcher(self.folder.encode('utf-8'), 0, None)
         self.valid_files = self.scan_cards()
         self.current_filename = None #store current file name
     
     def scan_cards(self):
         valid_files = []
+
+        if self.watcher:
+            #only check for changes, never wait
+            if lib.updateCardWatcher(self.watcher, 0) >= 0:
+                #the index is in no particular order, so sort it by file name like the listing below
+                cards = [lib.watchedCardAt(self.watcher, i).contents for i in range(lib.watchedCardCount(self.watcher))]
+                for card in sorted(cards, key=lambda card: card.fileName):
+                    file = card.fileName.decode('utf-8', 'replace')
+                    if card.error == 0:
+                        valid_files.append(file)
+                    else:
+                        print(f"Error: Could not read {file}")
+                return valid_files
+
+            #the folder has gone, fall back to listing it
+            lib.deleteCardWatcher(self.watcher)
+            self.watcher = None
+
         if not os.path.isdir(self.folder):
             return valid_files
         
-        for file in os.listdir(self.folder):
-            if file.endswith((".vcf", ".vcard")):
-                full_path = os.path.join(self.folder, file)
-                summary = get_vcard_summary(full_path)
-
-                #only add the file if the summary does not contain an error
-                if not summary.startswith("Error:"):
-                    valid_files.append(file)
-                else:
-                    print(f"Error: Could not read {file}")
+        #sorted the same way as the watcher's index, so the order does not depend on which one is used
+        files = sorted(f for f in os.listdir(self.folder) if f.endswith((".vcf", ".vcard")))
+        all_fields = get_vcard_fields_batch([os.path.join(self.folder, f) for f in files])
+        for file, fields in zip(files, all_fields):
+            #only add the file if it parsed
+            if fields[0] == 0:
+                valid_files.append(file)
+            else:
+                print(f"Error: Could not read {file}")
         return valid_files
 
     def get_summary(self):
@@ -436,96 +528,13 @@ class DetailsView(Frame):
         else:
             #editing an existing vcard
             full_path = os.path.join(self._model.folder, self._model.current_filename)
-            summary = get_vcard_summary(full_path)
-
-            #parse the summary string
-            fn = ""
-            birthday = ""
-            anniversary = ""
-            other_count = "0"
-
-            #parser the lines of cardtostring
-            lines = summary.splitlines()
-
-            #parse the lines
-            found_fn_block = False
-            found_bday_block = False
-            found_anniv_block = False
-            found_other_block = False
-            other_count_int = 0
-
-
-            for i, line in enumerate(lines):
-                line = line.strip()
-
-                #attempt to parse the block after FN:
-                if line.startswith("Full Name:"):
-                    #next lines might contain name or values
-                    found_fn_block = True
-                    continue
-                
-                if found_fn_block:
-                    #parse the name
-                    if line.startswith("Name: ") or line.startswith("Parameters:"):
-                        continue
-                    elif line.startswith("Values:"):
-                        #next line might be the name
-                        continue
-                    elif line.startswith("- "):
-                        fn = line[1:].strip()
-                        found_fn_block = False
-                    if line == "" or line.startswith("---Optional Properties---"):
-                        found_fn_block = False
-                
-                #attempt to parse the block after BDAY:
-                if line.startswith("Birthday:"):
-                    #next lines might contain name or values
-                    found_bday_block = True
-                    continue
-                
-                if found_bday_block:
-                    if line.strip() and not line.startswith("---"):
-                        birthday = line.strip()
-                    found_bday_block = False
-                
-                #attempt to parse the block after ANNIVERSARY:
-                if line.startswith("Anniversary:"):
-                    #next lines might contain name or values
-                    found_anniv_block = True
-                    continue
-                
-                if found_anniv_block:
-                    if line.strip() and not line.startswith("---"):
-                        anniversary = line.strip()
-                    found_anniv_block = False
-                
-                #attempt to parse the block after OTHER:
-                if line.startswith("---Optional Properties---"):
-                    #next lines might contain name or values
-                    found_other_block = True
-                    continue
-                
-                if found_other_block:
-                    #keep going until see bday or anniv or end
-                    if line.startswith("Birthday:") or line.startswith("Anniversary:") or line.startswith("---End of Card---"):
-                        found_other_block = False
-                    else:
-                        if line.startswith("Name: "):
-                            other_count_int += 1
-                
+            _, fn, birthday, anniversary, other_count_int = get_vcard_fields(full_path)
             other_count = str(other_count_int)
 
             #parse into format
             birthday = format_datetime_for_display(birthday)
             anniversary = format_datetime_for_display(anniversary)
 
-            #if bday and anniv were null
-            if birthday == "NULL":
-                birthday = ""
-            if anniversary == "NULL":  
-                anniversary = ""
-                        
-                    
             #set the fields
             self.data = {
                 "filename": self._model.current_filename,
@@ -24,6 +24,23 @@ typedef struct listNode{
     struct listNode* next;
 } Node;
 
+/**
+ * Optional allocator for a list's Node structs and the List struct itself.
+ * alloc and release are called with context as their first argument.  A list with no
+ * allocator uses malloc and free.
+ * releaseChain may be NULL.  If it is set, clearList hands it every node of the list at once,
+ * still joined through their next pointers from first to last, instead of releasing them one by one.
+ * maxBlock is the largest size alloc serves, or 0 if it serves any size.  Lists only ever ask for
+ * a Node or a List, but other containers that take an allocator check it.
+ **/
+typedef struct listAllocator{
+    void* (*alloc)(void* context, size_t size);
+    void (*release)(void* context, void* block);
+    void* context;
+    void (*releaseChain)(void* context, Node* first, Node* last);
+    size_t maxBlock;
+} ListAllocator;
+
 /**
  * Metadata head of the list. 
  * Contains no actual data but contains
@@ -37,6 +54,9 @@ typedef struct listHead{
     void (*deleteData)(void* toBeDeleted);
     int (*compare)(const void* first,const void* second);
     char* (*printData)(void* toBePrinted);
+    ListAllocator* allocator;
+    //bumped by every function below that adds, removes or reorders nodes, so a cache built from the list can tell it has changed
+    unsigned int changes;
 } List;
 
 
@@ -63,6 +83,19 @@ typedef struct iter{
 List* initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
 
 
+/** Function to initialize a list whose List and Node structs come from the given allocator instead of malloc.
+* Otherwise identical to initializeList.
+*@pre function pointer arguments must not be NULL.  The allocator must outlive the list.
+*@post List structure has been allocated from the allocator and initialized
+*@return On success returns newly allocated List struct. Returns NULL if allocation fails
+*@param printFunction - function pointer to print a single node of the list
+*@param deleteFunction - function pointer to delete a single piece of data from the list
+*@param compareFunction - function pointer to compare two nodes of the list in order to test for equality or order
+*@param allocator - allocator for the list's memory, or NULL to use malloc
+**/
+List* initializeListWithAllocator(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListAllocator* allocator);
+
+
 
 /**Function for creating a node for the linked list. 
 * This node contains abstracted (void *) data as well as previous and next
@@ -125,6 +158,14 @@ void clearList(List* list);
 **/
 void insertSorted(List* list, void* toBeAdded);
 
+/** Sorts the whole list with its comparison function, keeping elements that compare equal in the order they were in.
+* Runs in O(n log n) by relinking the existing nodes, so nothing is allocated.
+*@pre List exists and has memory allocated to it
+*@post The list is in ascending order
+*@param list - a pointer to the List struct
+**/
+void sortList(List* list);
+
 
 
 /** Removes data from from the list, deletes the node and frees the memory,
@@ -0,0 +1,52 @@
+/**
+ * @file NodePool.h
+ * @brief Pooled allocator for the Node and List structs of LinkedListAPI lists
+ */
+
+#ifndef _NODE_POOL_
+#define _NODE_POOL_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "LinkedListAPI.h"
+
+/**
+ * Pool of fixed size blocks, each big enough for a Node or a List, carved out of large slabs.
+ * Every thread that uses a pool gets its own cache of free blocks and its own slab to carve from,
+ * so allocating and releasing rarely takes a lock.  A block released on one thread goes to that
+ * thread's cache, whichever thread it came from.  A cache that holds too many free blocks hands
+ * the extra to a list shared by the pool, and a thread takes from that list before carving a new
+ * slab, so blocks allocated on one thread and released on another are reused.  Lists made with
+ * the pool's allocator give all their nodes back in one step when they are cleared or freed.
+ * The layout is private to NodePool.c
+ **/
+typedef struct nodePool NodePool;
+
+
+/** Function to create an empty pool.
+*@return the new pool, or NULL if allocation fails.  It must be freed with deleteNodePool
+**/
+NodePool* createNodePool(void);
+
+/** Function to get the allocator to pass to initializeListWithAllocator for lists that use the pool.
+* It serves blocks no bigger than a List, so it is only meant for lists.
+*@return the allocator, which lives as long as the pool
+*@param pool - the pool
+**/
+ListAllocator* nodePoolAllocator(NodePool* pool);
+
+/** Function to get how many blocks of a pool are handed out and not yet released.
+* The count is only exact while no other thread is using the pool.
+*@return the number of blocks in use
+*@param pool - the pool
+**/
+size_t nodePoolBlocksInUse(NodePool* pool);
+
+/** Function to free a pool and all of its slabs.
+*@pre every list using the pool has been freed, and no thread is still using it
+*@param pool - the pool, may be NULL
+**/
+void deleteNodePool(NodePool* pool);
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * @file SmallVectorAPI.h
+ * @brief File containing the function definitions of a contiguous vector with inline storage for small sizes
+ */
+
+#ifndef _SMALL_VECTOR_API_
+#define _SMALL_VECTOR_API_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "LinkedListAPI.h"
+
+/**
+ * Number of elements a vector holds inside its own struct before it moves them to a separate block.
+ * Most cards have one to four values, parameters or properties of any one name.
+ **/
+#define SMALL_VECTOR_INLINE 4
+
+/**
+ * Vector of pointers stored back to back.  It takes the same print, delete and compare functions as a List,
+ * so code can move from one to the other, but elements are reached by index with no Node per element.
+ * The struct is meant to be embedded in another struct or on the stack, and can be copied or moved
+ * with memcpy, since elements held inline are not pointed to from anywhere else.
+ * It holds the matches of the per-card property index in VCIndex.c.  The Card, Property and Parameter
+ * structs keep their List fields, since their layout is the public one in VCParser.h that callers such
+ * as vcwrapper.c walk node by node, so the parser, validateCard and writeCard still work on Lists.
+ * Holding values or parameters in a vector as well would mean two copies kept in step by every caller
+ * that edits the lists, which is the job the index already does for lookups by name.
+ **/
+typedef struct smallVector{
+    int length;
+    int capacity;
+    union {
+        void* inlineData[SMALL_VECTOR_INLINE];
+        void** heapData;
+    } storage;
+    void (*deleteData)(void* toBeDeleted);
+    int (*compare)(const void* first,const void* second);
+    char* (*printData)(void* toBePrinted);
+    ListAllocator* allocator;
+} SmallVector;
+
+
+/** Function to set up an empty vector.
+*@pre vector must not be NULL.  The allocator, if given, must outlive the vector
+*@post vector is empty and uses its inline storage
+*@param vector - the vector to set up
+*@param printFunction - function pointer to print a single element
+*@param deleteFunction - function pointer to delete a single element
+*@param compareFunction - function pointer to compare two elements
+*@param allocator - where storage past the inline elements comes from, or NULL for malloc.  An allocator
+*                   with a maxBlock, like a NodePool's, is passed over for malloc
+**/
+void initializeVector(SmallVector* vector, char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListAllocator* allocator);
+
+/** Function to add an element to the end of a vector, moving the elements to a bigger block if they do not fit.
+*@return false if the vector could not grow, in which case it is unchanged
+*@param vector - the vector
+*@param toBeAdded - the element
+**/
+bool vectorPushBack(SmallVector* vector, void* toBeAdded);
+
+/** Function to get an element by its position.
+*@return the element, or NULL if index is out of range
+*@param vector - the vector
+*@param index - position from 0
+**/
+void* vectorGet(const SmallVector* vector, int index);
+
+/** Function to get the elements as an array, for loops that walk the whole vector.
+*@return the first of vectorLength elements.  It is only valid until the vector next changes
+*@param vector - the vector
+**/
+void** vectorData(SmallVector* vector);
+
+/** Function to get the number of elements in a vector.
+*@return the number of elements, 0 for a NULL vector
+*@param vector - the vector
+**/
+int vectorLength(const SmallVector* vector);
+
+/** Function to take an element out of a vector, keeping the rest in order.  The element is not deleted.
+*@return the element, or NULL if index is out of range
+*@param vector - the vector
+*@param index - position from 0
+**/
+void* vectorRemoveAt(SmallVector* vector, int index);
+
+/** Function to find the first element that matches a record, like findElement does for a List.
+*@return the element, or NULL if none match
+*@param vector - the vector
+*@param customCompare - returns true when its arguments match
+*@param searchRecord - passed as the second argument of customCompare
+**/
+void* findInVector(const SmallVector* vector, bool (*customCompare)(const void* first,const void* second), const void* searchRecord);
+
+/** Function to describe every element with the vector's print function, like toString does for a List.
+*@return a new string that the caller must free
+*@param vector - the vector
+**/
+char* vectorToString(const SmallVector* vector);
+
+/** Function to delete every element, keeping the storage for reuse.
+*@param vector - the vector
+**/
+void clearVector(SmallVector* vector);
+
+/** Function to delete every element and free any storage outside the vector struct.
+* The vector is left empty and can be used again.
+*@param vector - the vector, may be NULL
+**/
+void releaseVector(SmallVector* vector);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef STRINGBUILDER_H
+#define STRINGBUILDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+    Growable string for building output a piece at a time.  Appends are amortized O(1), and a builder that
+    is given its final size up front never reallocates.  If allocation fails the builder remembers it,
+    later appends do nothing, and builderTakeString returns NULL, so callers only check once at the end.
+*/
+typedef struct stringBuilder {
+    char * data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+    bool fixed;
+} StringBuilder;
+
+
+//sets up an empty builder with room for capacity characters plus the terminator
+void initializeStringBuilder(StringBuilder * builder, size_t capacity);
+
+//sets up an empty builder over memory owned by the caller, holding up to size - 1 characters.
+//It never reallocates or frees the memory, running out of room just marks the builder failed
+void initializeFixedStringBuilder(StringBuilder * builder, char * buffer, size_t size);
+
+//makes sure there is room for extra more characters
+bool builderReserve(StringBuilder * builder, size_t extra);
+
+void builderAppend(StringBuilder * builder, const char * str);
+void builderAppendN(StringBuilder * builder, const char * str, size_t length);
+void builderAppendChar(StringBuilder * builder, char c);
+
+//hands the NUL terminated string to the caller, who must free it.  NULL if anything failed.  Not for fixed builders.
+//Either way the builder must be set up again before it is reused
+char * builderTakeString(StringBuilder * builder);
+
+//frees whatever the builder still holds, apart from the memory of a fixed builder
+void freeStringBuilder(StringBuilder * builder);
+
+
+#endif
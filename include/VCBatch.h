@@ -0,0 +1,102 @@
+#ifndef VCBATCH_H
+#define VCBATCH_H
+
+#include <stdbool.h>
+#include "VCParser.h"
+
+/*
+    Batch parsing of many card files at once on a work-stealing thread pool, and batch writing of many
+    cards into one file.
+*/
+
+//Result for one file of a batch
+typedef struct batchResult {
+	//Path of the file.  Owned by the batch.
+	char*			fileName;
+
+	//Error from parsing the file, as createCard would return it
+	VCardErrorCode	error;
+
+	//Line the error was found on, 0 if it was not tied to a line
+	int				errorLine;
+
+	//The parsed card, owned by the batch.  NULL unless error is OK
+	Card*			card;
+
+} BatchResult;
+
+//Results for a whole batch, in the same order as the files were given
+typedef struct cardBatch {
+	BatchResult*	results;
+	int				count;
+} CardBatch;
+
+
+/** Function to run work(arg, index, worker) for every index from 0 to count - 1 on a pool of threads.
+ * Each thread starts with an even share of the indexes and steals from the others once its own run out.
+ * worker is the number of the thread running the call, from 0 to threads - 1.
+ *@param count - number of work items
+ *@param threads - threads to use, or 0 or less for one per CPU
+ *@param work - function to run for each item
+ *@param arg - passed through to work
+ *@return the number of threads actually used
+ **/
+int runWorkStealing(int count, int threads, void (*work)(void* arg, int index, int worker), void* arg);
+
+/** Function to parse every file in a list, in parallel.
+ *@pre fileNames holds count paths
+ *@post on success batch points to a new CardBatch that must be freed with deleteCardBatch
+ *@return OK if the batch ran, even if some files failed to parse, or OTHER_ERROR if allocation failed
+ *@param fileNames - paths of the files to parse
+		 count - number of paths
+		 threads - threads to use, or 0 or less for one per CPU
+		 options - context whose options, such as useArena, apply to every file.  May be NULL
+		 batch - set to the results
+ **/
+VCardErrorCode parseCardFiles(const char* const* fileNames, int count, int threads, const VCardContext* options, CardBatch** batch);
+
+/** Function to parse every .vcf and .vcard file in a directory, in parallel.  Results are sorted by file name.
+ *@post on success batch points to a new CardBatch that must be freed with deleteCardBatch
+ *@return OK if the batch ran, INV_FILE if the directory cannot be read, or OTHER_ERROR if allocation failed
+ *@param dirName - the directory to scan
+		 threads - threads to use, or 0 or less for one per CPU
+		 options - context whose options apply to every file.  May be NULL
+		 batch - set to the results
+ **/
+VCardErrorCode parseCardDirectory(const char* dirName, int threads, const VCardContext* options, CardBatch** batch);
+
+/** Function to write many cards back to back into one vCard file.  The text goes out through a large buffer,
+ * so a whole export takes one open and a few large writes.  With more than one thread the cards are
+ * serialized in parallel, a chunk at a time, and still written in order.
+ *@pre cards holds count cards, none of them NULL
+ *@post the cards have not been modified in any way
+ *@return OK, or WRITE_ERROR if fileName is not a card file or could not be written, or OTHER_ERROR if allocation failed
+ *@param fileName - the file to write
+		 cards - the cards to write, in order
+		 count - number of cards
+		 threads - threads to serialize with, 1 for the calling thread only, or 0 or less for one per CPU
+		 options - context whose atomicWrite option applies to the file.  May be NULL
+ **/
+VCardErrorCode writeCardFileBatch(const char* fileName, const Card* const* cards, int count, int threads, const VCardContext* options);
+
+/** Function to write a stream of cards back to back into one vCard file, like writeCardFileBatch.
+ * nextCard is only ever called on the calling thread, and a card it returns must stay valid until the
+ * following call returns or the write finishes.  Each card is serialized on the calling thread before the
+ * next one is asked for, so nextCard may free or reuse the previous card; to serialize in parallel, collect
+ * the cards into an array and use writeCardFileBatch.
+ *@return OK, or WRITE_ERROR if fileName is not a card file or could not be written, or OTHER_ERROR if allocation failed
+ *@param fileName - the file to write
+		 nextCard - returns the next card to write, or NULL when there are no more
+		 data - passed through to nextCard
+		 threads - ignored, since a stream is always serialized on the calling thread
+		 options - context whose atomicWrite option applies to the file.  May be NULL
+ **/
+VCardErrorCode writeCardStream(const char* fileName, const Card* (*nextCard)(void* data), void* data, int threads, const VCardContext* options);
+
+/** Function to free a batch and every card in it.
+ *@param batch - the batch to free, may be NULL
+ **/
+void deleteCardBatch(CardBatch* batch);
+
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef VCCACHE_H
+#define VCCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "VCParser.h"
+
+/*
+    Cache of parsed cards, so a file that has not changed on disk is not parsed again.  Entries are keyed by
+    path and checked against the file's inode, size and modification time on every lookup.  The least recently
+    used entries are evicted once the cards held go over a memory budget.  All calls are thread safe.
+*/
+
+typedef struct vCardCache VCardCache;
+
+//A card handed out by the cache.  The layout is private to VCCache.c
+typedef struct cachedCard CachedCard;
+
+//Counters for a cache, see getCardCacheStats
+typedef struct cardCacheStats {
+	//lookups answered from the cache, and lookups that had to parse the file
+	unsigned long	hits;
+	unsigned long	misses;
+
+	//entries dropped to stay in budget, and entries dropped by invalidation or because the file changed
+	unsigned long	evictions;
+	unsigned long	invalidations;
+
+	//entries held now, and the memory their cards use
+	size_t			entries;
+	size_t			memoryUsed;
+	size_t			memoryBudget;
+} CardCacheStats;
+
+
+/** Function to create an empty cache.
+ *@return the new cache, or NULL if allocation fails.  It must be freed with deleteCardCache
+ *@param memoryBudget - bytes of parsed cards to keep before evicting the least recently used
+		 options - context whose options apply to every card parsed.  May be NULL.  Cards are always
+		 parsed into an arena so that their memory can be measured
+ **/
+VCardCache* createCardCache(size_t memoryBudget, const VCardContext* options);
+
+/** Function to get a card from the cache, parsing the file if it is not cached or has changed.
+ * Files that fail to parse are cached too, so the error comes back without parsing them again.
+ *@post on success entry points to a handle that must be given back with releaseCachedCard.  The card
+		stays valid until then, even if it is evicted or the file changes in the meantime
+ *@return the error code createCard gives for the file
+ *@param cache - the cache
+		 fileName - the file to read
+		 entry - set to the handle, or NULL if the file did not parse
+ **/
+VCardErrorCode getCachedCard(VCardCache* cache, const char* fileName, CachedCard** entry);
+
+/** Function to get the card behind a handle.  The card belongs to the cache and must not be changed.
+ *@param entry - a handle from getCachedCard
+ **/
+const Card* cachedCardOf(const CachedCard* entry);
+
+/** Function to give back a handle from getCachedCard.
+ *@param cache - the cache the handle came from
+		 entry - the handle, may be NULL
+ **/
+void releaseCachedCard(VCardCache* cache, CachedCard* entry);
+
+/** Function to drop the entry for a file, so the next lookup parses it again.
+ *@return true if the file was cached
+ *@param cache - the cache
+		 fileName - the file, spelled the same way it was looked up
+ **/
+bool invalidateCachedCard(VCardCache* cache, const char* fileName);
+
+/** Function to drop every entry.  Handles still held stay valid until they are released.
+ *@param cache - the cache
+ **/
+void clearCardCache(VCardCache* cache);
+
+/** Function to change the memory budget, evicting entries if the cache is now over it.
+ *@param cache - the cache
+		 memoryBudget - the new budget in bytes
+ **/
+void setCardCacheBudget(VCardCache* cache, size_t memoryBudget);
+
+/** Function to read the counters of a cache.
+ *@param cache - the cache
+		 stats - filled in with the counters
+ **/
+void getCardCacheStats(VCardCache* cache, CardCacheStats* stats);
+
+/** Function to free a cache and every card in it.
+ *@pre every handle has been released
+ *@param cache - the cache, may be NULL
+ **/
+void deleteCardCache(VCardCache* cache);
+
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef VCEVENTS_H
+#define VCEVENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "VCParser.h"
+
+/*
+    Event driven parsing.  Cards are read with the same rules as createCard, but instead of building a Card
+    each piece is handed to a callback as a span into the input, so nothing is allocated per property.
+*/
+
+//A run of characters in the input.  It is not NUL terminated and is only valid during the callback it is passed to
+typedef struct vCardSpan {
+	const char*	data;
+	size_t		length;
+} VCardSpan;
+
+typedef struct vCardParameterSpan {
+	VCardSpan	name;
+	VCardSpan	value;
+} VCardParameterSpan;
+
+/*	Callbacks for the parts of each card.  Any of them may be NULL, and returning false from one stops the parse.
+	A card starts with beginCard and then gets property for each of its properties, in order.  If the card turns
+	out to be valid it finishes with endCard, otherwise with cardError, so anything collected for it since
+	beginCard should be thrown away.  VERSION is checked but not passed to property, as createCard does not keep it.
+*/
+typedef struct vCardEvents {
+	bool (*beginCard)(void* eventData, int line);
+
+	//group is empty when the property has none.  Values are trimmed and keep any escapes
+	bool (*property)(void* eventData, const VCardSpan* group, const VCardSpan* name,
+					 const VCardParameterSpan* parameters, int parameterCount, const VCardSpan* values, int valueCount);
+
+	bool (*endCard)(void* eventData, int line);
+
+	//error is what createCard would return for the card and line is where it was found, or 0
+	bool (*cardError)(void* eventData, VCardErrorCode error, int line);
+} VCardEvents;
+
+
+/** Function to parse every card in a file as a series of events.
+ *@return INV_FILE if the file can not be opened, OTHER_ERROR if allocation fails, otherwise OK.
+ * Problems with the cards themselves go to cardError, and parsing carries on with the next card
+ *@param ctx - context whose options, such as wantedProperties, apply to the parse.  It also holds the
+		 state of the card being parsed, so each thread needs its own
+		 fileName - the file to parse
+		 events - the callbacks
+		 eventData - passed through to every callback
+ **/
+VCardErrorCode parseCardEvents(VCardContext* ctx, const char* fileName, const VCardEvents* events, void* eventData);
+
+
+#endif
@@ -6,18 +6,126 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "VCParser.h"
+#include "StringBuilder.h"
 
-//for the global error code to work properly.
-extern VCardErrorCode globalError;
+//bytes that are appended to a piece at a time, grown as needed
+typedef struct byteBuffer {
+    char * data;
+    size_t length;
+    size_t capacity;
+} ByteBuffer;
+
+//an input file read through a window, one unfolded line at a time
+typedef struct inputBuffer {
+    int fd;
+
+    //the window: length bytes of the file read so far that are still needed, in capacity bytes of memory
+    char * data;
+    size_t length;
+    size_t capacity;
+
+    //offset in the window of the next line to read
+    size_t pos;
+
+    //size of the file when it was opened, 0 if it is not a regular file
+    size_t size;
+
+    //set once the whole file has been read, and if reading it or growing the window failed
+    bool atEnd;
+    bool failed;
+
+    //line number of the last line returned, and how many physical lines have been read so far
+    int lineNumber;
+    int linesRead;
+
+    //offset of the end of the line at pos when it has already been found, or (size_t)-1
+    size_t nextLineEnd;
+
+    //scratch space that folded lines are joined into
+    ByteBuffer join;
+} InputBuffer;
+
+//a file cards are being written to.  An atomic file is written under a temporary name next to the
+//real one and only renamed over it when it is closed
+typedef struct outputFile {
+    int fd;
+    const char * fileName;
+    char * tempName;
+} OutputFile;
+
+//a block of arena memory, handed out front to back
+typedef struct arenaBlock {
+    struct arenaBlock * next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} ArenaBlock;
+
+//bump allocator for one card, freed in one go by deleteCard
+struct cardArena {
+    ArenaBlock * blocks;
+    size_t nextBlockSize;
+
+    //lets the card's lists take their Node and List structs from the arena
+    ListAllocator listAllocator;
+};
+
+typedef enum lineResult { LINE_OK, LINE_EOF, LINE_BAD_ENDING, LINE_NO_MEMORY } LineResult;
+
+//what an unfolded line is to the card around it
+typedef enum cardLineKind { CARD_LINE_BEGIN, CARD_LINE_END, CARD_LINE_PROPERTY, CARD_LINE_OUTSIDE, CARD_LINE_INVALID } CardLineKind;
+
+//receives the pieces of a property line as spans into the line.  Each returns false if it runs out of memory
+typedef struct lineSink {
+    //called first, once the group and name are known.  The group is empty when the line has none
+    bool (*property)(void * sinkData, const char * group, size_t groupLength, const char * name, size_t nameLength);
+    bool (*parameter)(void * sinkData, const char * name, size_t nameLength, const char * value, size_t valueLength);
+    //called for every value in order, already trimmed
+    bool (*value)(void * sinkData, const char * value, size_t length);
+} LineSink;
 
 
 //helper function prototypes
 bool validFileExtension(const char* fileName);
 char* myStrDup(const char* str);
 bool validCRLF(const char * line);
-bool parseSingleVCardLine(const char * line, Card * card, bool * foundBegin, bool * foundEnd, bool * doneFlag, bool * foundVersion);
+bool parseSingleVCardLine(const char * line, size_t length, Card * card, VCardContext * ctx);
+CardLineKind cardLineKind(const char * line, size_t length, VCardContext * ctx);
+bool tokenizePropertyLine(const char * line, size_t length, VCardContext * ctx, const LineSink * sink, void * sinkData);
 char * trimWhiteSpace(const char * str);
+char * myStrNDup(const char * str, size_t length);
+void resetCardState(VCardContext * ctx);
+
+bool appendBytes(ByteBuffer * buffer, const char * data, size_t length);
+
+bool openInputBuffer(const char * fileName, InputBuffer * in);
+void closeInputBuffer(InputBuffer * in);
+LineResult nextUnfoldedLine(InputBuffer * in, const char ** line, size_t * length);
+void skipRestOfCard(InputBuffer * in);
+
+bool openOutputFile(OutputFile * out, const char * fileName, bool atomic);
+bool writeOutputFile(OutputFile * out, const char * data, size_t length);
+bool closeOutputFile(OutputFile * out, bool keep);
+
+CardArena * createArena(size_t firstBlockSize);
+void * arenaAlloc(CardArena * arena, size_t size);
+size_t arenaSize(const CardArena * arena);
+void freeArena(CardArena * arena);
+
+Card * initializeCard(CardArena * arena, ListAllocator * listAllocator);
+void * cardAlloc(Card * card, size_t size);
+char * cardStrNDup(Card * card, const char * str, size_t length);
+List * cardList(Card * card, char* (*printFunction)(void* toBePrinted), void (*deleteFunction)(void* toBeDeleted), int (*compareFunction)(const void* first, const void* second));
+void discardProperty(Card * card, Property * prop);
+void discardDate(Card * card, DateTime * date);
+
+size_t cardTextLength(const Card * obj);
+void appendCardText(StringBuilder * builder, const Card * obj);
+
+bool indexProperty(Card * card, Property * prop);
+void freeCardIndex(Card * card);
 
 
 #endif
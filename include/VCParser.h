@@ -7,6 +7,8 @@
 #include <stdlib.h>
 
 #include "LinkedListAPI.h"
+#include "NodePool.h"
+#include "SmallVectorAPI.h"
 
 typedef enum ers {OK, INV_FILE, INV_CARD, INV_PROP, INV_DT, WRITE_ERROR, OTHER_ERROR } VCardErrorCode;
 
@@ -47,6 +49,20 @@ typedef struct param {
 } Parameter;
 
 
+/*	Known property names from RFC 6350.  Each parsed Property has its name resolved to one of these once,
+	so code that dispatches on the name can compare integers.  Any other name, such as an X- extension, is PROP_OTHER
+*/
+typedef enum propertyId {
+	PROP_OTHER,
+	PROP_SOURCE, PROP_KIND, PROP_XML, PROP_FN, PROP_N, PROP_NICKNAME, PROP_PHOTO, PROP_BDAY,
+	PROP_ANNIVERSARY, PROP_GENDER, PROP_ADR, PROP_TEL, PROP_EMAIL, PROP_IMPP, PROP_LANG, PROP_TZ,
+	PROP_GEO, PROP_TITLE, PROP_ROLE, PROP_LOGO, PROP_ORG, PROP_MEMBER, PROP_RELATED, PROP_CATEGORIES,
+	PROP_NOTE, PROP_PRODID, PROP_REV, PROP_SOUND, PROP_UID, PROP_CLIENTPIDMAP, PROP_URL, PROP_VERSION,
+	PROP_KEY, PROP_FBURL, PROP_CALADRURI, PROP_CALURI,
+	PROP_ID_COUNT
+} PropertyId;
+
+
 //Represents a generic vCard property
 typedef struct prop {
 	//Property name.  Must not be empty string.  Must not be NULL.
@@ -66,9 +82,21 @@ typedef struct prop {
 	*/
 	List*		values; 
 
+	/*	Id of the name, set by the parser and createNewCard with propertyIdFromName.  Code that builds or renames
+		a Property itself should set it too.  validateCard only trusts it while it still names the property,
+		and otherwise looks the name up again
+	*/
+	PropertyId	id;
+
 } Property;
 
 
+//Region that a card and everything it owns can be allocated from, see createCardInArena
+typedef struct cardArena CardArena;
+
+//Index of a card's properties by name and group, see findPropertiesByName.  The layout is private to VCIndex.c
+typedef struct cardIndex CardIndex;
+
 //Represents an vCard object
 typedef struct vCard {
 	//We assume that version is always 4.0, so we don't need to include a field for it	
@@ -96,16 +124,80 @@ typedef struct vCard {
 	*/
 	DateTime* 	anniversary;
 
+	/*	The last three fields are read by deleteCard, so a card built by hand must come from createEmptyCard
+		rather than malloc, which would leave them unset.
+
+		Arena holding this card and everything it owns, or NULL if they were allocated one by one.
+		A card in an arena is read only, and deleteCard releases the whole arena at once.
+	*/
+	CardArena*	arena;
+
+	//Allocator the card's lists take their List and Node structs from, or NULL for malloc.  Not used for cards in an arena
+	ListAllocator*	listAllocator;
+
+	//Lookup index over fn and optionalProperties, or NULL until one is needed.  Owned by the card
+	CardIndex*	index;
 
 } Card;
 
+/*	Parser state for one call, so that cards can be parsed, validated and written on several threads at once.
+	Each thread must use its own context, set up with initializeContext.
+*/
+typedef struct vCardContext {
+	//error from the last call made with this context
+	VCardErrorCode	error;
+
+	//line of the file that a parse error was found on, 0 if the error is not tied to a line
+	int		errorLine;
+
+	//allocate parsed cards in an arena, as createCardInArena does
+	bool	useArena;
+
+	/*	When wantedCount is more than 0, only the properties named here are parsed, along with FN and VERSION.
+		Any other line is skipped as soon as its name has been read, without allocating anything, and is
+		only checked for its colon.  BEGIN, END, VERSION and FN are still required.  The names are
+		matched without case and must outlive the calls that use the context.
+	*/
+	const char* const*	wantedProperties;
+	int		wantedCount;
+
+	/*	Pool that parsed cards take the List and Node structs of their lists from, instead of malloc.
+		One pool can be shared by any number of threads and contexts.  It must outlive every card parsed with it.
+		Not used when useArena is set, since arena cards already take their lists from the arena
+	*/
+	NodePool*	nodePool;
+
+	//keep optionalProperties of parsed cards in compareProperties order, see sortCardProperties
+	bool	sortProperties;
+
+	//writeCardWithContext replaces the file with writeCardAtomic instead of writing it in place
+	bool	atomicWrite;
+
+	//state of the card being parsed
+	bool	foundBegin;
+	bool	foundEnd;
+	bool	done;
+	bool	foundVersion;
+
+} VCardContext;
+
 // ************* Card parser functions - MUST be implemented ***************
 VCardErrorCode createCard(char* fileName, Card** obj);
+VCardErrorCode createCardInArena(char* fileName, Card** obj);
 void deleteCard(Card* obj);
 char* cardToString(const Card* obj);
 char* errorToString(VCardErrorCode err);
 // *************************************************************************
 
+/** Function to create a card with no properties, for code that builds a card itself.
+ *  Cards that are not parsed must be created here, since deleteCard relies on the arena, listAllocator
+ *  and index fields that it sets.
+ *@post on success the card has fn, birthday and anniversary set to NULL and an empty optionalProperties list.
+        It must be freed with deleteCard
+ *@return the new card, or NULL if allocation fails
+ **/
+Card* createEmptyCard(void);
+
 // ************* List helper functions - MUST be implemented *************** 
 void deleteProperty(void* toBeDeleted);
 int compareProperties(const void* first,const void* second);
@@ -130,13 +222,48 @@ char* dateToString(void* date);
  *@pre Card object exists, and is not NULL.
         fileName is not NULL, has the correct extension
  *@post Card has not been modified in any way, and a file representing the
-        Card contents in vCard format has been created
+        Card contents in vCard format has been created.  Lines longer than 75 octets are folded
+        as RFC 6350 asks, never inside a UTF-8 character
  *@return the error code indicating success or the error encountered when traversing the Card
  *@param obj - a pointer to a Card struct
 		 fileName - the name of the output file
  **/
  VCardErrorCode writeCard(const char* fileName, const Card* obj);
 
+/** Function to replace a file with a Card in vCard format, so that readers never see a partly written file.
+ *@pre Card object exists, and is not NULL.
+        fileName is not NULL, has the correct extension, and its directory is writable
+ *@post Card has not been modified in any way.  fileName holds either its old contents or the whole Card,
+        even if the process or machine stops part way through
+ *@return the error code indicating success or the error encountered when writing the Card
+ *@param obj - a pointer to a Card struct
+		 fileName - the name of the output file
+ **/
+ VCardErrorCode writeCardAtomic(const char* fileName, const Card* obj);
+
+/** Function to write a Card in vCard format into memory, with the same text writeCard puts in a file.
+ *@pre Card object exists, and is not NULL.
+ *@post Card has not been modified in any way.  If buffer is big enough it holds the NUL terminated text
+ *@return OK, or WRITE_ERROR if buffer is too small.  When buffer is NULL and size is 0 nothing is written and
+         OK is returned, which gives a size only pass
+ *@param obj - a pointer to a Card struct
+		 buffer - memory owned by the caller, or NULL
+		 size - the size of buffer in bytes, which must leave room for the terminator
+		 length - if not NULL, set to the length of the text without the terminator, even when it did not fit
+ **/
+ VCardErrorCode writeCardToBuffer(const Card* obj, char* buffer, size_t size, size_t* length);
+
+/** Function to write a Card in vCard format into a string allocated by the library.
+ *@pre Card object exists, and is not NULL.  text is not NULL
+ *@post Card has not been modified in any way.  On success *text holds the NUL terminated text and must be freed
+        by the caller, otherwise it is NULL
+ *@return the error code indicating success or the error encountered
+ *@param obj - a pointer to a Card struct
+		 text - where to store the new string
+		 length - if not NULL, set to the length of the text without the terminator
+ **/
+ VCardErrorCode writeCardToString(const Card* obj, char** text, size_t* length);
+
 
  /** Function to writing a Card object into a file in vCard format.
   *@pre Card object exists, and is not NULL.
@@ -147,4 +274,116 @@ char* dateToString(void* date);
   **/
  VCardErrorCode validateCard(const Card* obj);
 
+// ************* Reentrant functions ****************************************
+// createCard, validateCard and writeCard keep no global state and are safe to call from several threads.
+// These variants also leave the error, and the line it was found on, in a context owned by the caller.
+
+void initializeContext(VCardContext* ctx);
+VCardErrorCode createCardWithContext(VCardContext* ctx, char* fileName, Card** obj);
+VCardErrorCode validateCardWithContext(VCardContext* ctx, const Card* obj);
+VCardErrorCode writeCardWithContext(VCardContext* ctx, const char* fileName, const Card* obj);
+
+// ************* Streaming reader functions *********************************
+
+//Reader over a file holding any number of cards back to back.  The layout is private to VCParser.c
+typedef struct vCardReader VCardReader;
+
+/** Function to open a multi-card vCard file for reading one card at a time.
+ *@pre fileName is not NULL and has the correct extension
+ *@post on success reader points to a new reader that must be closed with closeCardReader
+ *@return OK, INV_FILE if the file cannot be opened, or OTHER_ERROR if allocation fails
+ *@param fileName - the name of the file to read
+		 reader - set to the new reader
+ **/
+VCardErrorCode openCardReader(const char* fileName, VCardReader** reader);
+
+/** Function to read the next card from a reader.
+ *@pre reader was opened with openCardReader
+ *@post on success obj points to a new Card that must be freed with deleteCard.
+		At the end of the file OK is returned and obj is set to NULL.
+		If a card is invalid its error is returned and the next call starts after that card
+ *@return the error code for the card that was read
+ *@param reader - the reader to read from
+		 obj - set to the card that was read, or NULL
+ **/
+VCardErrorCode readNextCard(VCardReader* reader, Card** obj);
+
+/** Function to close a reader and release its file.
+ *@param reader - the reader to close, may be NULL
+ **/
+void closeCardReader(VCardReader* reader);
+
+/** Function to get the line of the file that the last error from readNextCard was found on.
+ *@return the line number, or 0 if the error was not tied to a line
+ *@param reader - the reader to check
+ **/
+int readerErrorLine(const VCardReader* reader);
+
+/** Function to choose whether a reader allocates each card in its own arena, like createCardInArena.
+ *@param reader - the reader to change
+		 useArena - true to allocate cards in arenas
+ **/
+void setReaderUseArena(VCardReader* reader, bool useArena);
+
+/** Function to have a reader parse only the named properties, plus FN and VERSION.
+ *@param reader - the reader to change
+		 names - property names to keep, which must outlive the reader.  NULL parses everything
+		 count - number of names
+ **/
+void setReaderProjection(VCardReader* reader, const char* const* names, int count);
+
+
+// ************* Property name ids ******************************************
+
+/** Function to resolve a property name to its id, ignoring case.
+ *@return the id, or PROP_OTHER if the name is not one from RFC 6350
+ *@param name - the name, which does not need to be NUL terminated
+		 length - length of the name
+ **/
+PropertyId propertyIdFromName(const char* name, size_t length);
+
+/** Function to get the upper case name of an id.
+ *@return the name, or an empty string for PROP_OTHER.  It must not be freed
+ *@param id - the id
+ **/
+const char* propertyIdName(PropertyId id);
+
+
+// ************* Property lookup ********************************************
+// Every card keeps an index of fn and optionalProperties, so these take constant time whatever the size of
+// the card.  The parser fills the index in as it goes.  If the card has been changed since, the next lookup
+// builds it again, so a card that is being changed must not be looked up on several threads at once.
+// A change is noticed when fn or optionalProperties is replaced, or when the list is changed through the
+// LinkedListAPI functions that add, remove, clear or sort.  Any other change, such as renaming or regrouping
+// a property or storing a different Property in a node's data, must be followed by rebuildCardIndex.
+
+/** Function to find every property with a given name, ignoring case.
+ *@return a vector of Property*, in the order they are in the card with fn first, or NULL if there are none.
+ * It belongs to the card and is valid until the card is next changed or looked up after a change
+ *@param card - the card to search
+		 name - the property name
+ **/
+const SmallVector* findPropertiesByName(const Card* card, const char* name);
+
+/** Function to find every property in a group, such as item1, ignoring case.
+ *@return a vector of Property* like findPropertiesByName, or NULL if there are none
+ *@param card - the card to search
+		 group - the group name, which must not be empty
+ **/
+const SmallVector* findPropertiesInGroup(const Card* card, const char* group);
+
+/** Function to build the index of a card again from scratch, after a change the lookups can not notice,
+ * such as a property being renamed or regrouped or a node's data being replaced.
+ *@return false if allocation fails, in which case the next lookup tries again
+ *@param card - the card
+ **/
+bool rebuildCardIndex(Card* card);
+
+/** Function to put a card's optionalProperties in compareProperties order, keeping properties that compare
+ * equal in the order they were in.  Once sorted, equal properties are next to each other, so two cards
+ * can be merged, compared or have duplicates dropped in one pass.
+ *@param card - the card, may be NULL
+ **/
+void sortCardProperties(Card* card);
+
 #endif	
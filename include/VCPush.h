@@ -0,0 +1,53 @@
+#ifndef VCPUSH_H
+#define VCPUSH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "VCParser.h"
+
+/*
+    Push parser for cards that arrive in pieces, such as over a pipe or socket.  Bytes are fed in
+    chunks of any size, split anywhere, and each card is handed to a callback as soon as its END line is in.
+*/
+
+typedef struct vCardPushParser VCardPushParser;
+
+/*	Called once for each card in the input.  On success card is a new Card that the handler owns and must
+	free with deleteCard, and error is OK.  Otherwise card is NULL, error says what was wrong with the card
+	and errorLine is the line of the input it was found on, or 0.  Returning false stops the parser.
+*/
+typedef bool (*CardHandler)(void* handlerData, Card* card, VCardErrorCode error, int errorLine);
+
+
+/** Function to create a push parser.
+ *@return the new parser, or NULL if allocation fails.  It must be freed with deletePushParser
+ *@param options - context whose options, such as useArena, apply to every card.  May be NULL
+		 handler - called for every card
+		 handlerData - passed through to handler
+ **/
+VCardPushParser* createPushParser(const VCardContext* options, CardHandler handler, void* handlerData);
+
+/** Function to feed the next chunk of input to a push parser.
+ *@return OK, INV_FILE if a line outside of any card does not end in CRLF, or OTHER_ERROR if allocation fails.
+		 Problems with the cards themselves go to the handler.  After INV_FILE nothing more is parsed until
+		 finishPushParser is called
+ *@param parser - the parser
+		 data - the bytes
+		 length - number of bytes
+ **/
+VCardErrorCode pushCardBytes(VCardPushParser* parser, const char* data, size_t length);
+
+/** Function to tell a push parser the input has ended, so the last line is parsed and
+ * a card left without its END line is reported.  The parser can then be fed a new input.
+ *@return OK, INV_FILE if the last line is outside of any card and has no line ending, or OTHER_ERROR if allocation fails
+ *@param parser - the parser
+ **/
+VCardErrorCode finishPushParser(VCardPushParser* parser);
+
+/** Function to free a push parser, along with any card it was part way through.
+ *@param parser - the parser to free, may be NULL
+ **/
+void deletePushParser(VCardPushParser* parser);
+
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef VCSCAN_H
+#define VCSCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Delimiter scanner for the property line tokenizer.  One pass over the bytes marks every
+    CR, LF, ':', ';', '=', ',', '.' and '\' in a bitmap, one bit per byte and 64 bytes per word.
+    The scanning kernel is picked at load time: AVX2 or SSE2 where the CPU has them, scalar otherwise.
+*/
+
+//words of bitmap the cursor scans at a time, 512 bytes of input
+#define SCAN_WINDOW_WORDS 8
+
+//walks the delimiters of a span in order, scanning it a window at a time
+typedef struct delimiterCursor {
+    const char * data;
+    size_t length;
+
+    //offset of the first byte covered by bitmap
+    size_t windowStart;
+    size_t wordIndex;
+    size_t wordCount;
+    uint64_t bitmap[SCAN_WINDOW_WORDS];
+} DelimiterCursor;
+
+
+//fills bitmap, which must hold (length + 63) / 64 words, with the delimiter positions in data
+void scanDelimiters(const char * data, size_t length, uint64_t * bitmap);
+
+void startDelimiterCursor(DelimiterCursor * cursor, const char * data, size_t length);
+
+//returns the next delimiter in the span, or NULL once there are none left
+const char * nextDelimiter(DelimiterCursor * cursor);
+
+//name of the kernel in use, "avx2", "sse2" or "scalar"
+const char * delimiterScannerName(void);
+
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef VCWATCH_H
+#define VCWATCH_H
+
+#include <stdbool.h>
+#include "VCParser.h"
+
+/*
+    Index of the cards in a directory that is kept up to date with inotify.  The directory is parsed once
+    when the watcher is created, and after that only the files that are written, renamed or deleted are
+    read again.  A watcher is used from one thread at a time.
+*/
+
+typedef struct vCardWatcher VCardWatcher;
+
+//What the index holds for each .vcf or .vcard file in the directory
+typedef struct watchedCard {
+	//Name of the file inside the directory
+	char*			fileName;
+
+	//First value of FN, and BDAY and ANNIVERSARY as dateToString shows them.  NULL if missing or the card is invalid
+	char*			fn;
+	char*			birthday;
+	char*			anniversary;
+
+	//Error from parsing the file, as createCard would return it
+	VCardErrorCode	error;
+
+	//Number of optional properties
+	int				otherCount;
+
+} WatchedCard;
+
+typedef enum cardChangeKind { CARD_ADDED, CARD_UPDATED, CARD_REMOVED } CardChangeKind;
+
+//One file that changed, see cardChangeAt
+typedef struct cardChange {
+	CardChangeKind	kind;
+	const char*		fileName;
+} CardChange;
+
+
+/** Function to start watching a directory, parsing every card file in it.
+ *@return the new watcher, or NULL if the directory cannot be read or watched.  It must be freed with deleteCardWatcher
+ *@param dirName - the directory to watch
+		 threads - threads to parse with when many files need parsing, or 0 or less for one per CPU
+		 options - context whose options apply to every file.  May be NULL
+ **/
+VCardWatcher* createCardWatcher(const char* dirName, int threads, const VCardContext* options);
+
+/** Function to bring the index up to date with whatever happened in the directory.  Every file named in the
+ * pending events is read again once, however many events it had.  If the kernel dropped events the whole
+ * directory is checked again instead.
+ *@post the changes it made can be read with cardChangeAt.  Pointers from watchedCardAt, findWatchedCard and
+		cardChangeAt taken before the call are no longer valid
+ *@return the number of files that changed, or -1 if the directory has gone or cannot be watched any more
+ *@param watcher - the watcher
+		 timeoutMs - milliseconds to wait for something to happen, 0 to only check, or -1 to wait as long as it takes
+ **/
+int updateCardWatcher(VCardWatcher* watcher, int timeoutMs);
+
+/** Function to get a file descriptor that becomes readable when updateCardWatcher has something to do,
+ * for callers that wait on several things at once with poll or select.
+ *@param watcher - the watcher
+ **/
+int cardWatcherFd(const VCardWatcher* watcher);
+
+/** Functions to read the changes made by the last updateCardWatcher.
+ *@param watcher - the watcher
+		 index - from 0 to cardChangeCount - 1
+ **/
+int cardChangeCount(const VCardWatcher* watcher);
+const CardChange* cardChangeAt(const VCardWatcher* watcher, int index);
+
+/** Functions to read the index.  The order is arbitrary and changes when files are removed.
+ *@param watcher - the watcher
+		 index - from 0 to watchedCardCount - 1
+ **/
+int watchedCardCount(const VCardWatcher* watcher);
+const WatchedCard* watchedCardAt(const VCardWatcher* watcher, int index);
+
+/** Function to look a file up in the index.
+ *@return the entry, or NULL if the file is not in the directory
+ *@param watcher - the watcher
+		 fileName - name of the file inside the directory
+ **/
+const WatchedCard* findWatchedCard(const VCardWatcher* watcher, const char* fileName);
+
+/** Function to stop watching and free the index.
+ *@param watcher - the watcher, may be NULL
+ **/
+void deleteCardWatcher(VCardWatcher* watcher);
+
+
+#endif
@@ -8,25 +8,69 @@
 *@param compareFunction function pointer to compare two nodes of the list in order to test for equality or order
 **/
 List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second)){
+    return initializeListWithAllocator(printFunction, deleteFunction, compareFunction, NULL);
+}
+
+//allocates and frees list memory through the list's allocator, if it has one
+static void* listAlloc(ListAllocator* allocator, size_t size){
+	if (allocator == NULL){
+		return malloc(size);
+	}
+	return allocator->alloc(allocator->context, size);
+}
+
+static void listRelease(ListAllocator* allocator, void* block){
+	if (allocator == NULL){
+		free(block);
+		return;
+	}
+	allocator->release(allocator->context, block);
+}
+
+/** Function to initialize the list metadata head, taking the List and its Nodes from the given allocator.
+*@return pointer to the list head
+*@param allocator the allocator to use, or NULL for malloc
+**/
+List * initializeListWithAllocator(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListAllocator* allocator){
     //Asserts create a partial function...
     assert(printFunction != NULL);
     assert(deleteFunction != NULL);
     assert(compareFunction != NULL);
 
-    List * tmpList = malloc(sizeof(List));
+    List * tmpList = listAlloc(allocator, sizeof(List));
+	if (tmpList == NULL){
+		return NULL;
+	}
 	
 	tmpList->head = NULL;
 	tmpList->tail = NULL;
 
 	tmpList->length = 0;
+	tmpList->changes = 0;
 
 	tmpList->deleteData = deleteFunction;
 	tmpList->compare = compareFunction;
 	tmpList->printData = printFunction;
+	tmpList->allocator = allocator;
 	
 	return tmpList;
 }
 
+//creates a node using the list's allocator
+static Node* listNode(List* list, void* data){
+	Node* tmpNode = listAlloc(list->allocator, sizeof(Node));
+	
+	if (tmpNode == NULL){
+		return NULL;
+	}
+	
+	tmpNode->data = data;
+	tmpNode->previous = NULL;
+	tmpNode->next = NULL;
+	
+	return tmpNode;
+}
+
 
 /** Deletes the entire linked list, freeing all memory.
 * uses the supplied function pointer to release allocated memory for the data
@@ -35,9 +79,12 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 *@return  on success: NULL, on failure: head of list
 **/
 void freeList(List* list){	
+    if (list == NULL){
+		return;
+	}
 
     clearList(list);
-	free(list);
+	listRelease(list->allocator, list);
 }
 
 /** Clears the list: frees the contents of the list - Node structs and data stored in them - 
@@ -59,16 +106,25 @@ void clearList(List* list){
 	
 	Node* tmp;
 	
-	while (list->head != NULL){
-		list->deleteData(list->head->data);
-		tmp = list->head;
-		list->head = list->head->next;
-		free(tmp);
+	if (list->allocator != NULL && list->allocator->releaseChain != NULL){
+		//delete the data, then give all the nodes back in one go
+		for (tmp = list->head; tmp != NULL; tmp = tmp->next){
+			list->deleteData(tmp->data);
+		}
+		list->allocator->releaseChain(list->allocator->context, list->head, list->tail);
+	} else {
+		while (list->head != NULL){
+			list->deleteData(list->head->data);
+			tmp = list->head;
+			list->head = list->head->next;
+			listRelease(list->allocator, tmp);
+		}
 	}
 	
 	list->head = NULL;
 	list->tail = NULL;
 	list->length = 0;
+	(list->changes)++;
 }
 
 /**Function for creating a node for the linked list. 
@@ -105,9 +161,13 @@ void insertBack(List* list, void* toBeAdded){
 		return;
 	}
 	
-	(list->length)++;
+	Node* newNode = listNode(list, toBeAdded);
+	if (newNode == NULL){
+		return;
+	}
 
-	Node* newNode = initializeNode(toBeAdded);
+	(list->length)++;
+	(list->changes)++;
 	
     if (list->head == NULL && list->tail == NULL){
         list->head = newNode;
@@ -130,9 +190,13 @@ void insertFront(List* list, void* toBeAdded){
 		return;
 	}
 	
-	(list->length)++;
+	Node* newNode = listNode(list, toBeAdded);
+	if (newNode == NULL){
+		return;
+	}
 
-	Node* newNode = initializeNode(toBeAdded);
+	(list->length)++;
+	(list->changes)++;
 	
     if (list->head == NULL && list->tail == NULL){
         list->head = newNode;
@@ -195,9 +259,10 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 			}
 			
 			void* data = delNode->data;
-			free(delNode);
+			listRelease(list->allocator, delNode);
 			
 			(list->length)--;
+			(list->changes)++;
 
 			return data;
 			
@@ -243,21 +308,16 @@ void insertSorted(List *list, void *toBeAdded){
 	
 	while (currNode != NULL){
 		if (list->compare(toBeAdded, currNode->data) <= 0){
-		
-			char* currDescr = list->printData(currNode->data); 
-			char* newDescr = list->printData(toBeAdded); 
-		
-			//printf("Inserting %s before %s\n", newDescr, currDescr);
-
-			free(currDescr);
-			free(newDescr);
-		
-			Node* newNode = initializeNode(toBeAdded);
+			Node* newNode = listNode(list, toBeAdded);
+			if (newNode == NULL){
+				return;
+			}
 			newNode->next = currNode;
 			newNode->previous = currNode->previous;
 			currNode->previous->next = newNode;
 			currNode->previous = newNode;
 			(list->length)++;
+			(list->changes)++;
 
 			return;
 		}
@@ -268,6 +328,72 @@ void insertSorted(List *list, void *toBeAdded){
 	return;
 }
 
+//merges two sorted runs joined by next pointers, taking from the first on ties so the sort is stable
+static Node* mergeRuns(Node* first, Node* second, int (*compare)(const void* first,const void* second)){
+	Node head;
+	Node* tail = &head;
+
+	while (first != NULL && second != NULL){
+		if (compare(second->data, first->data) < 0){
+			tail->next = second;
+			second = second->next;
+		} else {
+			tail->next = first;
+			first = first->next;
+		}
+		tail = tail->next;
+	}
+	tail->next = first != NULL ? first : second;
+
+	return head.next;
+}
+
+void sortList(List* list){
+	if (list == NULL || list->length < 2){
+		return;
+	}
+
+	//bottom up merge sort, runs[i] holds a sorted run of 2^i nodes or NULL
+	Node* runs[64] = { NULL };
+	int maxRun = 0;
+
+	Node* node = list->head;
+	while (node != NULL){
+		Node* next = node->next;
+		node->next = NULL;
+
+		int i = 0;
+		for (; runs[i] != NULL; i++){
+			node = mergeRuns(runs[i], node, list->compare);
+			runs[i] = NULL;
+		}
+		runs[i] = node;
+		if (i > maxRun){
+			maxRun = i;
+		}
+
+		node = next;
+	}
+
+	//older runs came first in the list, so they go first in each merge
+	Node* sorted = NULL;
+	for (int i = 0; i <= maxRun; i++){
+		if (runs[i] != NULL){
+			sorted = sorted == NULL ? runs[i] : mergeRuns(runs[i], sorted, list->compare);
+		}
+	}
+
+	//put the previous pointers and the tail back
+	Node* previous = NULL;
+	list->head = sorted;
+	for (node = sorted; node != NULL; node = node->next){
+		node->previous = previous;
+		previous = node;
+	}
+	list->tail = previous;
+	(list->changes)++;
+}
+
 /**Returns a string that contains a string representation of the list traversed from  head to tail. 
 Utilize an iterator and the list's printData function pointer to create the string.
 returned string must be freed by the calling function.
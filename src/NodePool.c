@@ -0,0 +1,338 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#include "NodePool.h"
+
+//blocks carved out of each slab
+#define NODE_POOL_SLAB_BLOCKS 512
+
+//free blocks a thread keeps before it hands the rest back to the pool for other threads to reuse
+#define NODE_POOL_CACHE_LIMIT (2 * NODE_POOL_SLAB_BLOCKS)
+
+//a pool block holds either struct.  Free blocks are chained through the Node next pointer,
+//which is what lets a list's own nodes be put on a free list as they are
+typedef union poolBlock {
+    Node node;
+    List list;
+} PoolBlock;
+
+typedef struct poolSlab {
+    struct poolSlab* next;
+    PoolBlock blocks[NODE_POOL_SLAB_BLOCKS];
+} PoolSlab;
+
+//one thread's share of the pool
+typedef struct poolCache {
+    struct poolCache* next;
+    struct nodePool* pool;
+
+    //released blocks, reused first
+    Node* freeBlocks;
+    size_t freeCount;
+
+    //slab being carved and how many of its blocks have been handed out
+    PoolSlab* slab;
+    int slabUsed;
+
+    //allocations minus releases made through this cache, which can go below 0
+    //when blocks are released on a different thread than they were allocated on
+    intptr_t inUse;
+
+    //false once the thread that had the cache has exited, so another thread can take it over
+    bool owned;
+} PoolCache;
+
+struct nodePool {
+    ListAllocator allocator;
+
+    //finds the calling thread's cache
+    pthread_key_t key;
+
+    //guards caches, slabs and shared blocks, only taken when a thread gets its cache, moves blocks
+    //to or from the shared list, or needs a new slab
+    pthread_mutex_t lock;
+    PoolCache* caches;
+    PoolSlab* slabs;
+
+    //blocks handed back by caches that had too many, taken before a new slab is carved
+    Node* sharedBlocks;
+};
+
+
+//puts a chain of free blocks on the shared list.  The pool's lock must be held
+static void shareBlocks(NodePool* pool, Node* first, Node* last){
+    last->next = pool->sharedBlocks;
+    pool->sharedBlocks = first;
+}
+
+//gives a cache back to its pool when its thread exits, along with its free blocks
+static void releaseCache(void* value){
+    PoolCache* cache = value;
+
+    Node* last = cache->freeBlocks;
+    while (last != NULL && last->next != NULL){
+        last = last->next;
+    }
+
+    pthread_mutex_lock(&cache->pool->lock);
+    if (last != NULL){
+        shareBlocks(cache->pool, cache->freeBlocks, last);
+    }
+    cache->freeBlocks = NULL;
+    cache->freeCount = 0;
+    cache->owned = false;
+    pthread_mutex_unlock(&cache->pool->lock);
+}
+
+//hands the free blocks over the limit back to the pool.  Half the limit is kept, so a thread that
+//goes on releasing only takes the lock once every few hundred blocks
+static void spillBlocks(PoolCache* cache){
+
+    if (cache->freeCount <= NODE_POOL_CACHE_LIMIT){
+        return;
+    }
+
+    Node* kept = cache->freeBlocks;
+    for (size_t i = 1; i < NODE_POOL_CACHE_LIMIT / 2; i++){
+        kept = kept->next;
+    }
+
+    Node* first = kept->next;
+    Node* last = first;
+    while (last->next != NULL){
+        last = last->next;
+    }
+    kept->next = NULL;
+    cache->freeCount = NODE_POOL_CACHE_LIMIT / 2;
+
+    pthread_mutex_lock(&cache->pool->lock);
+    shareBlocks(cache->pool, first, last);
+    pthread_mutex_unlock(&cache->pool->lock);
+}
+
+//takes up to a slab's worth of blocks from the shared list
+static bool refillCache(PoolCache* cache){
+
+    NodePool* pool = cache->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    Node* first = pool->sharedBlocks;
+    if (first == NULL){
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+
+    Node* last = first;
+    size_t count = 1;
+    while (count < NODE_POOL_SLAB_BLOCKS && last->next != NULL){
+        last = last->next;
+        count++;
+    }
+    pool->sharedBlocks = last->next;
+    pthread_mutex_unlock(&pool->lock);
+
+    last->next = NULL;
+    cache->freeBlocks = first;
+    cache->freeCount = count;
+    return true;
+}
+
+//finds the calling thread's cache, taking over an abandoned one or making a new one the first time
+static PoolCache* threadCache(NodePool* pool){
+
+    PoolCache* cache = pthread_getspecific(pool->key);
+    if (cache != NULL){
+        return cache;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (cache = pool->caches; cache != NULL; cache = cache->next){
+        if (!cache->owned){
+            break;
+        }
+    }
+
+    if (cache == NULL){
+        cache = calloc(1, sizeof(PoolCache));
+        if (cache != NULL){
+            cache->pool = pool;
+            cache->slabUsed = NODE_POOL_SLAB_BLOCKS;
+            cache->next = pool->caches;
+            pool->caches = cache;
+        }
+    }
+
+    if (cache != NULL){
+        cache->owned = true;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (cache != NULL && pthread_setspecific(pool->key, cache) != 0){
+        releaseCache(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static void* poolAlloc(void* context, size_t size){
+
+    NodePool* pool = context;
+    if (size > sizeof(PoolBlock)){
+        return NULL;
+    }
+
+    PoolCache* cache = threadCache(pool);
+    if (cache == NULL){
+        return NULL;
+    }
+
+    //blocks other threads released are used before new ones are carved
+    if (cache->freeBlocks == NULL && cache->slabUsed == NODE_POOL_SLAB_BLOCKS){
+        refillCache(cache);
+    }
+
+    Node* block = cache->freeBlocks;
+    if (block != NULL){
+        cache->freeBlocks = block->next;
+        cache->freeCount--;
+        cache->inUse++;
+        return block;
+    }
+
+    if (cache->slabUsed == NODE_POOL_SLAB_BLOCKS){
+        PoolSlab* slab = malloc(sizeof(PoolSlab));
+        if (slab == NULL){
+            return NULL;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pthread_mutex_unlock(&pool->lock);
+
+        cache->slab = slab;
+        cache->slabUsed = 0;
+    }
+
+    cache->inUse++;
+    return &cache->slab->blocks[cache->slabUsed++];
+}
+
+static void poolRelease(void* context, void* block){
+
+    PoolCache* cache = threadCache(context);
+    if (cache == NULL){
+        //the block stays with the pool and is freed along with it
+        return;
+    }
+
+    Node* node = block;
+    node->next = cache->freeBlocks;
+    cache->freeBlocks = node;
+    cache->freeCount++;
+    cache->inUse--;
+
+    spillBlocks(cache);
+}
+
+//puts a whole list of nodes on the free list at once
+static void poolReleaseChain(void* context, Node* first, Node* last){
+
+    if (first == NULL){
+        return;
+    }
+
+    PoolCache* cache = threadCache(context);
+    if (cache == NULL){
+        return;
+    }
+
+    intptr_t count = 0;
+    for (Node* node = first; node != last; node = node->next){
+        count++;
+    }
+
+    last->next = cache->freeBlocks;
+    cache->freeBlocks = first;
+    cache->freeCount += count + 1;
+    cache->inUse -= count + 1;
+
+    spillBlocks(cache);
+}
+
+
+NodePool* createNodePool(void){
+
+    NodePool* pool = malloc(sizeof(NodePool));
+    if (pool == NULL){
+        return NULL;
+    }
+
+    if (pthread_key_create(&pool->key, &releaseCache) != 0){
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->caches = NULL;
+    pool->slabs = NULL;
+    pool->sharedBlocks = NULL;
+
+    pool->allocator.alloc = &poolAlloc;
+    pool->allocator.release = &poolRelease;
+    pool->allocator.releaseChain = &poolReleaseChain;
+    pool->allocator.context = pool;
+    pool->allocator.maxBlock = sizeof(PoolBlock);
+
+    return pool;
+}
+
+ListAllocator* nodePoolAllocator(NodePool* pool){
+    if (pool == NULL){
+        return NULL;
+    }
+    return &pool->allocator;
+}
+
+size_t nodePoolBlocksInUse(NodePool* pool){
+    if (pool == NULL){
+        return 0;
+    }
+
+    intptr_t inUse = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (PoolCache* cache = pool->caches; cache != NULL; cache = cache->next){
+        inUse += cache->inUse;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return inUse > 0 ? (size_t)inUse : 0;
+}
+
+void deleteNodePool(NodePool* pool){
+    if (pool == NULL){
+        return;
+    }
+
+    //stops the caches being handed back as threads exit
+    pthread_key_delete(pool->key);
+
+    PoolCache* cache = pool->caches;
+    while (cache != NULL){
+        PoolCache* next = cache->next;
+        free(cache);
+        cache = next;
+    }
+
+    PoolSlab* slab = pool->slabs;
+    while (slab != NULL){
+        PoolSlab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
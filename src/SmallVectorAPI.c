@@ -0,0 +1,170 @@
+#include "SmallVectorAPI.h"
+
+//allocates and frees vector storage through the vector's allocator, if it has one
+static void* vectorAlloc(ListAllocator* allocator, size_t size){
+	if (allocator == NULL){
+		return malloc(size);
+	}
+	return allocator->alloc(allocator->context, size);
+}
+
+static void vectorRelease(ListAllocator* allocator, void* block){
+	if (allocator == NULL){
+		free(block);
+	} else if (allocator->release != NULL){
+		allocator->release(allocator->context, block);
+	}
+}
+
+//the elements live inline until the vector outgrows them
+static void** vectorItems(const SmallVector* vector){
+	if (vector->capacity <= SMALL_VECTOR_INLINE){
+		return (void**)vector->storage.inlineData;
+	}
+	return vector->storage.heapData;
+}
+
+void initializeVector(SmallVector* vector, char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListAllocator* allocator){
+	if (vector == NULL){
+		return;
+	}
+
+	vector->length = 0;
+	vector->capacity = SMALL_VECTOR_INLINE;
+	vector->printData = printFunction;
+	vector->deleteData = deleteFunction;
+	vector->compare = compareFunction;
+
+	//a block past the inline elements is bigger than an allocator of small blocks, like a NodePool's, can serve
+	vector->allocator = allocator != NULL && allocator->maxBlock == 0 ? allocator : NULL;
+}
+
+bool vectorPushBack(SmallVector* vector, void* toBeAdded){
+	if (vector == NULL){
+		return false;
+	}
+
+	if (vector->length == vector->capacity){
+		//double the capacity, the allocator may be an arena so there is no realloc
+		int newCapacity = vector->capacity * 2;
+		void** grown = vectorAlloc(vector->allocator, sizeof(void*) * newCapacity);
+		if (grown == NULL){
+			return false;
+		}
+
+		void** old = vectorItems(vector);
+		memcpy(grown, old, sizeof(void*) * vector->length);
+		if (vector->capacity > SMALL_VECTOR_INLINE){
+			vectorRelease(vector->allocator, old);
+		}
+
+		vector->storage.heapData = grown;
+		vector->capacity = newCapacity;
+	}
+
+	vectorItems(vector)[vector->length++] = toBeAdded;
+	return true;
+}
+
+void* vectorGet(const SmallVector* vector, int index){
+	if (vector == NULL || index < 0 || index >= vector->length){
+		return NULL;
+	}
+	return vectorItems(vector)[index];
+}
+
+void** vectorData(SmallVector* vector){
+	if (vector == NULL){
+		return NULL;
+	}
+	return vectorItems(vector);
+}
+
+int vectorLength(const SmallVector* vector){
+	if (vector == NULL){
+		return 0;
+	}
+	return vector->length;
+}
+
+void* vectorRemoveAt(SmallVector* vector, int index){
+	if (vector == NULL || index < 0 || index >= vector->length){
+		return NULL;
+	}
+
+	void** items = vectorItems(vector);
+	void* removed = items[index];
+	memmove(items + index, items + index + 1, sizeof(void*) * (vector->length - index - 1));
+	vector->length--;
+	return removed;
+}
+
+void* findInVector(const SmallVector* vector, bool (*customCompare)(const void* first,const void* second), const void* searchRecord){
+	if (vector == NULL || customCompare == NULL || searchRecord == NULL){
+		return NULL;
+	}
+
+	void** items = vectorItems(vector);
+	for (int i = 0; i < vector->length; i++){
+		if (customCompare(items[i], searchRecord)){
+			return items[i];
+		}
+	}
+	return NULL;
+}
+
+char* vectorToString(const SmallVector* vector){
+	char* str = malloc(sizeof(char));
+	if (str == NULL){
+		return NULL;
+	}
+	str[0] = '\0';
+
+	if (vector == NULL){
+		return str;
+	}
+
+	size_t used = 0;
+	void** items = vectorItems(vector);
+	for (int i = 0; i < vector->length; i++){
+		char* currDescr = vector->printData(items[i]);
+		size_t descrLen = strlen(currDescr);
+
+		char* grown = realloc(str, used + descrLen + 1);
+		if (grown == NULL){
+			free(currDescr);
+			return str;
+		}
+		str = grown;
+		memcpy(str + used, currDescr, descrLen + 1);
+		used += descrLen;
+
+		free(currDescr);
+	}
+
+	return str;
+}
+
+void clearVector(SmallVector* vector){
+	if (vector == NULL){
+		return;
+	}
+
+	void** items = vectorItems(vector);
+	for (int i = 0; i < vector->length; i++){
+		vector->deleteData(items[i]);
+	}
+	vector->length = 0;
+}
+
+void releaseVector(SmallVector* vector){
+	if (vector == NULL){
+		return;
+	}
+
+	clearVector(vector);
+	if (vector->capacity > SMALL_VECTOR_INLINE){
+		vectorRelease(vector->allocator, vector->storage.heapData);
+	}
+	vector->capacity = SMALL_VECTOR_INLINE;
+}
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "StringBuilder.h"
+
+
+void initializeStringBuilder(StringBuilder * builder, size_t capacity){
+
+    builder->length = 0;
+    builder->failed = false;
+    builder->fixed = false;
+    builder->capacity = capacity + 1;
+    builder->data = malloc(builder->capacity);
+
+    if(builder->data == NULL){
+        builder->capacity = 0;
+        builder->failed = true;
+    } else {
+        builder->data[0] = '\0';
+    }
+}
+
+void initializeFixedStringBuilder(StringBuilder * builder, char * buffer, size_t size){
+
+    builder->data = buffer;
+    builder->length = 0;
+    builder->capacity = size;
+    builder->fixed = true;
+    builder->failed = (buffer == NULL || size == 0);
+
+    if(!builder->failed){
+        buffer[0] = '\0';
+    }
+}
+
+bool builderReserve(StringBuilder * builder, size_t extra){
+
+    if(builder->failed){
+        return false;
+    }
+
+    //keep a byte for the terminator
+    size_t needed = builder->length + extra + 1;
+    if(needed <= builder->capacity){
+        return true;
+    }
+
+    if(builder->fixed){
+        builder->failed = true;
+        return false;
+    }
+
+    //grow by at least half again so appends stay amortized O(1)
+    size_t capacity = builder->capacity + builder->capacity / 2;
+    if(capacity < needed){
+        capacity = needed;
+    }
+
+    char * grown = realloc(builder->data, capacity);
+    if(grown == NULL){
+        builder->failed = true;
+        return false;
+    }
+
+    builder->data = grown;
+    builder->capacity = capacity;
+    return true;
+}
+
+void builderAppendN(StringBuilder * builder, const char * str, size_t length){
+
+    if(!builderReserve(builder, length)){
+        return;
+    }
+
+    memcpy(builder->data + builder->length, str, length);
+    builder->length += length;
+    builder->data[builder->length] = '\0';
+}
+
+void builderAppend(StringBuilder * builder, const char * str){
+    if(str != NULL){
+        builderAppendN(builder, str, strlen(str));
+    }
+}
+
+void builderAppendChar(StringBuilder * builder, char c){
+    builderAppendN(builder, &c, 1);
+}
+
+char * builderTakeString(StringBuilder * builder){
+
+    if(builder->failed){
+        freeStringBuilder(builder);
+        return NULL;
+    }
+
+    char * str = builder->data;
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->failed = true;
+    return str;
+}
+
+void freeStringBuilder(StringBuilder * builder){
+    if(!builder->fixed){
+        free(builder->data);
+    }
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->failed = true;
+}
@@ -0,0 +1,554 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCBatch.h"
+#include "VCHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+
+
+
+//WORK STEALING POOL
+
+//the indexes a thread still has to run, from next up to end
+typedef struct workRange {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} WorkRange;
+
+typedef struct workPool {
+    WorkRange * ranges;
+    int threads;
+    void (*work)(void* arg, int index, int worker);
+    void * arg;
+} WorkPool;
+
+typedef struct workerStart {
+    WorkPool * pool;
+    int worker;
+} WorkerStart;
+
+
+//takes the next index from the front of a thread's own range
+static bool takeOwnWork(WorkRange * range, int * index){
+
+    pthread_mutex_lock(&range->lock);
+    bool found = range->next < range->end;
+    if(found){
+        *index = range->next++;
+    }
+    pthread_mutex_unlock(&range->lock);
+
+    return found;
+}
+
+//moves the back half of another thread's range over to this one
+static bool stealWork(WorkPool * pool, int worker){
+
+    for(int i = 1; i < pool->threads; i++){
+        WorkRange * victim = &pool->ranges[(worker + i) % pool->threads];
+
+        //only one lock is ever held at a time, so two thieves can never deadlock
+        pthread_mutex_lock(&victim->lock);
+        int left = victim->end - victim->next;
+        int start = victim->end - left / 2;
+        int end = victim->end;
+        if(left >= 2){
+            victim->end = start;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if(left >= 2){
+            WorkRange * own = &pool->ranges[worker];
+            pthread_mutex_lock(&own->lock);
+            own->next = start;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void * runWorker(void * arg){
+
+    WorkerStart * start = (WorkerStart*)arg;
+    WorkPool * pool = start->pool;
+
+    while(true){
+        int index;
+        if(takeOwnWork(&pool->ranges[start->worker], &index)){
+            pool->work(pool->arg, index, start->worker);
+        } else if(!stealWork(pool, start->worker)){
+            //a single item left anywhere is already being run by its owner
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int runWorkStealing(int count, int threads, void (*work)(void* arg, int index, int worker), void* arg){
+
+    if(count <= 0 || work == NULL){
+        return 0;
+    }
+
+    if(threads <= 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if(threads > count){
+        threads = count;
+    }
+
+    WorkRange * ranges = malloc(sizeof(WorkRange) * threads);
+    WorkerStart * starts = malloc(sizeof(WorkerStart) * threads);
+    pthread_t * ids = malloc(sizeof(pthread_t) * threads);
+    bool * started = calloc(threads, sizeof(bool));
+
+    //without the memory for a pool, run everything on the calling thread
+    if(ranges == NULL || starts == NULL || ids == NULL || started == NULL){
+        free(ranges);
+        free(starts);
+        free(ids);
+        free(started);
+        for(int i = 0; i < count; i++){
+            work(arg, i, 0);
+        }
+        return 1;
+    }
+
+    WorkPool pool = { ranges, threads, work, arg };
+
+    //hand out the indexes evenly to begin with
+    for(int i = 0; i < threads; i++){
+        pthread_mutex_init(&ranges[i].lock, NULL);
+        ranges[i].next = (int)((long long)count * i / threads);
+        ranges[i].end = (int)((long long)count * (i + 1) / threads);
+        starts[i].pool = &pool;
+        starts[i].worker = i;
+    }
+
+    //the calling thread is worker 0, any thread that cannot be started leaves its share to be stolen
+    for(int i = 1; i < threads; i++){
+        started[i] = pthread_create(&ids[i], NULL, &runWorker, &starts[i]) == 0;
+    }
+    runWorker(&starts[0]);
+
+    for(int i = 1; i < threads; i++){
+        if(started[i]){
+            pthread_join(ids[i], NULL);
+        }
+    }
+
+    //work left by threads that never started
+    for(int i = 1; i < threads; i++){
+        while(ranges[i].next < ranges[i].end){
+            work(arg, ranges[i].next++, 0);
+        }
+    }
+
+    for(int i = 0; i < threads; i++){
+        pthread_mutex_destroy(&ranges[i].lock);
+    }
+    free(started);
+    free(ranges);
+    free(starts);
+    free(ids);
+
+    return threads;
+}
+
+
+//BATCH PARSING
+
+typedef struct batchJob {
+    CardBatch * batch;
+
+    //one context per worker thread
+    VCardContext * contexts;
+} BatchJob;
+
+static void parseBatchFile(void * arg, int index, int worker){
+
+    BatchJob * job = (BatchJob*)arg;
+    BatchResult * result = &job->batch->results[index];
+    VCardContext * ctx = &job->contexts[worker];
+
+    result->error = createCardWithContext(ctx, result->fileName, &result->card);
+    result->errorLine = ctx->errorLine;
+}
+
+//creates a batch with room for count results, all empty
+static CardBatch * newCardBatch(int count){
+
+    CardBatch * batch = malloc(sizeof(CardBatch));
+    if(batch == NULL){
+        return NULL;
+    }
+
+    batch->count = count;
+    batch->results = calloc(count > 0 ? count : 1, sizeof(BatchResult));
+    if(batch->results == NULL){
+        free(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+//parses every file already named in the batch
+static VCardErrorCode runBatch(CardBatch * batch, int threads, const VCardContext * options){
+
+    if(threads <= 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+
+    VCardContext * contexts = malloc(sizeof(VCardContext) * threads);
+    if(contexts == NULL){
+        return OTHER_ERROR;
+    }
+
+    for(int i = 0; i < threads; i++){
+        if(options != NULL){
+            contexts[i] = *options;
+        } else {
+            initializeContext(&contexts[i]);
+        }
+    }
+
+    BatchJob job = { batch, contexts };
+    runWorkStealing(batch->count, threads, &parseBatchFile, &job);
+
+    free(contexts);
+    return OK;
+}
+
+VCardErrorCode parseCardFiles(const char* const* fileNames, int count, int threads, const VCardContext* options, CardBatch** batch){
+
+    if(batch == NULL || count < 0 || (fileNames == NULL && count > 0)){
+        return OTHER_ERROR;
+    }
+    *batch = NULL;
+
+    CardBatch * newBatch = newCardBatch(count);
+    if(newBatch == NULL){
+        return OTHER_ERROR;
+    }
+
+    for(int i = 0; i < count; i++){
+        newBatch->results[i].fileName = myStrDup(fileNames[i] ? fileNames[i] : "");
+        newBatch->results[i].error = INV_FILE;
+        if(newBatch->results[i].fileName == NULL){
+            deleteCardBatch(newBatch);
+            return OTHER_ERROR;
+        }
+    }
+
+    VCardErrorCode error = runBatch(newBatch, threads, options);
+    if(error != OK){
+        deleteCardBatch(newBatch);
+        return error;
+    }
+
+    *batch = newBatch;
+    return OK;
+}
+
+static int compareNames(const void * first, const void * second){
+    return strcmp(*(char * const *)first, *(char * const *)second);
+}
+
+VCardErrorCode parseCardDirectory(const char* dirName, int threads, const VCardContext* options, CardBatch** batch){
+
+    if(dirName == NULL || batch == NULL){
+        return INV_FILE;
+    }
+    *batch = NULL;
+
+    DIR * dir = opendir(dirName);
+    if(dir == NULL){
+        return INV_FILE;
+    }
+
+    //collect the card files first so they can be split between the threads
+    int count = 0;
+    int capacity = 64;
+    char ** paths = malloc(sizeof(char*) * capacity);
+    size_t dirLength = strlen(dirName);
+
+    //a list cut short by a failed allocation is not reported as the whole directory
+    bool complete = paths != NULL;
+
+    struct dirent * entry;
+    while(complete && (entry = readdir(dir)) != NULL){
+        if(!validFileExtension(entry->d_name)){
+            continue;
+        }
+
+        if(count == capacity){
+            char ** bigger = realloc(paths, sizeof(char*) * capacity * 2);
+            if(bigger == NULL){
+                complete = false;
+                break;
+            }
+            paths = bigger;
+            capacity *= 2;
+        }
+
+        size_t nameLength = strlen(entry->d_name);
+        char * path = malloc(dirLength + nameLength + 2);
+        if(path == NULL){
+            complete = false;
+            break;
+        }
+        memcpy(path, dirName, dirLength);
+        path[dirLength] = '/';
+        memcpy(path + dirLength + 1, entry->d_name, nameLength + 1);
+        paths[count++] = path;
+    }
+    closedir(dir);
+
+    if(!complete){
+        for(int i = 0; i < count; i++){
+            free(paths[i]);
+        }
+        free(paths);
+        return OTHER_ERROR;
+    }
+
+    qsort(paths, count, sizeof(char*), &compareNames);
+
+    //the batch takes over the paths
+    CardBatch * newBatch = newCardBatch(count);
+    if(newBatch == NULL){
+        for(int i = 0; i < count; i++){
+            free(paths[i]);
+        }
+        free(paths);
+        return OTHER_ERROR;
+    }
+
+    for(int i = 0; i < count; i++){
+        newBatch->results[i].fileName = paths[i];
+        newBatch->results[i].error = INV_FILE;
+    }
+    free(paths);
+
+    VCardErrorCode error = runBatch(newBatch, threads, options);
+    if(error != OK){
+        deleteCardBatch(newBatch);
+        return error;
+    }
+
+    *batch = newBatch;
+    return OK;
+}
+
+void deleteCardBatch(CardBatch* batch){
+
+    if(batch == NULL){
+        return;
+    }
+
+    for(int i = 0; i < batch->count; i++){
+        free(batch->results[i].fileName);
+        deleteCard(batch->results[i].card);
+    }
+
+    free(batch->results);
+    free(batch);
+}
+
+
+//BATCH WRITING
+
+//output is written out once this much has been buffered
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+//cards from an array serialized in parallel before they are written, which bounds the memory held at once
+#define WRITE_CHUNK_CARDS 512
+
+typedef struct writeJob {
+    const Card * const * cards;
+    StringBuilder * texts;
+} WriteJob;
+
+static void serializeBatchCard(void * arg, int index, int worker){
+
+    (void)worker;
+    WriteJob * job = (WriteJob*)arg;
+
+    initializeStringBuilder(&job->texts[index], cardTextLength(job->cards[index]));
+    appendCardText(&job->texts[index], job->cards[index]);
+}
+
+//writes out the buffered text and empties the buffer
+static bool flushWriteBuffer(OutputFile * out, StringBuilder * buffer){
+
+    bool written = writeOutputFile(out, buffer->data, buffer->length);
+    buffer->length = 0;
+    buffer->data[0] = '\0';
+    return written;
+}
+
+//copies one serialized card into the buffer, or straight out to the file if it would not fit anyway
+static bool bufferCardText(OutputFile * out, StringBuilder * buffer, const StringBuilder * text){
+
+    if(buffer->length > 0 && buffer->length + text->length > WRITE_BUFFER_SIZE){
+        if(!flushWriteBuffer(out, buffer)){
+            return false;
+        }
+    }
+
+    if(text->length >= WRITE_BUFFER_SIZE){
+        return writeOutputFile(out, text->data, text->length);
+    }
+
+    builderAppendN(buffer, text->data, text->length);
+    return true;
+}
+
+//where the cards to write come from: a whole array, or a stream handing out one card at a time
+typedef struct cardSource {
+    const Card * const * cards;
+    int count;
+    int next;
+    const Card* (*nextCard)(void* data);
+    void * data;
+} CardSource;
+
+static const Card * nextSourceCard(CardSource * source){
+
+    if(source->nextCard != NULL){
+        return source->nextCard(source->data);
+    }
+    if(source->next >= source->count){
+        return NULL;
+    }
+    return source->cards[source->next++];
+}
+
+//serializes straight into the output buffer, which grows past its size only for one huge card.  Each card
+//is done with before the next is asked for, so a stream may free or reuse a card on the following call
+static VCardErrorCode writeCardsInTurn(OutputFile * out, StringBuilder * buffer, CardSource * source){
+
+    const Card * card;
+    while((card = nextSourceCard(source)) != NULL){
+        appendCardText(buffer, card);
+        if(buffer->failed){
+            return OTHER_ERROR;
+        }
+        if(buffer->length >= WRITE_BUFFER_SIZE && !flushWriteBuffer(out, buffer)){
+            return WRITE_ERROR;
+        }
+    }
+    return OK;
+}
+
+//serializes a chunk of the array at a time on threads threads, then writes the chunk out in order
+static VCardErrorCode writeCardsInParallel(OutputFile * out, StringBuilder * buffer, const Card * const * cards, int count, int threads){
+
+    StringBuilder * texts = malloc(sizeof(StringBuilder) * WRITE_CHUNK_CARDS);
+    if(texts == NULL){
+        return OTHER_ERROR;
+    }
+
+    VCardErrorCode error = OK;
+    for(int start = 0; error == OK && start < count; start += WRITE_CHUNK_CARDS){
+        int chunk = count - start < WRITE_CHUNK_CARDS ? count - start : WRITE_CHUNK_CARDS;
+
+        WriteJob job = { cards + start, texts };
+        runWorkStealing(chunk, threads, &serializeBatchCard, &job);
+
+        for(int i = 0; i < chunk; i++){
+            if(error == OK && texts[i].failed){
+                error = OTHER_ERROR;
+            } else if(error == OK && !bufferCardText(out, buffer, &texts[i])){
+                error = WRITE_ERROR;
+            }
+            freeStringBuilder(&texts[i]);
+        }
+    }
+
+    free(texts);
+    return error;
+}
+
+//writes every card from source.  Only an array is serialized in parallel, since every card in it stays
+//valid for the whole write, while a stream card may be gone as soon as the next one is asked for
+static VCardErrorCode writeCards(const char * fileName, CardSource * source, int threads, const VCardContext * options){
+
+    if(fileName == NULL || !validFileExtension(fileName)){
+        return WRITE_ERROR;
+    }
+
+    if(threads <= 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+
+    StringBuilder buffer;
+    initializeStringBuilder(&buffer, WRITE_BUFFER_SIZE);
+    if(buffer.failed){
+        return OTHER_ERROR;
+    }
+
+    OutputFile out;
+    if(!openOutputFile(&out, fileName, options != NULL && options->atomicWrite)){
+        freeStringBuilder(&buffer);
+        return WRITE_ERROR;
+    }
+
+    VCardErrorCode error;
+    if(source->nextCard == NULL && threads > 1){
+        error = writeCardsInParallel(&out, &buffer, source->cards, source->count, threads);
+    } else {
+        error = writeCardsInTurn(&out, &buffer, source);
+    }
+
+    if(error == OK && buffer.length > 0 && !flushWriteBuffer(&out, &buffer)){
+        error = WRITE_ERROR;
+    }
+    freeStringBuilder(&buffer);
+
+    if(!closeOutputFile(&out, error == OK) && error == OK){
+        error = WRITE_ERROR;
+    }
+
+    return error;
+}
+
+VCardErrorCode writeCardStream(const char* fileName, const Card* (*nextCard)(void* data), void* data, int threads, const VCardContext* options){
+
+    if(nextCard == NULL){
+        return WRITE_ERROR;
+    }
+
+    CardSource source = { NULL, 0, 0, nextCard, data };
+    return writeCards(fileName, &source, threads, options);
+}
+
+VCardErrorCode writeCardFileBatch(const char* fileName, const Card* const* cards, int count, int threads, const VCardContext* options){
+
+    if(count < 0 || (cards == NULL && count > 0)){
+        return WRITE_ERROR;
+    }
+
+    //a NULL card would end the write early, so refuse it before anything is written
+    for(int i = 0; i < count; i++){
+        if(cards[i] == NULL){
+            return WRITE_ERROR;
+        }
+    }
+
+    CardSource source = { cards, count, 0, NULL, NULL };
+    return writeCards(fileName, &source, threads, options);
+}
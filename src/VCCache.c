@@ -0,0 +1,440 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCCache.h"
+#include "VCHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+
+
+struct cachedCard {
+    char * fileName;
+    size_t hash;
+
+    //what the file looked like when it was parsed, only the device, inode, size and modification time are compared
+    struct stat info;
+
+    //the result of parsing it, card is NULL unless error is OK
+    VCardErrorCode error;
+    Card * card;
+
+    //memory counted against the budget
+    size_t memory;
+
+    //handles given out and not yet released.  An entry that has left the cache is freed by its last release
+    int references;
+    bool inCache;
+
+    struct cachedCard * nextInBucket;
+
+    //least recently used list, newest first
+    struct cachedCard * newer;
+    struct cachedCard * older;
+};
+
+struct vCardCache {
+    pthread_mutex_t lock;
+
+    //options for every card parsed
+    VCardContext options;
+
+    //entries by file name, chained
+    CachedCard ** buckets;
+    size_t bucketCount;
+
+    CachedCard * newest;
+    CachedCard * oldest;
+
+    size_t entries;
+    size_t memoryUsed;
+    size_t memoryBudget;
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long invalidations;
+};
+
+
+//FNV-1a over the file name
+static size_t hashFileName(const char * fileName){
+
+    size_t hash = 2166136261u;
+    for(const unsigned char * c = (const unsigned char *)fileName; *c != '\0'; c++){
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+static bool sameStat(const struct stat * first, const struct stat * second){
+    return first->st_dev == second->st_dev && first->st_ino == second->st_ino && first->st_size == second->st_size
+        && first->st_mtim.tv_sec == second->st_mtim.tv_sec && first->st_mtim.tv_nsec == second->st_mtim.tv_nsec;
+}
+
+static CachedCard * findEntry(VCardCache * cache, const char * fileName, size_t hash){
+
+    CachedCard * entry = cache->buckets[hash & (cache->bucketCount - 1)];
+    while(entry != NULL && (entry->hash != hash || strcmp(entry->fileName, fileName) != 0)){
+        entry = entry->nextInBucket;
+    }
+    return entry;
+}
+
+static void freeEntry(CachedCard * entry){
+    deleteCard(entry->card);
+    free(entry->fileName);
+    free(entry);
+}
+
+//takes an entry out of the table and the LRU list, freeing it unless a handle to it is still out
+static void removeEntry(VCardCache * cache, CachedCard * entry){
+
+    CachedCard ** link = &cache->buckets[entry->hash & (cache->bucketCount - 1)];
+    while(*link != entry){
+        link = &(*link)->nextInBucket;
+    }
+    *link = entry->nextInBucket;
+
+    if(entry->newer != NULL){
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if(entry->older != NULL){
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+
+    cache->entries--;
+    cache->memoryUsed -= entry->memory;
+    entry->inCache = false;
+
+    if(entry->references == 0){
+        freeEntry(entry);
+    }
+}
+
+//puts an entry at the newest end of the LRU list
+static void makeNewest(VCardCache * cache, CachedCard * entry){
+
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if(cache->newest != NULL){
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+static void touchEntry(VCardCache * cache, CachedCard * entry){
+
+    if(cache->newest == entry){
+        return;
+    }
+
+    //unlink, it cannot be the newest so it always has a newer neighbour
+    entry->newer->older = entry->older;
+    if(entry->older != NULL){
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+
+    makeNewest(cache, entry);
+}
+
+//doubles the table once it is three quarters full, keeping chains short
+static void growBuckets(VCardCache * cache){
+
+    if(cache->entries * 4 < cache->bucketCount * 3){
+        return;
+    }
+
+    size_t count = cache->bucketCount * 2;
+    CachedCard ** buckets = calloc(count, sizeof(CachedCard*));
+    if(buckets == NULL){
+        //the chains just get longer
+        return;
+    }
+
+    for(size_t i = 0; i < cache->bucketCount; i++){
+        CachedCard * entry = cache->buckets[i];
+        while(entry != NULL){
+            CachedCard * next = entry->nextInBucket;
+            entry->nextInBucket = buckets[entry->hash & (count - 1)];
+            buckets[entry->hash & (count - 1)] = entry;
+            entry = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucketCount = count;
+}
+
+static void addEntry(VCardCache * cache, CachedCard * entry){
+
+    size_t bucket = entry->hash & (cache->bucketCount - 1);
+    entry->nextInBucket = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    makeNewest(cache, entry);
+
+    entry->inCache = true;
+    cache->entries++;
+    cache->memoryUsed += entry->memory;
+
+    growBuckets(cache);
+}
+
+static void evictOverBudget(VCardCache * cache){
+
+    while(cache->memoryUsed > cache->memoryBudget && cache->oldest != NULL){
+        removeEntry(cache, cache->oldest);
+        cache->evictions++;
+    }
+}
+
+//makes a new entry for a file that has just been parsed
+static CachedCard * newEntry(const char * fileName, size_t hash, const struct stat * info, VCardErrorCode error, Card * card){
+
+    CachedCard * entry = calloc(1, sizeof(CachedCard));
+    if(entry == NULL){
+        return NULL;
+    }
+
+    entry->fileName = myStrDup(fileName);
+    if(entry->fileName == NULL){
+        free(entry);
+        return NULL;
+    }
+
+    entry->hash = hash;
+    entry->info = *info;
+    entry->error = error;
+    entry->card = card;
+
+    entry->memory = sizeof(CachedCard) + strlen(fileName) + 1;
+    if(card != NULL && card->arena != NULL){
+        entry->memory += arenaSize(card->arena);
+    }
+
+    return entry;
+}
+
+
+VCardCache* createCardCache(size_t memoryBudget, const VCardContext* options){
+
+    VCardCache * cache = calloc(1, sizeof(VCardCache));
+    if(cache == NULL){
+        return NULL;
+    }
+
+    cache->bucketCount = 64;
+    cache->buckets = calloc(cache->bucketCount, sizeof(CachedCard*));
+    if(cache->buckets == NULL){
+        free(cache);
+        return NULL;
+    }
+
+    if(options != NULL){
+        cache->options = *options;
+    } else {
+        initializeContext(&cache->options);
+    }
+    cache->options.useArena = true;
+
+    cache->memoryBudget = memoryBudget;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    return cache;
+}
+
+VCardErrorCode getCachedCard(VCardCache* cache, const char* fileName, CachedCard** entry){
+
+    if(entry != NULL){
+        *entry = NULL;
+    }
+    if(cache == NULL || fileName == NULL || entry == NULL){
+        return INV_FILE;
+    }
+
+    size_t hash = hashFileName(fileName);
+
+    //a file that cannot be looked at cannot be parsed either, and whatever was cached for it is gone
+    struct stat before;
+    if(stat(fileName, &before) != 0){
+        pthread_mutex_lock(&cache->lock);
+        CachedCard * gone = findEntry(cache, fileName, hash);
+        if(gone != NULL){
+            removeEntry(cache, gone);
+            cache->invalidations++;
+        }
+        cache->misses++;
+        pthread_mutex_unlock(&cache->lock);
+        return INV_FILE;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    CachedCard * found = findEntry(cache, fileName, hash);
+    if(found != NULL && sameStat(&found->info, &before)){
+        VCardErrorCode error = found->error;
+        touchEntry(cache, found);
+        if(found->card != NULL){
+            found->references++;
+            *entry = found;
+        }
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return error;
+    }
+
+    //the file changed since it was cached
+    if(found != NULL){
+        removeEntry(cache, found);
+        cache->invalidations++;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    //parse without the lock, so other lookups are not held up
+    VCardContext ctx = cache->options;
+    Card * card = NULL;
+    VCardErrorCode error = createCardWithContext(&ctx, (char *)fileName, &card);
+
+    //only keep the result if the file did not change while it was being read
+    struct stat after;
+    bool unchanged = stat(fileName, &after) == 0 && sameStat(&before, &after);
+
+    CachedCard * parsed = newEntry(fileName, hash, &before, error, card);
+    if(parsed == NULL){
+        deleteCard(card);
+        return OTHER_ERROR;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    if(card != NULL){
+        parsed->references = 1;
+        *entry = parsed;
+    }
+
+    if(unchanged){
+        //another thread may have cached the same file while this one was parsing
+        CachedCard * other = findEntry(cache, fileName, hash);
+        if(other != NULL){
+            removeEntry(cache, other);
+        }
+        addEntry(cache, parsed);
+        evictOverBudget(cache);
+    } else if(card == NULL){
+        freeEntry(parsed);
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return error;
+}
+
+const Card* cachedCardOf(const CachedCard* entry){
+    return entry != NULL ? entry->card : NULL;
+}
+
+void releaseCachedCard(VCardCache* cache, CachedCard* entry){
+
+    if(cache == NULL || entry == NULL){
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    entry->references--;
+    if(entry->references == 0 && !entry->inCache){
+        freeEntry(entry);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+bool invalidateCachedCard(VCardCache* cache, const char* fileName){
+
+    if(cache == NULL || fileName == NULL){
+        return false;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    CachedCard * entry = findEntry(cache, fileName, hashFileName(fileName));
+    if(entry != NULL){
+        removeEntry(cache, entry);
+        cache->invalidations++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return entry != NULL;
+}
+
+void clearCardCache(VCardCache* cache){
+
+    if(cache == NULL){
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    while(cache->oldest != NULL){
+        removeEntry(cache, cache->oldest);
+        cache->invalidations++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void setCardCacheBudget(VCardCache* cache, size_t memoryBudget){
+
+    if(cache == NULL){
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->memoryBudget = memoryBudget;
+    evictOverBudget(cache);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void getCardCacheStats(VCardCache* cache, CardCacheStats* stats){
+
+    if(stats == NULL){
+        return;
+    }
+    memset(stats, 0, sizeof(CardCacheStats));
+
+    if(cache == NULL){
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->invalidations = cache->invalidations;
+    stats->entries = cache->entries;
+    stats->memoryUsed = cache->memoryUsed;
+    stats->memoryBudget = cache->memoryBudget;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void deleteCardCache(VCardCache* cache){
+
+    if(cache == NULL){
+        return;
+    }
+
+    CachedCard * entry = cache->newest;
+    while(entry != NULL){
+        CachedCard * older = entry->older;
+        freeEntry(entry);
+        entry = older;
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
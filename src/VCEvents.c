@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "VCEvents.h"
+#include "VCHelpers.h"
+
+
+//state for one parse, the span arrays are reused for every property
+typedef struct eventParse {
+    VCardContext * ctx;
+    const VCardEvents * events;
+    void * eventData;
+
+    VCardSpan group;
+    VCardSpan name;
+
+    VCardParameterSpan * parameters;
+    int parameterCount;
+    int parameterCapacity;
+
+    VCardSpan * values;
+    int valueCount;
+    int valueCapacity;
+
+    //set when the sink has been given a property for the current line
+    bool gotProperty;
+    bool foundFN;
+
+    //set when a callback asked to stop
+    bool stopped;
+} EventParse;
+
+
+//makes room for one more element in a span array
+static bool growSpans(void ** array, int * capacity, int count, size_t elementSize){
+
+    if(count < *capacity){
+        return true;
+    }
+
+    int newCapacity = *capacity ? *capacity * 2 : 16;
+    void * grown = realloc(*array, newCapacity * elementSize);
+    if(grown == NULL){
+        return false;
+    }
+
+    *array = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+static bool startEventProperty(void * sinkData, const char * group, size_t groupLength, const char * name, size_t nameLength){
+
+    EventParse * parse = sinkData;
+
+    parse->group = (VCardSpan){ group, groupLength };
+    parse->name = (VCardSpan){ name, nameLength };
+    parse->parameterCount = 0;
+    parse->valueCount = 0;
+    parse->gotProperty = true;
+    return true;
+}
+
+static bool addEventParameter(void * sinkData, const char * name, size_t nameLength, const char * value, size_t valueLength){
+
+    EventParse * parse = sinkData;
+
+    if(!growSpans((void**)&parse->parameters, &parse->parameterCapacity, parse->parameterCount, sizeof(VCardParameterSpan))){
+        return false;
+    }
+
+    parse->parameters[parse->parameterCount++] = (VCardParameterSpan){ { name, nameLength }, { value, valueLength } };
+    return true;
+}
+
+static bool addEventValue(void * sinkData, const char * value, size_t length){
+
+    EventParse * parse = sinkData;
+
+    if(!growSpans((void**)&parse->values, &parse->valueCapacity, parse->valueCount, sizeof(VCardSpan))){
+        return false;
+    }
+
+    parse->values[parse->valueCount++] = (VCardSpan){ value, length };
+    return true;
+}
+
+static const LineSink eventLineSink = { &startEventProperty, &addEventParameter, &addEventValue };
+
+
+//checks the property just tokenized the same way parseSingleVCardLine does and passes it on
+static bool emitProperty(EventParse * parse){
+
+    VCardContext * ctx = parse->ctx;
+    VCardSpan * name = &parse->name;
+    PropertyId id = propertyIdFromName(name->data, name->length);
+
+    if(id == PROP_VERSION){
+        //only 4.0 is supported, and the version is not passed on
+        VCardSpan * version = &parse->values[0];
+        if(version->length != 3 || memcmp(version->data, "4.0", 3) != 0){
+            ctx->error = INV_CARD;
+            return false;
+        }
+
+        ctx->foundVersion = true;
+        return true;
+    }
+
+    if(id == PROP_FN){
+        parse->foundFN = true;
+    }
+
+    if(parse->events->property != NULL && !parse->events->property(parse->eventData, &parse->group, name,
+            parse->parameters, parse->parameterCount, parse->values, parse->valueCount)){
+        parse->stopped = true;
+    }
+    return true;
+}
+
+//records an error for the card being parsed and returns it
+static VCardErrorCode eventError(VCardContext * ctx, VCardErrorCode error, int line){
+    ctx->error = error;
+    ctx->errorLine = line;
+    return error;
+}
+
+/*
+    Reads lines until one whole card has been passed on or the input runs out, like parseNextCard does.
+    Returns OK without setting foundBegin in the context when there are no cards left
+*/
+static VCardErrorCode nextCardEvents(InputBuffer * in, EventParse * parse){
+
+    VCardContext * ctx = parse->ctx;
+    const VCardEvents * events = parse->events;
+
+    resetCardState(ctx);
+    parse->foundFN = false;
+
+    while(!ctx->done && !parse->stopped){
+
+        const char * line = NULL;
+        size_t length = 0;
+        LineResult result = nextUnfoldedLine(in, &line, &length);
+
+        if(result == LINE_EOF){
+            break;
+        }
+
+        if(result == LINE_BAD_ENDING){
+            return eventError(ctx, INV_CARD, in->lineNumber);
+        }
+
+        if(result == LINE_NO_MEMORY){
+            return eventError(ctx, OTHER_ERROR, in->lineNumber);
+        }
+
+        //blank lines are skipped
+        if(length == 0){
+            continue;
+        }
+
+        bool inCard = ctx->foundBegin;
+        CardLineKind kind = cardLineKind(line, length, ctx);
+
+        if(kind == CARD_LINE_INVALID){
+            return eventError(ctx, ctx->error, in->lineNumber);
+        }
+
+        if(kind == CARD_LINE_BEGIN && !inCard){
+            if(events->beginCard != NULL && !events->beginCard(parse->eventData, in->lineNumber)){
+                parse->stopped = true;
+            }
+        } else if(kind == CARD_LINE_PROPERTY){
+            parse->gotProperty = false;
+            if(!tokenizePropertyLine(line, length, ctx, &eventLineSink, parse)){
+                return eventError(ctx, ctx->error, in->lineNumber);
+            }
+
+            //lines left out by the projection never reach the sink
+            if(parse->gotProperty && !emitProperty(parse)){
+                return eventError(ctx, ctx->error, in->lineNumber);
+            }
+        }
+    }
+
+    if(parse->stopped || !ctx->foundBegin){
+        return OK;
+    }
+
+    //same checks as a parsed card gets
+    if(!ctx->foundEnd || !parse->foundFN || !ctx->foundVersion){
+        return eventError(ctx, INV_CARD, 0);
+    }
+
+    if(events->endCard != NULL && !events->endCard(parse->eventData, in->lineNumber)){
+        parse->stopped = true;
+    }
+    return OK;
+}
+
+
+VCardErrorCode parseCardEvents(VCardContext* ctx, const char* fileName, const VCardEvents* events, void* eventData){
+
+    if(ctx == NULL || events == NULL){
+        return OTHER_ERROR;
+    }
+    resetCardState(ctx);
+
+    //same extension rules as createCard
+    if(fileName == NULL || !validFileExtension(fileName)){
+        return eventError(ctx, INV_FILE, 0);
+    }
+
+    InputBuffer in;
+    if(!openInputBuffer(fileName, &in)){
+        return eventError(ctx, INV_FILE, 0);
+    }
+
+    EventParse parse;
+    memset(&parse, 0, sizeof(EventParse));
+    parse.ctx = ctx;
+    parse.events = events;
+    parse.eventData = eventData;
+
+    VCardErrorCode result = OK;
+
+    while(!parse.stopped){
+        VCardErrorCode error = nextCardEvents(&in, &parse);
+
+        if(error == OTHER_ERROR){
+            result = OTHER_ERROR;
+            break;
+        }
+
+        if(error != OK){
+            if(events->cardError != NULL && !events->cardError(eventData, error, ctx->errorLine)){
+                break;
+            }
+
+            //carry on after the broken card
+            if(!ctx->foundEnd){
+                skipRestOfCard(&in);
+            }
+        } else if(!ctx->foundBegin){
+            //no cards left
+            break;
+        }
+    }
+
+    free(parse.parameters);
+    free(parse.values);
+    closeInputBuffer(&in);
+    return result;
+}
@@ -1,303 +1,404 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "VCHelpers.h"
+#include "VCScan.h"
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+
+
+
+//moves start and length inwards past any leading and trailing whitespace, same rules as trimWhiteSpace
+static void trimSpan(const char ** start, size_t * length){
+
+    const char * str = *start;
+    const char * end = str + *length;
+
+    while(str < end && isspace((unsigned char)*str)){
+        str++;
+    }
+    while(end > str && isspace((unsigned char)*(end - 1))){
+        end--;
+    }
+
+    *start = str;
+    *length = end - str;
+}
+
+
+//checks a parameter token running from start up to end and hands it to the sink
+static bool tokenParameter(VCardContext * ctx, const LineSink * sink, void * sinkData, const char * start, const char * equalsPtr, const char * end){
+
+    //empty tokens between semicolons are skipped
+    if(start == end){
+        return true;
+    }
+
+    //each parameter must have a name=value pair, and neither may be empty
+    if(!equalsPtr || equalsPtr == start || equalsPtr + 1 == end){
+        ctx->error = INV_PROP;
+        return false;
+    }
+
+    if(!sink->parameter(sinkData, start, equalsPtr - start, equalsPtr + 1, end - equalsPtr - 1)){
+        ctx->error = OTHER_ERROR;
+        return false;
+    }
+    return true;
+}
+
+//trims the value token running from start up to end and hands it to the sink
+static bool tokenValue(VCardContext * ctx, const LineSink * sink, void * sinkData, const char * start, const char * end){
+
+    //empty tokens are preserved as empty strings
+    size_t tokenLength = end - start;
+    trimSpan(&start, &tokenLength);
+
+    if(!sink->value(sinkData, start, tokenLength)){
+        ctx->error = OTHER_ERROR;
+        return false;
+    }
+    return true;
+}
+
+
+//checks whether a property should be parsed.  FN and VERSION always are, since every card needs them
+static bool wantedProperty(const VCardContext * ctx, const char * name, size_t length){
+
+    if(ctx->wantedCount <= 0){
+        return true;
+    }
+
+    PropertyId id = propertyIdFromName(name, length);
+    if(id == PROP_FN || id == PROP_VERSION){
+        return true;
+    }
+
+    for(int i = 0; i < ctx->wantedCount; i++){
+        const char * wanted = ctx->wantedProperties[i];
+        if(strlen(wanted) == length && strncasecmp(wanted, name, length) == 0){
+            return true;
+        }
+    }
 
+    return false;
+}
 
 
+CardLineKind cardLineKind(const char * line, size_t length, VCardContext * ctx){
 
-bool parseSingleVCardLine(const char * line, Card * card, bool * foundBegin, bool * foundEnd, bool * doneFlag, bool * foundVersion){
+    //the line is a span into the input, so it is not NUL terminated and every search is bounded by lineEnd
+    const char * lineEnd = line + length;
 
     //check for begin and end here
     
-    if(strncasecmp(line, "BEGIN:", 6) == 0){
+    if(length >= 6 && strncasecmp(line, "BEGIN:", 6) == 0){
         //skip any spaces after begin
         const char * beginPtr = line + 6;
-        while(*beginPtr == ' ' || *beginPtr == '\t'){
+        while(beginPtr < lineEnd && (*beginPtr == ' ' || *beginPtr == '\t')){
             beginPtr++;
         }
 
         //now can see whats left is vcard
-        if(strncasecmp(beginPtr, "VCARD", 5) == 0){
-            *foundBegin = true;
-            return true;
+        if(lineEnd - beginPtr >= 5 && strncasecmp(beginPtr, "VCARD", 5) == 0){
+            ctx->foundBegin = true;
+            return CARD_LINE_BEGIN;
         } else {
             //invalid begin
-            globalError = INV_CARD;
-            return false;
+            ctx->error = INV_CARD;
+            return CARD_LINE_INVALID;
         }
     }
 
     //check for end tag
-    if(strncasecmp(line, "END:", 4) == 0){
+    if(length >= 4 && strncasecmp(line, "END:", 4) == 0){
         //skip any spaces after end
         const char * endPtr = line + 4;
-        while(*endPtr == ' ' || *endPtr == '\t'){
+        while(endPtr < lineEnd && (*endPtr == ' ' || *endPtr == '\t')){
             endPtr++;
         }
 
         //now can see whats left is vcard
-        if(strncasecmp(endPtr, "VCARD", 5) == 0){
-            if(!(*foundBegin)){
+        if(lineEnd - endPtr >= 5 && strncasecmp(endPtr, "VCARD", 5) == 0){
+            if(!ctx->foundBegin){
                 //invalid end
-                globalError = INV_CARD;
-                return false;
+                ctx->error = INV_CARD;
+                return CARD_LINE_INVALID;
             }
-            *foundEnd = true;
-            *doneFlag = true;
-            return true;
+            ctx->foundEnd = true;
+            ctx->done = true;
+            return CARD_LINE_END;
         } else {
             //invalid end
-            globalError = INV_CARD;
-            return false;
+            ctx->error = INV_CARD;
+            return CARD_LINE_INVALID;
         }
     }
 
     //if we havent found begin yet then treat as invalid
-    if(!(*foundBegin)){
-        return true;
+    if(!ctx->foundBegin){
+        return CARD_LINE_OUTSIDE;
     }
 
-    //otherwise parse the property line
-    //find colon
-    char * colonPtr = strchr(line, ':');
-    if(!colonPtr){
-        globalError = INV_PROP;
-        return false; //no colon means invalid
-    }
+    return CARD_LINE_PROPERTY;
+}
 
 
-    //copy the line into a buffer then split it at the colon
-    char buffer[1024];
-    strncpy(buffer, line, sizeof(buffer));
-    buffer[sizeof(buffer) - 1] = '\0';
-    char * colonPtr2 = strchr(buffer, ':');
+bool tokenizePropertyLine(const char * line, size_t length, VCardContext * ctx, const LineSink * sink, void * sinkData){
 
-    //check if the colon is at the end of the line
-    if(colonPtr2 == NULL){
-        globalError = INV_PROP;
-        return false;
-    }
-    *colonPtr2 = '\0';
+    const char * lineEnd = line + length;
+
+    //walk the delimiters of the line in a single pass
+    //before the first colon they mark out the group, name and parameters, and after it they split the values
+    DelimiterCursor cursor;
+    startDelimiterCursor(&cursor, line, length);
 
+    const char * colonPtr = NULL;
+    const char * nameEnd = NULL;
+    const char * dotPtr = NULL;
+    const char * delim;
 
-    char * propParams = buffer;
+    //the name comes first, so unwanted properties can be skipped before anything is allocated
+    while((delim = nextDelimiter(&cursor)) != NULL){
+        if(*delim == ':' || *delim == ';'){
+            nameEnd = delim;
+            break;
+        } else if(*delim == '.' && dotPtr == NULL){
+            dotPtr = delim;
+        }
+    }
 
-    //check length of propParams
-    if(strlen(propParams) == 0){
-        globalError = INV_PROP;
+    //no colon means invalid, as does nothing before it
+    if(nameEnd == NULL || (*nameEnd == ':' && nameEnd == line)){
+        ctx->error = INV_PROP;
         return false;
     }
-    char * propValue = colonPtr2 + 1;
 
+    //trim the property name to remove leading and trailing whitespace
+    const char * nameStart = dotPtr ? dotPtr + 1 : line;
+    size_t nameLength = nameEnd - nameStart;
+    trimSpan(&nameStart, &nameLength);
+
+    if(!wantedProperty(ctx, nameStart, nameLength)){
+        //a skipped line still needs its colon
+        if(*nameEnd != ':' && memchr(nameEnd, ':', lineEnd - nameEnd) == NULL){
+            ctx->error = INV_PROP;
+            return false;
+        }
+        return true;
+    }
 
-    //before tokenzing values, trim the property value
-    char * trimmedPropvalue = trimWhiteSpace(propValue);
+    //if a dot is present then the text before it is the group
+    size_t groupLength = dotPtr ? (size_t)(dotPtr - line) : 0;
+    if(!sink->property(sinkData, line, groupLength, nameStart, nameLength)){
+        ctx->error = OTHER_ERROR;
+        return false;
+    }
 
 
+    //then the parameters and values
+    const char * paramStart = nameEnd + 1;
+    const char * equalsPtr = NULL;
+    const char * valueStart = nameEnd + 1;
+    if(*nameEnd == ':'){
+        colonPtr = nameEnd;
+    }
 
+    //a backslash escapes the delimiter right after it
+    const char * escaped = NULL;
 
+    while((delim = nextDelimiter(&cursor)) != NULL){
+        char c = *delim;
 
-    //create the new property with it
-    Property * newProp = malloc(sizeof(Property));
-    if(!newProp){
-        globalError = OTHER_ERROR;
-        free(trimmedPropvalue);
-        return false;
-    }
+        if(colonPtr == NULL){
+            //parameters
+            if(c == ':' || c == ';'){
+                if(!tokenParameter(ctx, sink, sinkData, paramStart, equalsPtr, delim)){
+                    return false;
+                }
 
-    //initialize the property
-    newProp->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
-    newProp->values = initializeList(&valueToString, &deleteValue, &compareValues);
-    newProp->group = NULL;
-    newProp->name = NULL;
-
-
-
-    //parse the property name
-    char * semicolonPtr = strchr(propParams, ';');
-    if(semicolonPtr){
-        *semicolonPtr = '\0';
-        newProp->name = myStrDup(propParams);
-
-        char * paramSubstring = semicolonPtr + 1;
-        char * paramToken = strtok(paramSubstring, ";");
-
-        while(paramToken){
-            //each parameter must have a name=value pair
-            char * equalsPtr = strchr(paramToken, '=');
-            if(!equalsPtr){
-                globalError = INV_PROP;
-                free(newProp->name);
-                freeList(newProp->parameters);
-                freeList(newProp->values);
-                free(newProp);
-                free(trimmedPropvalue);
-                return false;
-            }
-            *equalsPtr = '\0';
-
-            //ensures neither parameter name or value is empty
-            if(strlen(paramToken) == 0 || strlen(equalsPtr + 1) == 0){
-                globalError = INV_PROP;
-                free(newProp->name);
-                freeList(newProp->parameters);
-                freeList(newProp->values);
-                free(newProp);
-                free(trimmedPropvalue);
-                return false;
+                paramStart = delim + 1;
+                equalsPtr = NULL;
+
+                if(c == ':'){
+                    colonPtr = delim;
+                    valueStart = delim + 1;
+                }
+            } else if(c == '=' && equalsPtr == NULL){
+                equalsPtr = delim;
             }
-            Parameter * p = malloc(sizeof(Parameter));
-            if(!p){
-                globalError = OTHER_ERROR;
-                free(newProp->name);
-                freeList(newProp->parameters);
-                freeList(newProp->values);
-                free(newProp);
-                free(trimmedPropvalue);
+        } else if(delim == escaped){
+            //escaped delimiters are part of the value
+            escaped = NULL;
+        } else if(c == '\\'){
+            escaped = delim + 1;
+        } else if(c == ';'){
+            //for all properties including N process every token
+            if(!tokenValue(ctx, sink, sinkData, valueStart, delim)){
                 return false;
             }
-
-            //initialize the parameter
-            p->name = myStrDup(paramToken);
-            p->value = myStrDup(equalsPtr + 1);
-            insertBack(newProp->parameters, p);
-            paramToken = strtok(NULL, ";");
+            valueStart = delim + 1;
         }
-    } else {
-        //no parameter so simply duplicate the property name
-        newProp->name = myStrDup(propParams);
     }
 
-
-    //handle group names, if a dot is present then split into group and actual property name
-    char * dotPtr = strchr(newProp->name, '.');
-    if(dotPtr){
-        *dotPtr = '\0';
-        newProp->group = myStrDup(newProp->name);
-        char * tempName = myStrDup(dotPtr + 1);
-        free(newProp->name);
-        newProp->name = tempName;
-    }
-    //ensure group is now null
-    if(newProp->group == NULL){
-        newProp->group = myStrDup("");
+    //no colon after the parameters
+    if(colonPtr == NULL){
+        ctx->error = INV_PROP;
+        return false;
     }
 
+    //the last value runs to the end of the line
+    return tokenValue(ctx, sink, sinkData, valueStart, lineEnd);
+}
 
-    //trim the property name to remove leading and trailing whitespace
-    char * trimmedName = trimWhiteSpace(newProp->name);
-    free(newProp->name);
-    newProp->name = trimmedName;
-    
 
+//the property a line is being built into
+typedef struct cardLineState {
+    Card * card;
+    Property * prop;
+} CardLineState;
 
-    //parse the property value, using the trimmed property value
-    char tempValue[1024];
-    strncpy(tempValue, propValue, sizeof(tempValue) - 1);
-    tempValue[sizeof(tempValue) - 1] = '\0';
-    free(trimmedPropvalue);
+//insertBack does not say when it could not get a node, so check the length moved
+static bool appendToList(List * list, void * data){
+    int length = getLength(list);
+    insertBack(list, data);
+    return getLength(list) > length;
+}
 
+//creates the property once the line's name is known
+static bool startCardProperty(void * sinkData, const char * group, size_t groupLength, const char * name, size_t nameLength){
 
+    CardLineState * state = sinkData;
+    Card * card = state->card;
 
+    //create the new property with it
+    Property * newProp = cardAlloc(card, sizeof(Property));
+    if(!newProp){
+        return false;
+    }
 
-    //tokenize the values
-    
+    //initialize the property
+    newProp->parameters = cardList(card, &parameterToString, &deleteParameter, &compareParameters);
+    newProp->values = cardList(card, &valueToString, &deleteValue, &compareValues);
+    newProp->group = cardStrNDup(card, group, groupLength);
+    newProp->name = cardStrNDup(card, name, nameLength);
+    newProp->id = propertyIdFromName(name, nameLength);
+
+    //whatever was allocated goes again if any part is missing
+    if(!newProp->parameters || !newProp->values || !newProp->group || !newProp->name){
+        discardProperty(card, newProp);
+        return false;
+    }
 
-    char * start = tempValue;
-    char * pos = NULL;
-    //for all properties including N process every token
-    //the strpbrk function is better than strtok since it can handle multiple delimiters
-    while((pos = strpbrk(start, ";")) != NULL){
+    state->prop = newProp;
+    return true;
+}
 
-        size_t tokenLength = pos - start;
-        char * token = malloc(tokenLength + 1);
-        if(!token){
-            globalError = OTHER_ERROR;
-            break;
+static bool addCardParameter(void * sinkData, const char * name, size_t nameLength, const char * value, size_t valueLength){
+
+    CardLineState * state = sinkData;
+
+    Parameter * p = cardAlloc(state->card, sizeof(Parameter));
+    if(!p){
+        return false;
+    }
+
+    //initialize the parameter
+    p->name = cardStrNDup(state->card, name, nameLength);
+    p->value = cardStrNDup(state->card, value, valueLength);
+    if(!p->name || !p->value || !appendToList(state->prop->parameters, p)){
+        if(state->card->arena == NULL){
+            deleteParameter(p);
         }
+        return false;
+    }
+    return true;
+}
 
-        strncpy(token, start, tokenLength);
-        token[tokenLength] = '\0';
+static bool addCardValue(void * sinkData, const char * value, size_t length){
 
-        //trim the token to preverse empty tokens as empty strings
-        char * trimmedToken = trimWhiteSpace(token);
-        free(token);
+    CardLineState * state = sinkData;
 
-        //insert back even if it is empty
-        insertBack(newProp->values, trimmedToken);
-        start = pos + 1; 
+    char * copy = cardStrNDup(state->card, value, length);
+    if(!copy){
+        return false;
+    }
+
+    if(!appendToList(state->prop->values, copy)){
+        if(state->card->arena == NULL){
+            free(copy);
+        }
+        return false;
     }
-    //process the final token
-    char * token = trimWhiteSpace(start);
-    insertBack(newProp->values, token);
+    return true;
+}
 
+static const LineSink cardLineSink = { &startCardProperty, &addCardParameter, &addCardValue };
 
 
-    //|| strlen((char*)getFromFront(newProp->values)) == 0
+bool parseSingleVCardLine(const char * line, size_t length, Card * card, VCardContext * ctx){
 
+    CardLineKind kind = cardLineKind(line, length, ctx);
+    if(kind == CARD_LINE_INVALID){
+        return false;
+    }
+    if(kind != CARD_LINE_PROPERTY){
+        return true;
+    }
 
-    //check at least one value exists
-    if(getLength(newProp->values) == 0){
-        globalError = INV_PROP;
-        free(newProp->name);
-        free(newProp->group);
-        freeList(newProp->parameters);
-        freeList(newProp->values);
-        free(newProp);
+    //otherwise parse the property line
+    CardLineState state = { card, NULL };
+    if(!tokenizePropertyLine(line, length, ctx, &cardLineSink, &state)){
+        if(state.prop){
+            discardProperty(card, state.prop);
+        }
         return false;
     }
 
+    //the property was left out by the projection
+    if(state.prop == NULL){
+        return true;
+    }
+
+    Property * newProp = state.prop;
 
     //special handling for certain property names like BDAY and ANNIVERSARY
-    if(strcasecmp(newProp->name, "VERSION") == 0){
-        
-        //check if the version property is exactly one value and it equals 4.0
-        if(getLength(newProp->values) < 1){
-            globalError = INV_PROP;
-            free(newProp->name);
-            free(newProp->group);
-            freeList(newProp->parameters);
-            freeList(newProp->values);
-            free(newProp);
-            return false;
-        }
+    if(newProp->id == PROP_VERSION){
 
         char * versionVal = (char*)getFromFront(newProp->values);
         //check if the version is 4.0
         if(strcmp(versionVal, "4.0") != 0){
-            globalError = INV_CARD;
-            free(newProp->name);
-            free(newProp->group);
-            freeList(newProp->parameters);
-            freeList(newProp->values);
-            free(newProp);
+            ctx->error = INV_CARD;
+            discardProperty(card, newProp);
             return false;
         }
 
-        *foundVersion = true;
+        ctx->foundVersion = true;
 
         //version is valid
         //delete the property since it is not needed
-        free(newProp->name);
-        free(newProp->group);
-        freeList(newProp->parameters);
-        freeList(newProp->values);
-        free(newProp);
+        discardProperty(card, newProp);
         return true;
 
-    } else if(strcasecmp(newProp->name, "FN") == 0){
-        //first FN property is stored in card->fn
+    } else if(newProp->id == PROP_FN && card->fn == NULL){
+        //first FN property is stored in card->fn, any others go into the optional properties
         card->fn = newProp;
-    } else if(strcasecmp(newProp->name, "BDAY") == 0 || strcasecmp(newProp->name, "ANNIVERSARY") == 0){
+        indexProperty(card, newProp);
+    } else if(newProp->id == PROP_BDAY || newProp->id == PROP_ANNIVERSARY){
         //for bday and anniversary, created a stub date time struct
-        DateTime * dt = malloc(sizeof(DateTime));
+        DateTime * dt = cardAlloc(card, sizeof(DateTime));
 
         if(!dt){
-            globalError = OTHER_ERROR;
-            deleteProperty(newProp);
+            ctx->error = OTHER_ERROR;
+            discardProperty(card, newProp);
             return false;
         }
         dt->UTC = false;
@@ -312,51 +413,59 @@ bool parseSingleVCardLine(const char * line, Card * card, bool * foundBegin, boo
         if(tPtr != NULL){
             dt->isText = false;
             //parse the date time
-            size_t dateLength = tPtr - propVal;
-            dt->date = malloc(dateLength + 1);
-
-            if(dt->date){
-                strncpy(dt->date, propVal, dateLength);
-                dt->date[dateLength] = '\0';
-            } else {
-                dt->date = myStrDup("");
-            }
+            dt->date = cardStrNDup(card, propVal, tPtr - propVal);
 
             //parse the time
-            dt->time = myStrDup(tPtr + 1);
-            dt->text = myStrDup("");
+            dt->time = cardStrNDup(card, tPtr + 1, strlen(tPtr + 1));
+            dt->text = cardStrNDup(card, "", 0);
 
         
         } else if(propVal && propVal[0] == '-' && propVal[1] == '-'){
             dt->isText = false;
-            dt->date = myStrDup(propVal);
-            dt->time = myStrDup("");
-            dt->text = myStrDup("");
+            dt->date = cardStrNDup(card, propVal, strlen(propVal));
+            dt->time = cardStrNDup(card, "", 0);
+            dt->text = cardStrNDup(card, "", 0);
         } else if(propVal && !isdigit((unsigned char)propVal[0])){
             //otherwise the first character is not a digit
             dt->isText = true;
-            dt->date = myStrDup("");
-            dt->time = myStrDup("");
-            dt->text = myStrDup(propVal);
+            dt->date = cardStrNDup(card, "", 0);
+            dt->time = cardStrNDup(card, "", 0);
+            dt->text = cardStrNDup(card, propVal, strlen(propVal));
         } else {
             //otherwise it is a date
             dt->isText = false;
-            dt->date = myStrDup(propVal);
-            dt->time = myStrDup("");
-            dt->text = myStrDup("");
+            dt->date = cardStrNDup(card, propVal, strlen(propVal));
+            dt->time = cardStrNDup(card, "", 0);
+            dt->text = cardStrNDup(card, "", 0);
+        }
+
+        if(!dt->date || !dt->time || !dt->text){
+            ctx->error = OTHER_ERROR;
+            discardDate(card, dt);
+            discardProperty(card, newProp);
+            return false;
         }
 
-        //set the date time in the card
-        if(strcasecmp(newProp->name, "BDAY") == 0){
+        //set the date time in the card, a repeated date replaces the earlier one
+        if(newProp->id == PROP_BDAY){
+            discardDate(card, card->birthday);
             card->birthday = dt;
         } else {
+            discardDate(card, card->anniversary);
             card->anniversary = dt;
         }
         //delete the property since its info is in dt
-        deleteProperty(newProp);
+        discardProperty(card, newProp);
     } else {
         //insert the property into the optional properties list
-        insertBack(card->optionalProperties, newProp);
+        if(!appendToList(card->optionalProperties, newProp)){
+            ctx->error = OTHER_ERROR;
+            discardProperty(card, newProp);
+            return false;
+        }
+
+        //if the index can not be added to, the first lookup builds it instead
+        indexProperty(card, newProp);
 
     }
     return true;
@@ -427,6 +536,30 @@ char* myStrDup(const char* str){
     return newStr;
 }
 
+//clears the per-card state of a context before a new card is parsed, keeping its options
+void resetCardState(VCardContext * ctx){
+    ctx->error = OK;
+    ctx->errorLine = 0;
+    ctx->foundBegin = false;
+    ctx->foundEnd = false;
+    ctx->done = false;
+    ctx->foundVersion = false;
+}
+
+//copies the first length bytes of str into a new NUL terminated string
+char* myStrNDup(const char* str, size_t length){
+    if(str == NULL){
+        return NULL;
+    }
+
+    char * newStr = malloc(length + 1);
+    if(newStr){
+        memcpy(newStr, str, length);
+        newStr[length] = '\0';
+    }
+    return newStr;
+}
+
 bool validFileExtension(const char * fileName){
 
 
@@ -448,3 +581,598 @@ bool validFileExtension(const char * fileName){
     }
     return false;
 }
+
+
+
+//INPUT BUFFER FUNCTIONS
+
+//bytes read from the file at a time
+#define INPUT_CHUNK (64 * 1024)
+
+//marks a line end that has not been found
+#define NO_LINE_END ((size_t)-1)
+
+//moves the bytes that have not been used yet to the front of the window, so it only grows for a line
+//that does not fit.  Only called between lines, since it moves whatever the last line pointed into
+static void compactInput(InputBuffer * in){
+
+    if(in->pos < in->capacity / 2){
+        return;
+    }
+
+    memmove(in->data, in->data + in->pos, in->length - in->pos);
+    in->length -= in->pos;
+    if(in->nextLineEnd != NO_LINE_END){
+        in->nextLineEnd -= in->pos;
+    }
+    in->pos = 0;
+}
+
+//reads more of the file onto the end of the window, growing it if it is full.
+//Returns false once the file is used up, or if reading or growing fails
+static bool readMoreInput(InputBuffer * in){
+
+    if(in->atEnd){
+        return false;
+    }
+
+    if(in->length == in->capacity){
+        size_t capacity = in->capacity ? in->capacity * 2 : INPUT_CHUNK;
+        char * bigger = realloc(in->data, capacity);
+        if(bigger == NULL){
+            in->failed = true;
+            in->atEnd = true;
+            return false;
+        }
+        in->data = bigger;
+        in->capacity = capacity;
+    }
+
+    while(true){
+        ssize_t got = read(in->fd, in->data + in->length, in->capacity - in->length);
+        if(got < 0 && errno == EINTR){
+            continue;
+        }
+        if(got <= 0){
+            //a read error ends the input like the end of the file does, but is remembered
+            in->failed = got < 0;
+            in->atEnd = true;
+            return false;
+        }
+        in->length += got;
+        return true;
+    }
+}
+
+//makes sure the window holds the byte at offset, reading more of the file if needed
+static bool haveByte(InputBuffer * in, size_t offset){
+
+    while(offset >= in->length){
+        if(!readMoreInput(in)){
+            return false;
+        }
+    }
+    return true;
+}
+
+//finds the next LF at or after offset, reading as much of the file as it takes
+static size_t findLF(InputBuffer * in, size_t offset){
+
+    while(true){
+        const char * lf = memchr(in->data + offset, '\n', in->length - offset);
+        if(lf != NULL){
+            return lf - in->data;
+        }
+
+        offset = in->length;
+        if(!readMoreInput(in)){
+            return NO_LINE_END;
+        }
+    }
+}
+
+//finds the LF ending the physical line that starts at lineStart, or NO_LINE_END if the line does not end in CRLF
+static size_t findLineEnd(InputBuffer * in, size_t lineStart){
+
+    size_t lf = findLF(in, lineStart);
+    if(lf == NO_LINE_END || lf == lineStart || in->data[lf - 1] != '\r'){
+        return NO_LINE_END;
+    }
+    return lf;
+}
+
+//appends to a buffer, which doubles when it fills so appending stays linear in the bytes added.
+//The data is always NUL terminated
+bool appendBytes(ByteBuffer * buffer, const char * data, size_t length){
+
+    if(buffer->length + length + 1 > buffer->capacity){
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while(capacity < buffer->length + length + 1){
+            capacity *= 2;
+        }
+
+        char * bigger = realloc(buffer->data, capacity);
+        if(bigger == NULL){
+            return false;
+        }
+        buffer->data = bigger;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
+
+/*
+    Input is read through a window that holds the line being parsed and a chunk of what follows it,
+    so an export of any size is parsed in memory bounded by its longest line.  The file is read with
+    read rather than mapped, so another process truncating or rewriting it cannot fault the parser,
+    it just sees the file end early
+*/
+bool openInputBuffer(const char * fileName, InputBuffer * in){
+
+    if(fileName == NULL || in == NULL){
+        return false;
+    }
+
+    in->data = NULL;
+    in->length = 0;
+    in->capacity = 0;
+    in->pos = 0;
+    in->size = 0;
+    in->atEnd = false;
+    in->failed = false;
+    in->lineNumber = 0;
+    in->linesRead = 0;
+    in->nextLineEnd = NO_LINE_END;
+    in->join = (ByteBuffer){ NULL, 0, 0 };
+
+    in->fd = open(fileName, O_RDONLY);
+    if(in->fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(in->fd, &info) != 0){
+        close(in->fd);
+        return false;
+    }
+
+    //a small file is read whole in one call, and a big one a chunk at a time
+    if(S_ISREG(info.st_mode)){
+        in->size = (size_t)info.st_size;
+    }
+    in->capacity = in->size < INPUT_CHUNK ? in->size + 1 : INPUT_CHUNK;
+    in->data = malloc(in->capacity);
+    if(in->data == NULL){
+        close(in->fd);
+        return false;
+    }
+
+    return true;
+}
+
+void closeInputBuffer(InputBuffer * in){
+
+    if(in == NULL){
+        return;
+    }
+
+    if(in->fd >= 0){
+        close(in->fd);
+    }
+    free(in->data);
+    free(in->join.data);
+
+    in->fd = -1;
+    in->data = NULL;
+    in->length = 0;
+    in->capacity = 0;
+    in->pos = 0;
+    in->nextLineEnd = NO_LINE_END;
+    in->join = (ByteBuffer){ NULL, 0, 0 };
+}
+
+//moves the input past a line that does not end in CRLF, so that reading can carry on after it
+static LineResult skipBadLine(InputBuffer * in, size_t lineStart){
+
+    size_t lf = findLF(in, lineStart);
+    in->pos = lf != NO_LINE_END ? lf + 1 : in->length;
+    in->linesRead = in->lineNumber;
+    return in->failed ? LINE_NO_MEMORY : LINE_BAD_ENDING;
+}
+
+LineResult nextUnfoldedLine(InputBuffer * in, const char ** line, size_t * length){
+
+    compactInput(in);
+
+    size_t start = in->pos;
+    if(!haveByte(in, start)){
+        return in->failed ? LINE_NO_MEMORY : LINE_EOF;
+    }
+
+    //the end of this line may already have been found while checking the line before it
+    size_t lf = in->nextLineEnd != NO_LINE_END ? in->nextLineEnd : findLineEnd(in, start);
+    in->nextLineEnd = NO_LINE_END;
+    in->lineNumber = in->linesRead + 1;
+    if(lf == NO_LINE_END){
+        //invalid line ending
+        return skipBadLine(in, start);
+    }
+
+    //a continuation line with nothing before it loses its leading whitespace like any other
+    size_t firstStart = start;
+    if(in->data[start] == ' ' || in->data[start] == '\t'){
+        firstStart++;
+    }
+    size_t firstLength = (lf - 1) - firstStart;
+
+    //any continuation lines that follow are joined onto it as they are found, each physical line is
+    //scanned once and copied once, so a line folded any number of times costs time linear in its bytes
+    int continuations = 0;
+    in->join.length = 0;
+    size_t next = lf + 1;
+    while(haveByte(in, next) && (in->data[next] == ' ' || in->data[next] == '\t')){
+        size_t contEnd = findLineEnd(in, next);
+        if(contEnd == NO_LINE_END){
+            in->lineNumber += continuations + 1;
+            return skipBadLine(in, next);
+        }
+
+        if(continuations == 0 && !appendBytes(&in->join, in->data + firstStart, firstLength)){
+            return LINE_NO_MEMORY;
+        }
+        if(!appendBytes(&in->join, in->data + next + 1, (contEnd - 1) - (next + 1))){
+            return LINE_NO_MEMORY;
+        }
+
+        continuations++;
+        next = contEnd + 1;
+    }
+
+    //the line after this one has to be checked before this one is used, like the fgets loop always did
+    if(haveByte(in, next)){
+        in->nextLineEnd = findLineEnd(in, next);
+        if(in->nextLineEnd == NO_LINE_END){
+            in->lineNumber += continuations + 1;
+            return skipBadLine(in, next);
+        }
+    }
+    if(in->failed){
+        return LINE_NO_MEMORY;
+    }
+    in->pos = next;
+    in->linesRead += continuations + 1;
+
+    //a line that was not folded is used straight out of the window
+    if(continuations == 0){
+        *line = in->data + firstStart;
+        *length = firstLength;
+    } else {
+        *line = in->join.data;
+        *length = in->join.length;
+    }
+    return LINE_OK;
+}
+
+//moves the input past the rest of a card that failed to parse, stopping after its END
+//or before the next BEGIN if it never ended
+void skipRestOfCard(InputBuffer * in){
+
+    in->nextLineEnd = NO_LINE_END;
+
+    while(true){
+        compactInput(in);
+
+        //enough of the line to tell BEGIN: and END: lines apart
+        haveByte(in, in->pos + 5);
+        if(in->pos >= in->length){
+            break;
+        }
+
+        const char * line = in->data + in->pos;
+        size_t left = in->length - in->pos;
+
+        if(left >= 6 && strncasecmp(line, "BEGIN:", 6) == 0){
+            break;
+        }
+        bool end = left >= 4 && strncasecmp(line, "END:", 4) == 0;
+
+        size_t lf = findLF(in, in->pos);
+        in->pos = lf != NO_LINE_END ? lf + 1 : in->length;
+        in->linesRead++;
+
+        if(end){
+            break;
+        }
+    }
+}
+
+
+/*
+    These write card text out to a file.  An atomic file is created under a name unique to this process and
+    call, flushed to disk, renamed over the real file and then the directory is flushed too, so readers see
+    either the old file or the whole new one even if the process or machine dies part way through
+*/
+bool openOutputFile(OutputFile * out, const char * fileName, bool atomic){
+
+    out->fileName = fileName;
+    out->tempName = NULL;
+
+    if(!atomic){
+        out->fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        return out->fd >= 0;
+    }
+
+    static atomic_uint tempCounter;
+    size_t nameLength = strlen(fileName) + 48;
+    out->tempName = malloc(nameLength);
+    if(out->tempName == NULL){
+        out->fd = -1;
+        return false;
+    }
+
+    out->fd = -1;
+    for(int attempt = 0; attempt < 16 && out->fd < 0; attempt++){
+        snprintf(out->tempName, nameLength, "%s.%ld.%u.tmp", fileName, (long)getpid(), atomic_fetch_add(&tempCounter, 1));
+        out->fd = open(out->tempName, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if(out->fd < 0 && errno != EEXIST){
+            break;
+        }
+    }
+
+    if(out->fd < 0){
+        free(out->tempName);
+        out->tempName = NULL;
+        return false;
+    }
+
+    //a file being replaced keeps its permissions
+    struct stat existing;
+    if(stat(fileName, &existing) == 0){
+        fchmod(out->fd, existing.st_mode & 07777);
+    }
+
+    return true;
+}
+
+//writes all of a buffer, carrying on after short writes and signals
+bool writeOutputFile(OutputFile * out, const char * data, size_t length){
+
+    while(length > 0){
+        ssize_t written = write(out->fd, data, length);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+//closes the file, and for an atomic file puts it in place if keep is set or throws it away if not
+bool closeOutputFile(OutputFile * out, bool keep){
+
+    if(out->tempName == NULL){
+        //a failed close can mean the data never made it out
+        return close(out->fd) == 0;
+    }
+
+    bool done = keep && fsync(out->fd) == 0;
+    done = close(out->fd) == 0 && done;
+    done = done && rename(out->tempName, out->fileName) == 0;
+
+    if(!done){
+        unlink(out->tempName);
+    }
+    free(out->tempName);
+    out->tempName = NULL;
+
+    if(!done){
+        return false;
+    }
+
+    //flush the directory, so the rename itself survives a crash
+    char * dirName = myStrDup(out->fileName);
+    if(dirName != NULL){
+        char * slash = strrchr(dirName, '/');
+        const char * dirPath = ".";
+        if(slash == dirName){
+            dirPath = "/";
+        } else if(slash != NULL){
+            *slash = '\0';
+            dirPath = dirName;
+        }
+
+        int dirFd = open(dirPath, O_RDONLY);
+        if(dirFd >= 0){
+            fsync(dirFd);
+            close(dirFd);
+        }
+        free(dirName);
+    }
+
+    return true;
+}
+
+
+
+//ARENA FUNCTIONS
+
+//arena blocks never get bigger than this unless a single allocation needs it
+#define ARENA_MAX_BLOCK (1024 * 1024)
+
+static void * arenaListAlloc(void * context, size_t size){
+    return arenaAlloc((CardArena*)context, size);
+}
+
+//memory in an arena is only given back when the whole arena is freed
+static void arenaListRelease(void * context, void * block){
+    (void)context;
+    (void)block;
+}
+
+static void arenaReleaseChain(void * context, Node * first, Node * last){
+    (void)context;
+    (void)first;
+    (void)last;
+}
+
+//delete function for lists in an arena, whose data is freed along with the arena
+static void keepArenaData(void * toBeDeleted){
+    (void)toBeDeleted;
+}
+
+CardArena * createArena(size_t firstBlockSize){
+
+    CardArena * arena = malloc(sizeof(CardArena));
+    if(arena == NULL){
+        return NULL;
+    }
+
+    arena->blocks = NULL;
+    arena->nextBlockSize = firstBlockSize > 0 ? firstBlockSize : 4096;
+    if(arena->nextBlockSize > ARENA_MAX_BLOCK){
+        arena->nextBlockSize = ARENA_MAX_BLOCK;
+    }
+    arena->listAllocator.alloc = &arenaListAlloc;
+    arena->listAllocator.release = &arenaListRelease;
+    arena->listAllocator.releaseChain = &arenaReleaseChain;
+    arena->listAllocator.context = arena;
+    arena->listAllocator.maxBlock = 0;
+
+    return arena;
+}
+
+void * arenaAlloc(CardArena * arena, size_t size){
+
+    //keep every allocation aligned for any type
+    size_t align = sizeof(max_align_t);
+    size = (size + align - 1) / align * align;
+
+    ArenaBlock * block = arena->blocks;
+    if(block == NULL || block->size - block->used < size){
+        //start a new block, each one twice the size of the last
+        size_t blockSize = arena->nextBlockSize;
+        if(blockSize < size){
+            blockSize = size;
+        }
+
+        block = malloc(sizeof(ArenaBlock) + blockSize);
+        if(block == NULL){
+            return NULL;
+        }
+        block->size = blockSize;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+
+        if(arena->nextBlockSize < ARENA_MAX_BLOCK){
+            arena->nextBlockSize *= 2;
+        }
+    }
+
+    void * ptr = (char*)block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+//total memory an arena holds, whether handed out yet or not
+size_t arenaSize(const CardArena * arena){
+
+    size_t size = sizeof(CardArena);
+    for(const ArenaBlock * block = arena->blocks; block != NULL; block = block->next){
+        size += sizeof(ArenaBlock) + block->size;
+    }
+    return size;
+}
+
+void freeArena(CardArena * arena){
+
+    if(arena == NULL){
+        return;
+    }
+
+    ArenaBlock * block = arena->blocks;
+    while(block != NULL){
+        ArenaBlock * next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
+
+
+//CARD ALLOCATION FUNCTIONS
+//these allocate from the card's arena if it has one, otherwise from the heap
+
+Card * initializeCard(CardArena * arena, ListAllocator * listAllocator){
+
+    Card * card = arena ? arenaAlloc(arena, sizeof(Card)) : malloc(sizeof(Card));
+    if(card == NULL){
+        return NULL;
+    }
+
+    card->arena = arena;
+    card->listAllocator = arena ? NULL : listAllocator;
+    card->index = NULL;
+    card->fn = NULL;
+    card->birthday = NULL;
+    card->anniversary = NULL;
+    card->optionalProperties = cardList(card, &propertyToString, &deleteProperty, &compareProperties);
+
+    if(card->optionalProperties == NULL){
+        if(arena == NULL){
+            free(card);
+        }
+        return NULL;
+    }
+
+    return card;
+}
+
+void * cardAlloc(Card * card, size_t size){
+    if(card->arena){
+        return arenaAlloc(card->arena, size);
+    }
+    return malloc(size);
+}
+
+char * cardStrNDup(Card * card, const char * str, size_t length){
+    if(card->arena == NULL){
+        return myStrNDup(str, length);
+    }
+
+    char * newStr = arenaAlloc(card->arena, length + 1);
+    if(newStr){
+        memcpy(newStr, str, length);
+        newStr[length] = '\0';
+    }
+    return newStr;
+}
+
+List * cardList(Card * card, char* (*printFunction)(void* toBePrinted), void (*deleteFunction)(void* toBeDeleted), int (*compareFunction)(const void* first, const void* second)){
+    if(card->arena){
+        return initializeListWithAllocator(printFunction, &keepArenaData, compareFunction, &card->arena->listAllocator);
+    }
+    return initializeListWithAllocator(printFunction, deleteFunction, compareFunction, card->listAllocator);
+}
+
+//throws away a property that was never added to the card
+void discardProperty(Card * card, Property * prop){
+    if(card->arena == NULL){
+        deleteProperty(prop);
+    }
+}
+
+void discardDate(Card * card, DateTime * date){
+    if(card->arena == NULL){
+        deleteDate(date);
+    }
+}
@@ -0,0 +1,318 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <strings.h>
+
+#include "VCParser.h"
+#include "VCHelpers.h"
+
+/*
+    Per-card index of properties by name and by group.  It is one open addressing hash table whose entries
+    hold a copy of the key and a SmallVector of the matching properties, so most keys need no storage
+    beyond the table.  The parser adds properties as it appends them, and a lookup on a card that was
+    changed by hand since then builds the index again.  Changes are noticed through fn and the change
+    count that the list API keeps for optionalProperties.
+*/
+
+//table size the index starts with, always a power of two
+#define INDEX_START_CAPACITY 16
+
+typedef struct indexEntry {
+    //copy of the name or group, NULL for an empty slot
+    char * key;
+    uint32_t hash;
+    bool isGroup;
+    SmallVector matches;
+} IndexEntry;
+
+struct cardIndex {
+    IndexEntry * entries;
+    int capacity;
+    int used;
+
+    //what has been indexed, so a card changed by hand can be noticed
+    const Property * fn;
+    const List * optional;
+    unsigned int optionalChanges;
+
+    //arena the index lives in if the card has one
+    CardArena * arena;
+};
+
+
+//FNV-1a over the key folded to lower case
+static uint32_t keyHash(const char * key, bool isGroup){
+
+    uint32_t hash = isGroup ? 2166136261u ^ 0x9e3779b9u : 2166136261u;
+    for(const unsigned char * c = (const unsigned char *)key; *c != '\0'; c++){
+        hash ^= (uint32_t)tolower(*c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void * indexAlloc(CardIndex * index, size_t size){
+    return index->arena ? arenaAlloc(index->arena, size) : malloc(size);
+}
+
+static void indexFree(CardIndex * index, void * block){
+    if(index->arena == NULL){
+        free(block);
+    }
+}
+
+static ListAllocator * indexVectorAllocator(CardIndex * index){
+    return index->arena ? &index->arena->listAllocator : NULL;
+}
+
+//the index only points at properties, the card owns them
+static void keepProperty(void * toBeDeleted){
+    (void)toBeDeleted;
+}
+
+static IndexEntry * allocEntries(CardIndex * index, int capacity){
+
+    IndexEntry * entries = indexAlloc(index, sizeof(IndexEntry) * capacity);
+    if(entries != NULL){
+        for(int i = 0; i < capacity; i++){
+            entries[i].key = NULL;
+        }
+    }
+    return entries;
+}
+
+//finds the entry for a key, or the empty slot it would go in
+static IndexEntry * findSlot(IndexEntry * entries, int capacity, const char * key, uint32_t hash, bool isGroup){
+
+    int mask = capacity - 1;
+    for(int i = hash & mask; ; i = (i + 1) & mask){
+        IndexEntry * entry = &entries[i];
+        if(entry->key == NULL){
+            return entry;
+        }
+        if(entry->hash == hash && entry->isGroup == isGroup && strcasecmp(entry->key, key) == 0){
+            return entry;
+        }
+    }
+}
+
+//doubles the table, the entries keep their keys and vectors
+static bool growIndex(CardIndex * index){
+
+    int capacity = index->capacity * 2;
+    IndexEntry * entries = allocEntries(index, capacity);
+    if(entries == NULL){
+        return false;
+    }
+
+    for(int i = 0; i < index->capacity; i++){
+        IndexEntry * old = &index->entries[i];
+        if(old->key != NULL){
+            *findSlot(entries, capacity, old->key, old->hash, old->isGroup) = *old;
+        }
+    }
+
+    indexFree(index, index->entries);
+    index->entries = entries;
+    index->capacity = capacity;
+    return true;
+}
+
+//adds a property under one key, putting it first if asked
+static bool addToKey(CardIndex * index, const char * key, bool isGroup, Property * prop, bool first){
+
+    //keep the table at most three quarters full
+    if((index->used + 1) * 4 > index->capacity * 3 && !growIndex(index)){
+        return false;
+    }
+
+    uint32_t hash = keyHash(key, isGroup);
+    IndexEntry * entry = findSlot(index->entries, index->capacity, key, hash, isGroup);
+
+    if(entry->key == NULL){
+        size_t length = strlen(key);
+        char * copy = indexAlloc(index, length + 1);
+        if(copy == NULL){
+            return false;
+        }
+        memcpy(copy, key, length + 1);
+
+        entry->key = copy;
+        entry->hash = hash;
+        entry->isGroup = isGroup;
+        initializeVector(&entry->matches, &propertyToString, &keepProperty, &compareProperties, indexVectorAllocator(index));
+        index->used++;
+    }
+
+    if(!vectorPushBack(&entry->matches, prop)){
+        return false;
+    }
+
+    if(first){
+        void ** items = vectorData(&entry->matches);
+        int last = vectorLength(&entry->matches) - 1;
+        memmove(items + 1, items, sizeof(void*) * last);
+        items[0] = prop;
+    }
+    return true;
+}
+
+static CardIndex * createIndex(Card * card){
+
+    CardIndex * index = card->arena ? arenaAlloc(card->arena, sizeof(CardIndex)) : malloc(sizeof(CardIndex));
+    if(index == NULL){
+        return NULL;
+    }
+
+    index->arena = card->arena;
+    index->capacity = INDEX_START_CAPACITY;
+    index->used = 0;
+    index->fn = NULL;
+    index->optional = card->optionalProperties;
+    index->optionalChanges = card->optionalProperties ? card->optionalProperties->changes : 0;
+    index->entries = allocEntries(index, INDEX_START_CAPACITY);
+
+    if(index->entries == NULL){
+        indexFree(index, index);
+        return NULL;
+    }
+    return index;
+}
+
+//adds a property that is already in the card
+static bool addToIndex(CardIndex * index, Card * card, Property * prop){
+
+    bool isFN = prop == card->fn;
+
+    if(prop->name != NULL && prop->name[0] != '\0' && !addToKey(index, prop->name, false, prop, false)){
+        return false;
+    }
+
+    //the FN property always comes first in its group, since it is first in the card
+    if(prop->group != NULL && prop->group[0] != '\0' && !addToKey(index, prop->group, true, prop, isFN)){
+        return false;
+    }
+
+    //the property is already in the list, so the list's count covers it
+    if(isFN){
+        index->fn = prop;
+    } else if(card->optionalProperties != NULL){
+        index->optional = card->optionalProperties;
+        index->optionalChanges = card->optionalProperties->changes;
+    }
+    return true;
+}
+
+
+void freeCardIndex(Card * card){
+
+    CardIndex * index = card->index;
+    card->index = NULL;
+
+    //an index in an arena goes with the arena
+    if(index == NULL || index->arena != NULL){
+        return;
+    }
+
+    for(int i = 0; i < index->capacity; i++){
+        IndexEntry * entry = &index->entries[i];
+        if(entry->key != NULL){
+            free(entry->key);
+            releaseVector(&entry->matches);
+        }
+    }
+
+    free(index->entries);
+    free(index);
+}
+
+bool indexProperty(Card * card, Property * prop){
+
+    if(card->index == NULL){
+        card->index = createIndex(card);
+        if(card->index == NULL){
+            return false;
+        }
+    }
+
+    if(!addToIndex(card->index, card, prop)){
+        //a lookup will try again from scratch
+        freeCardIndex(card);
+        return false;
+    }
+    return true;
+}
+
+bool rebuildCardIndex(Card* card){
+
+    if(card == NULL){
+        return false;
+    }
+
+    freeCardIndex(card);
+
+    CardIndex * index = createIndex(card);
+    if(index == NULL){
+        return false;
+    }
+    card->index = index;
+
+    if(card->fn != NULL && !addToIndex(index, card, card->fn)){
+        freeCardIndex(card);
+        return false;
+    }
+
+    if(card->optionalProperties != NULL){
+        void * elem;
+        ListIterator iter = createIterator(card->optionalProperties);
+        while((elem = nextElement(&iter)) != NULL){
+            if(!addToIndex(index, card, (Property*)elem)){
+                freeCardIndex(card);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//looks a key up, building the index again first if the card has changed since it was indexed
+static const SmallVector * lookup(const Card * card, const char * key, bool isGroup){
+
+    if(card == NULL || key == NULL || key[0] == '\0'){
+        return NULL;
+    }
+
+    //the index is a cache, so a const card can still have it rebuilt
+    Card * indexed = (Card*)card;
+    CardIndex * index = card->index;
+    const List * optional = card->optionalProperties;
+
+    if(index == NULL || index->fn != card->fn || index->optional != optional || (optional != NULL && index->optionalChanges != optional->changes)){
+        if(!rebuildCardIndex(indexed)){
+            return NULL;
+        }
+        index = indexed->index;
+    }
+
+    IndexEntry * entry = findSlot(index->entries, index->capacity, key, keyHash(key, isGroup), isGroup);
+    return entry->key != NULL ? &entry->matches : NULL;
+}
+
+const SmallVector* findPropertiesByName(const Card* card, const char* name){
+    return lookup(card, name, false);
+}
+
+const SmallVector* findPropertiesInGroup(const Card* card, const char* group){
+    return lookup(card, group, true);
+}
+
+void sortCardProperties(Card* card){
+
+    if(card == NULL || card->optionalProperties == NULL){
+        return;
+    }
+
+    sortList(card->optionalProperties);
+
+    //the index keeps matches in card order, so it is built again on the next lookup
+    freeCardIndex(card);
+}
@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -8,18 +10,141 @@
 #include "VCParser.h"
 #include "LinkedListAPI.h"
 #include "VCHelpers.h"
+#include "StringBuilder.h"
+
 
 
 
+/*
+    THIS IS THE FILE WHERE ALL MY FUNCTIONS WILL GO THAT WILL PARSE THE VCARD FILE
+*/
+
+/*
+    Streaming reader state. The input stays open between calls and its position is the first line
+    after the previous card
+*/
+struct vCardReader {
+    InputBuffer in;
 
-//GLOBAL ERROR THAT WILL SWITCH TO HANDLE ERRORS
-VCardErrorCode globalError = OK;
+    //each reader parses with its own context, so readers on different threads never share state
+    VCardContext ctx;
 
+    //set after a card fails to parse so the rest of it is skipped before the next card is read
+    bool skipToEnd;
+};
 
 
 /*
-    THIS IS THE FILE WHERE ALL MY FUNCTIONS WILL GO THAT WILL PARSE THE VCARD FILE
+    This function records an error in the context and returns it
+*/
+static VCardErrorCode contextError(VCardContext * ctx, VCardErrorCode error, int line){
+    ctx->error = error;
+    ctx->errorLine = line;
+    return error;
+}
+
+
+/*
+    This function reads unfolded lines from the input until one whole card has been parsed or the input runs out.
+    The input is left at the line after the card's END, so calling it again reads the next card.
+    If the input runs out before a BEGIN line is found it returns OK and sets obj to NULL.
+    If the context asks for an arena, arenaSize is the size of its first block
+*/
+static VCardErrorCode parseNextCard(InputBuffer * in, VCardContext * ctx, Card ** obj, size_t arenaSize){
+
+    *obj = NULL;
+    resetCardState(ctx);
+
+    CardArena * arena = NULL;
+    if(ctx->useArena){
+        arena = createArena(arenaSize);
+        if(arena == NULL){
+            return contextError(ctx, OTHER_ERROR, 0);
+        }
+    }
+
+    //now allocate memory for a new card obj
+    Card * card = initializeCard(arena, nodePoolAllocator(ctx->nodePool));
+    if(card == NULL){
+        freeArena(arena);
+        return contextError(ctx, OTHER_ERROR, 0);
+    }
+
+
+    //read lines until we find END or run out of input
+    while(!ctx->done){
+
+        const char * line = NULL;
+        size_t length = 0;
+        LineResult result = nextUnfoldedLine(in, &line, &length);
+
+        if(result == LINE_EOF){
+            break;
+        }
+
+        if(result == LINE_BAD_ENDING){
+            //invalid line ending
+            deleteCard(card);
+            return contextError(ctx, INV_CARD, in->lineNumber);
+        }
+
+        if(result == LINE_NO_MEMORY){
+            deleteCard(card);
+            return contextError(ctx, OTHER_ERROR, in->lineNumber);
+        }
+
+        //blank lines are skipped
+        if(length == 0){
+            continue;
+        }
+
+        //parse the unfolded line
+        if(!parseSingleVCardLine(line, length, card, ctx)){
+            //invalid line
+            deleteCard(card);
+            return contextError(ctx, ctx->error, in->lineNumber);
+        }
+    }
+
+    //nothing but lines outside of a card were left
+    if(!ctx->foundBegin){
+        deleteCard(card);
+        return OK;
+    }
+
+    //check if we found end
+    if(!ctx->foundEnd || (card->fn == NULL) || !ctx->foundVersion){
+        deleteCard(card);
+        return contextError(ctx, INV_CARD, 0);
+    } 
+
+    if(ctx->sortProperties){
+        sortCardProperties(card);
+    }
+
+    *obj = card;
+    return OK;
+}
+
+
+/*
+    This function sets up a context with no error and the default options
 */
+void initializeContext(VCardContext* ctx){
+
+    if(ctx == NULL){
+        return;
+    }
+
+    ctx->useArena = false;
+    ctx->wantedProperties = NULL;
+    ctx->wantedCount = 0;
+    ctx->nodePool = NULL;
+    ctx->sortProperties = false;
+    ctx->atomicWrite = false;
+    resetCardState(ctx);
+}
+
 
 /*
 
@@ -28,152 +153,192 @@ VCardErrorCode globalError = OK;
     
 */
 VCardErrorCode createCard(char* fileName, Card** obj){
+    VCardContext ctx;
+    initializeContext(&ctx);
+    return createCardWithContext(&ctx, fileName, obj);
+}
+
+/*
+    This function works like createCard, except that the card and everything it owns are bump allocated
+    from one arena, so parsing makes a handful of allocations and deleteCard frees them all at once.
+    The card must be treated as read only
+*/
+VCardErrorCode createCardInArena(char* fileName, Card** obj){
+    VCardContext ctx;
+    initializeContext(&ctx);
+    ctx.useArena = true;
+    return createCardWithContext(&ctx, fileName, obj);
+}
+
+/*
+    This function is createCard with all of its state kept in ctx, so it can run on several threads at once
+    as long as each uses its own context.  The error is also left in ctx, along with the line it was found on
+*/
+VCardErrorCode createCardWithContext(VCardContext* ctx, char* fileName, Card** obj){
+
+    if(ctx == NULL){
+        return OTHER_ERROR;
+    }
+    resetCardState(ctx);
 
     //check for parameters first
     if(fileName == NULL || obj == NULL){
-        return INV_FILE;
+        return contextError(ctx, INV_FILE, 0);
     }
 
 
     //check if the file extension is valid
     if(!validFileExtension(fileName)){
         *obj = NULL;
-        return INV_FILE;
+        return contextError(ctx, INV_FILE, 0);
     }
 
 
-    //now open the file
-    FILE *fp = fopen(fileName, "rb");
-    if(fp == NULL){
+    //now open the file, lines are parsed straight out of the window it is read into
+    InputBuffer in;
+    if(!openInputBuffer(fileName, &in)){
         *obj = NULL;
-        return INV_FILE;
+        return contextError(ctx, INV_FILE, 0);
     }
 
+    //the card can never take more than a few times the size of the file, so one arena block usually holds it
+    size_t arenaSize = in.size * 4 + 1024;
 
-    //now allocate memory for a new card obj
-    Card * card = malloc(sizeof(Card));
-    if(card == NULL){
-        fclose(fp);
-        *obj = NULL;
-        return OTHER_ERROR;   // FOR NOW
+    //only the first card in the file is read
+    VCardErrorCode error = parseNextCard(&in, ctx, obj, arenaSize);
+
+    closeInputBuffer(&in);
+
+    //a file with no card in it is an invalid card
+    if(error == OK && *obj == NULL){
+        error = contextError(ctx, INV_CARD, 0);
     }
+    return error;
 
-    //initialize the card object
-    card->fn = NULL;
-    card->optionalProperties = initializeList(&propertyToString, &deleteProperty, &compareProperties);
+}
 
-    //set to NULL for now because of garbage values
-    card->birthday = NULL;
-    card->anniversary = NULL;
 
+//STREAMING READER FUNCTIONS
 
-    //variable setup for parsing
-    bool foundBegin = false;
-    bool foundEnd = false;
-    bool done = false;
-    bool foundVersion = false; //set true once we find version property
+/*
+    This function opens a file that may hold any number of cards back to back and creates a reader for it.
+    The file is read a chunk at a time, so memory use is bounded by the longest line rather than the size of the file
+*/
+VCardErrorCode openCardReader(const char* fileName, VCardReader** reader){
 
+    if(fileName == NULL || reader == NULL){
+        return INV_FILE;
+    }
 
+    *reader = NULL;
 
-    //store unfolded lines
-    char unfoldedBuffer[2048];
-    unfoldedBuffer[0] = '\0';
+    //same extension rules as createCard
+    if(!validFileExtension(fileName)){
+        return INV_FILE;
+    }
 
+    VCardReader * newReader = malloc(sizeof(VCardReader));
+    if(newReader == NULL){
+        return OTHER_ERROR;
+    }
 
-    //read lines until we find END or run out of file
-    while(!done){
+    if(!openInputBuffer(fileName, &newReader->in)){
+        free(newReader);
+        return INV_FILE;
+    }
 
-        char rawBuffer[1024];
-        if(!fgets(rawBuffer, sizeof(rawBuffer), fp)){
-            //EOF or read error occured
-            break;
-        }
+    initializeContext(&newReader->ctx);
+    newReader->skipToEnd = false;
 
-        if(!validCRLF(rawBuffer)){
-            //invalid line ending
-            deleteCard(card);
-            fclose(fp);
-            *obj = NULL;
-            return INV_CARD;
-        }
+    *reader = newReader;
+    return OK;
+}
 
+/*
+    This function reads the next card from the reader.  On success obj points to a new card that the caller
+    must delete with deleteCard.  Once there are no cards left the function returns OK and sets obj to NULL.
+    If a card is invalid its error code is returned and the next call carries on after that card's END line
+*/
+VCardErrorCode readNextCard(VCardReader* reader, Card** obj){
+
+    if(reader == NULL || obj == NULL){
+        return OTHER_ERROR;
+    }
 
-        //remove CRLF
-        size_t rawLength = strlen(rawBuffer);
-        rawBuffer[rawLength - 2] = '\0'; //remove CRLF
+    *obj = NULL;
 
+    //skip whatever is left of a card that failed to parse
+    if(reader->skipToEnd){
+        reader->skipToEnd = false;
 
-        //check if the line is a continuation line
-        if(rawBuffer[0] == ' ' || rawBuffer[0] == '\t'){
-            //the line continues into the previous line, skip the whitespace char
-            char * toAppend = rawBuffer + 1;
+        skipRestOfCard(&reader->in);
+    }
 
+    VCardErrorCode error = parseNextCard(&reader->in, &reader->ctx, obj, 4096);
 
-            //append the remainder to the accumulated buffer
-            if(strlen(unfoldedBuffer) + strlen(toAppend) + 1 < sizeof(unfoldedBuffer)){
-                strcat(unfoldedBuffer, toAppend);
-            } else {
-                //buffer overflow
-                deleteCard(card);
-                fclose(fp);
-                *obj = NULL;
-                return INV_FILE;
-            }
-            
-        } else {
-            //this would be a fresh line
-            //check if we have any unfolded lines
-
-            if(unfoldedBuffer[0] != '\0'){
-                //parse the unfolded line
-                if(!parseSingleVCardLine(unfoldedBuffer, card, &foundBegin, &foundEnd, &done, &foundVersion)){
-                    //invalid line
-                    deleteCard(card);
-                    fclose(fp);
-                    *obj = NULL;
-                    return globalError;
-                }
-
-                //clear the unfolded buffer
-                unfoldedBuffer[0] = '\0';
-            }
+    //a card that stopped before its END line still has lines left to skip
+    if(error != OK && !reader->ctx.foundEnd){
+        reader->skipToEnd = true;
+    }
 
-            //parse the fresh line
-            char * trimmedLine = trimWhiteSpace(rawBuffer);
-            strncpy(unfoldedBuffer, rawBuffer, sizeof(unfoldedBuffer) - 1);
-            unfoldedBuffer[sizeof(unfoldedBuffer) - 1] = '\0';
-            free(trimmedLine);
-        }
+    return error;
+}
 
+/*
+    This function returns the line the last error from readNextCard was found on, or 0 if it was not tied to a line
+*/
+int readerErrorLine(const VCardReader* reader){
 
+    if(reader == NULL){
+        return 0;
     }
-    //check if we have any unfolded lines left after the loop
+    return reader->ctx.errorLine;
+}
 
-    if(!done && unfoldedBuffer[0] != '\0'){
-        //parse the unfolded line
-        if(!parseSingleVCardLine(unfoldedBuffer, card, &foundBegin, &foundEnd, &done, &foundVersion)){
-            //invalid line
-            deleteCard(card);
-            fclose(fp);
-            *obj = NULL;
-            return globalError;
-        }
+/*
+    This function sets whether the reader puts each card it reads into its own arena
+*/
+void setReaderUseArena(VCardReader* reader, bool useArena){
+
+    if(reader != NULL){
+        reader->ctx.useArena = useArena;
     }
+}
 
+/*
+    This function limits the properties the reader parses, like the wantedProperties option of a context.
+    names must stay valid until the reader is closed or the projection is changed
+*/
+void setReaderProjection(VCardReader* reader, const char* const* names, int count){
 
-    fclose(fp);
-    //close and check if we found end
-    if(!foundEnd || !foundBegin || (card->fn == NULL) || !foundVersion){
-        deleteCard(card);
-        *obj = NULL;
-        return INV_CARD;
-    } 
+    if(reader != NULL){
+        reader->ctx.wantedProperties = names;
+        reader->ctx.wantedCount = names != NULL ? count : 0;
+    }
+}
 
-    *obj = card;
-    return OK;
+/*
+    This function closes the file behind a reader and frees it
+*/
+void closeCardReader(VCardReader* reader){
 
+    if(reader == NULL){
+        return;
+    }
+
+    closeInputBuffer(&reader->in);
+    free(reader);
 }
 
+
+/*
+    This function creates a card with nothing in it, for callers that fill one in themselves
+*/
+Card* createEmptyCard(void){
+    return initializeCard(NULL, NULL);
+}
+
+
 /*
     This function will delete a card object and free all the memory that was allocated for it
 */
@@ -186,6 +351,14 @@ void deleteCard(Card* obj){
         return;
     }
 
+    //a card in an arena goes with everything it owns in one go
+    if(obj->arena != NULL){
+        freeArena(obj->arena);
+        return;
+    }
+
+    freeCardIndex(obj);
+
     //free the FN property
     if(obj->fn != NULL){
         deleteProperty(obj->fn);
@@ -218,6 +391,132 @@ void deleteCard(Card* obj){
 }
 
 
+/*
+    These work out the exact length of the strings propertyToString, dateToString and cardToString make,
+    so the serializers can allocate once.  They must be kept in step with the append functions below
+*/
+static size_t safeLength(const char * str){
+    return str ? strlen(str) : 0;
+}
+
+static size_t propertyStringLength(const Property * prop){
+
+    size_t length = 0;
+
+    //"Name: " name "\n"
+    if(prop->name){
+        length += 7 + strlen(prop->name);
+    }
+
+    //"Parameters:\n" then "     - " name " = " value "\n" for each
+    if(prop->parameters != NULL && getLength(prop->parameters) > 0){
+        length += 12;
+        void * elem;
+        ListIterator iter = createIterator(prop->parameters);
+        while((elem = nextElement(&iter)) != NULL){
+            Parameter * param = (Parameter*)elem;
+            length += 11 + safeLength(param->name) + safeLength(param->value);
+        }
+    }
+
+    //"Values:\n" then "     - " value "\n" for each
+    length += 8;
+    if(prop->values != NULL){
+        void * elem;
+        ListIterator iter = createIterator(prop->values);
+        while((elem = nextElement(&iter)) != NULL){
+            length += 8 + strlen((char*)elem);
+        }
+    }
+
+    return length;
+}
+
+static size_t dateStringLength(const DateTime * date){
+
+    if(date->isText){
+        return safeLength(date->text);
+    }
+
+    size_t timeLength = safeLength(date->time);
+    return safeLength(date->date) + (timeLength > 0 ? timeLength + 1 : 0);
+}
+
+static size_t cardStringLength(const Card * obj){
+
+    //the headings and the NULL placeholders
+    size_t length = 27 + 19;
+    length += obj->fn ? 11 + propertyStringLength(obj->fn) + 2 : 17;
+    length += obj->birthday ? 10 + dateStringLength(obj->birthday) + 2 : 16;
+    length += obj->anniversary ? 13 + dateStringLength(obj->anniversary) + 2 : 19;
+
+    void * elem;
+    ListIterator iter = createIterator(obj->optionalProperties);
+    while((elem = nextElement(&iter)) != NULL){
+        length += propertyStringLength((Property*)elem) + 1;
+    }
+
+    return length;
+}
+
+/*
+    These append the text of a property or date to a builder, in the format propertyToString and dateToString use
+*/
+static void appendProperty(StringBuilder * builder, const Property * prop){
+
+    //add name
+    if(prop->name){
+        builderAppend(builder, "Name: ");
+        builderAppend(builder, prop->name);
+        builderAppendChar(builder, '\n');
+    }
+
+
+    //print parameters if any
+    if(prop->parameters != NULL && getLength(prop->parameters) > 0){
+        builderAppend(builder, "Parameters:\n");
+        void * elem;
+        ListIterator iter = createIterator(prop->parameters);
+        while((elem = nextElement(&iter)) != NULL){
+            Parameter * param = (Parameter*)elem;
+            builderAppend(builder, "     - ");
+            builderAppend(builder, param->name);
+            builderAppend(builder, " = ");
+            builderAppend(builder, param->value);
+            builderAppendChar(builder, '\n');
+        }
+    }
+
+
+    //print values if any
+    builderAppend(builder, "Values:\n");
+    if(prop->values != NULL){
+        void * valElem;
+        ListIterator valIter = createIterator(prop->values);
+        while((valElem = nextElement(&valIter)) != NULL){
+            builderAppend(builder, "     - ");
+            builderAppend(builder, (char*)valElem);
+            builderAppendChar(builder, '\n');
+        }
+    }
+}
+
+static void appendDate(StringBuilder * builder, const DateTime * date){
+
+    //text dates are just their text, otherwise the date then T and the time if there is one
+    if(date->isText){
+        builderAppend(builder, date->text);
+        return;
+    }
+
+    builderAppend(builder, date->date);
+    if(date->time != NULL && date->time[0] != '\0'){
+        builderAppendChar(builder, 'T');
+        builderAppend(builder, date->time);
+    }
+}
+
+
 /*
     This function will take in a card object and return a string representation of the card object
 */
@@ -227,65 +526,58 @@ char* cardToString(const Card* obj){
     
     //if it is null then return something saying
     if(obj == NULL){
-        char * errorString = malloc(16);
-        strcpy(errorString, "Card is NULL");
-        return errorString;
+        return myStrDup("Card is NULL");
     }
 
-    //allocate memory for the string, random amount but should be enough
-    char * cardString = malloc(4096);
+    //measure the whole card first so the string is allocated once
+    size_t length = cardStringLength(obj);
 
-    //ensure empty string
-    cardString[0] = '\0';
+    StringBuilder builder;
+    initializeStringBuilder(&builder, length);
     
     //add the FN
     if(obj->fn != NULL){
-        char * fnString = propertyToString(obj->fn);
-        strcat(cardString, "Full Name:\n");
-        strcat(cardString, fnString);
-        strcat(cardString, "\n\n");
-        free(fnString);
+        builderAppend(&builder, "Full Name:\n");
+        appendProperty(&builder, obj->fn);
+        builderAppend(&builder, "\n\n");
     } else {
-        strcat(cardString, "Full Name: NULL\n\n");
+        builderAppend(&builder, "Full Name: NULL\n\n");
     }
 
     //then add the optional properties if there is any
-    strcat(cardString, "\n---Optional Properties---\n");
+    builderAppend(&builder, "\n---Optional Properties---\n");
     void * elem;
     ListIterator iter = createIterator(obj->optionalProperties);
     while((elem = nextElement(&iter)) != NULL){
-        Property * prop = (Property*)elem;
-        char * propString = propertyToString(prop);
-        strcat(cardString, propString);
-        strcat(cardString, "\n");
-        free(propString);
+        appendProperty(&builder, (Property*)elem);
+        builderAppend(&builder, "\n");
     }
 
     //print bday and anniversary if it is present
     if(obj->birthday){
-        char * bdayString = dateToString(obj->birthday);
-        strcat(cardString, "Birthday:\n");
-        strcat(cardString, bdayString);
-        strcat(cardString, "\n\n");
-        free(bdayString);
+        builderAppend(&builder, "Birthday:\n");
+        appendDate(&builder, obj->birthday);
+        builderAppend(&builder, "\n\n");
     } else {
-        strcat(cardString, "Birthday: NULL\n\n");
+        builderAppend(&builder, "Birthday: NULL\n\n");
     }
     
 
     if(obj->anniversary){
-        char * annString = dateToString(obj->anniversary);
-        strcat(cardString, "Anniversary:\n");
-        strcat(cardString, annString);
-        strcat(cardString, "\n\n");
-        free(annString);
+        builderAppend(&builder, "Anniversary:\n");
+        appendDate(&builder, obj->anniversary);
+        builderAppend(&builder, "\n\n");
     } else {
-        strcat(cardString, "Anniversary: NULL\n\n");
+        builderAppend(&builder, "Anniversary: NULL\n\n");
     }
 
 
-    strcat(cardString, "\n---End of Card---\n");
+    builderAppend(&builder, "\n---End of Card---\n");
 
+    char * cardString = builderTakeString(&builder);
+    if(cardString == NULL){
+        return myStrDup("Memory Allocation Error");
+    }
     return cardString;
 }
 
@@ -379,10 +671,75 @@ void deleteProperty(void* toBeDeleted){
 }
 
 /*
-    This function will compare two property objects and return an integer based on the comparison when it gets used..
+    These compare two strings that may be NULL, with NULL before anything else
+*/
+static int compareStrings(const char * first, const char * second){
+    if(first == NULL || second == NULL){
+        return (first != NULL) - (second != NULL);
+    }
+    return strcmp(first, second);
+}
+
+static int compareNames(const char * first, const char * second){
+    if(first == NULL || second == NULL){
+        return (first != NULL) - (second != NULL);
+    }
+    return strcasecmp(first, second);
+}
+
+/*
+    This function compares two lists element by element with the list's own compare function,
+    and a list that runs out first comes first
+*/
+static int compareLists(List * first, List * second){
+
+    if(first == NULL || second == NULL){
+        return (first != NULL) - (second != NULL);
+    }
+
+    ListIterator firstIter = createIterator(first);
+    ListIterator secondIter = createIterator(second);
+    void * a;
+    void * b;
+
+    while((a = nextElement(&firstIter)) != NULL){
+        b = nextElement(&secondIter);
+        if(b == NULL){
+            return 1;
+        }
+
+        int result = first->compare(a, b);
+        if(result != 0){
+            return result;
+        }
+    }
+
+    return nextElement(&secondIter) != NULL ? -1 : 0;
+}
+
+/*
+    This function will compare two property objects and return an integer based on the comparison.
+    Properties are ordered by name ignoring case, then group ignoring case, then their values and lastly their parameters
 */
 int compareProperties(const void* first,const void* second){
-    return 0;
+
+    const Property * a = first;
+    const Property * b = second;
+    if(a == NULL || b == NULL){
+        return (a != NULL) - (b != NULL);
+    }
+
+    int result = compareNames(a->name, b->name);
+    if(result == 0){
+        result = compareNames(a->group, b->group);
+    }
+    if(result == 0){
+        result = compareLists(a->values, b->values);
+    }
+    if(result == 0){
+        result = compareLists(a->parameters, b->parameters);
+    }
+    return result;
 }
 
 /*
@@ -398,45 +755,14 @@ char* propertyToString(void* prop){
     //cast the property to a property object
     Property * propData = (Property*)prop;
 
-    //allocate memory for the string
-    char * propString = malloc(1024);
-    propString[0] = '\0';
-
-    //add name
-    if(propData->name){
-        strcat(propString, "Name: ");
-        strcat(propString, propData->name);
-        strcat(propString, "\n");
-    }
-
-
-    //print parameters if any
-    if(propData->parameters != NULL && getLength(propData->parameters) > 0){
-        strcat(propString, "Parameters:\n");
-        void * elem;
-        ListIterator iter = createIterator(propData->parameters);
-        while((elem = nextElement(&iter)) != NULL){
-            Parameter * param = (Parameter*)elem;
-            strcat(propString, "     - ");
-            strcat(propString, param->name);
-            strcat(propString, " = ");
-            strcat(propString, param->value);
-            strcat(propString, "\n");
-        }
-    }
+    StringBuilder builder;
+    initializeStringBuilder(&builder, propertyStringLength(propData));
+    appendProperty(&builder, propData);
 
-
-    //print values if any
-    strcat(propString, "Values:\n");
-    void * valElem;
-    ListIterator valIter = createIterator(propData->values);
-    while((valElem = nextElement(&valIter)) != NULL){
-        char * value = (char*)valElem;
-        strcat(propString, "     - ");
-        strcat(propString, value);
-        strcat(propString, "\n");
+    char * propString = builderTakeString(&builder);
+    if(propString == NULL){
+        return myStrDup("Memory Allocation Error");
     }
-
     return propString;
 }
 
@@ -474,10 +800,23 @@ void deleteParameter(void* toBeDeleted){
 }
 
 /*
-    This function will compare two parameter objects and return an integer based on the comparison
+    This function will compare two parameter objects and return an integer based on the comparison,
+    by name ignoring case and then by value
 */
 int compareParameters(const void* first,const void* second){
-    return 0;
+
+    const Parameter * a = first;
+    const Parameter * b = second;
+    if(a == NULL || b == NULL){
+        return (a != NULL) - (b != NULL);
+    }
+
+    //parameter names ignore case, values do not
+    int result = compareNames(a->name, b->name);
+    if(result == 0){
+        result = compareStrings(a->value, b->value);
+    }
+    return result;
 }
 
 /*
@@ -536,7 +875,7 @@ void deleteValue(void* toBeDeleted){
     This function will compare two value objects and return an integer based on the comparison
 */
 int compareValues(const void* first,const void* second){
-    return 0;
+    return compareStrings(first, second);
 }
 
 /*
@@ -593,10 +932,34 @@ void deleteDate(void* toBeDeleted){
 }
 
 /*
-    This function will compare two date objects and return an integer based on the comparison
+    This function will compare two date objects and return an integer based on the comparison.
+    Dates come before text, dates are ordered by date then time then UTC, and text is ordered as a string.
+    YYYYMMDD and HHMMSS sort in time order as strings, and a date with no year (--MMDD) comes before any full date
 */
 int compareDates(const void* first,const void* second){
-    return 0;
+
+    const DateTime * a = first;
+    const DateTime * b = second;
+    if(a == NULL || b == NULL){
+        return (a != NULL) - (b != NULL);
+    }
+
+    if(a->isText != b->isText){
+        return a->isText ? 1 : -1;
+    }
+
+    if(a->isText){
+        return compareStrings(a->text, b->text);
+    }
+
+    int result = compareStrings(a->date, b->date);
+    if(result == 0){
+        result = compareStrings(a->time, b->time);
+    }
+    if(result == 0){
+        result = (int)a->UTC - (int)b->UTC;
+    }
+    return result;
 }
 
 /*
@@ -640,38 +1003,148 @@ char* dateToString(void* date){
 
 //ASSIGNMENT 2 FUNCTIONS
 
-//this function will take the card object and write it to a file
-VCardErrorCode writeCard(const char* fileName, const Card* obj) {
+//longest content line writeCard emits, in octets and not counting the CRLF (RFC 6350 section 3.2)
+#define MAX_LINE_OCTETS 75
 
-    //check if the file name and card object are null
-    if(fileName == NULL || obj == NULL){
-        return WRITE_ERROR;
+/*
+    Writer for vCard content lines that folds them as they are written.  With no builder it only counts,
+    which gives the exact length of the text, so the length pass and the writing pass can never disagree
+*/
+typedef struct lineWriter {
+    StringBuilder * builder;
+    size_t length;
+
+    //octets on the current physical line
+    size_t column;
+} LineWriter;
+
+static bool isContinuationByte(char c){
+    return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+//adds text to the current line, folding with CRLF and a space once a line is full.  A fold is never
+//put inside a UTF-8 sequence, it moves back to the start of the character instead.  A character has at
+//most three continuation bytes, so a longer run, or one with no lead byte, is not UTF-8 and its bytes
+//are cut like single octets.  Every pass writes at least one octet or starts a new line, so it always ends
+static void emitText(LineWriter * writer, const char * text, size_t length){
+
+    while(writer->column + length > MAX_LINE_OCTETS){
+        size_t limit = MAX_LINE_OCTETS - writer->column;
+        size_t fits = limit;
+        while(fits > 0 && limit - fits < 3 && isContinuationByte(text[fits])){
+            fits--;
+        }
+
+        //no lead byte to fold before, or the character would not fit even on a new line
+        if(isContinuationByte(text[fits]) || (fits == 0 && writer->column <= 1)){
+            fits = limit;
+        }
+
+        if(writer->builder != NULL){
+            builderAppendN(writer->builder, text, fits);
+            builderAppendN(writer->builder, "\r\n ", 3);
+        }
+        writer->length += fits + 3;
+        writer->column = 1;
+        text += fits;
+        length -= fits;
     }
 
-    //check if the file extension is valid
-    if(!validFileExtension(fileName)){
-        return WRITE_ERROR;
+    if(writer->builder != NULL){
+        builderAppendN(writer->builder, text, length);
     }
+    writer->length += length;
+    writer->column += length;
+}
 
-    //open the file
-    FILE *fp = fopen(fileName, "w");
-    if(fp == NULL){
-        return WRITE_ERROR;
+static void emitString(LineWriter * writer, const char * str){
+    if(str != NULL){
+        emitText(writer, str, strlen(str));
     }
+}
+
+static void emitLineEnd(LineWriter * writer){
+    if(writer->builder != NULL){
+        builderAppendN(writer->builder, "\r\n", 2);
+    }
+    writer->length += 2;
+    writer->column = 0;
+}
+
+static void emitDate(LineWriter * writer, const char * name, const DateTime * date){
 
-    //write the card to the file
-    fprintf(fp, "BEGIN:VCARD\r\n");
+    emitString(writer, name);
+
+    //text dates are just their text, otherwise the date then T and the time if there is one
+    if(date->isText){
+        emitString(writer, date->text);
+    } else {
+        emitString(writer, date->date);
+        if(date->time != NULL && date->time[0] != '\0'){
+            emitText(writer, "T", 1);
+            emitString(writer, date->time);
+        }
+    }
+
+    emitLineEnd(writer);
+}
+
+static void emitProperty(LineWriter * writer, const Property * prop){
+
+    //if the property belongs to a group, print group and a dot
+    if(prop->group != NULL && prop->group[0] != '\0'){
+        emitString(writer, prop->group);
+        emitText(writer, ".", 1);
+    }
+
+    //print the property name
+    emitString(writer, prop->name);
+
+    //print any parameters
+    if(prop->parameters != NULL){
+        void * paramElem;
+        ListIterator paramIter = createIterator(prop->parameters);
+        while((paramElem = nextElement(&paramIter)) != NULL){
+            Parameter * param = (Parameter*)paramElem;
+            emitText(writer, ";", 1);
+            emitString(writer, param->name);
+            emitText(writer, "=", 1);
+            emitString(writer, param->value);
+        }
+    }
 
+    //print the colon the start the value list
+    emitText(writer, ":", 1);
+
+    //print property values separated by semicolons
+    if(prop->values != NULL){
+        void * valElem;
+        ListIterator valIter = createIterator(prop->values);
+        while((valElem = nextElement(&valIter)) != NULL){
+            emitString(writer, (char*)valElem);
+            if(valIter.current != NULL){
+                emitText(writer, ";", 1);
+            }
+        }
+    }
+    emitLineEnd(writer);
+}
+
+static void emitCard(LineWriter * writer, const Card * obj){
+
+    emitString(writer, "BEGIN:VCARD");
+    emitLineEnd(writer);
 
     //write the version line which is always 4.0
-    fprintf(fp, "VERSION:4.0\r\n");
+    emitString(writer, "VERSION:4.0");
+    emitLineEnd(writer);
 
     //write the FN property
-    if(obj->fn != NULL){
-        //assume that FN's value is always stored as the first value in the list
-        if(obj->fn->values != NULL && obj->fn->values->head != NULL){
-            fprintf(fp, "FN:%s\r\n", (char*)obj->fn->values->head->data);
-        }
+    //assume that FN's value is always stored as the first value in the list
+    if(obj->fn != NULL && obj->fn->values != NULL && obj->fn->values->head != NULL){
+        emitString(writer, "FN:");
+        emitString(writer, (char*)obj->fn->values->head->data);
+        emitLineEnd(writer);
     }
 
     //write the optional properties
@@ -679,70 +1152,217 @@ VCardErrorCode writeCard(const char* fileName, const Card* obj) {
         void * elem;
         ListIterator iter = createIterator(obj->optionalProperties);
         while((elem = nextElement(&iter)) != NULL){
-            Property * prop = (Property*)elem;
-            
-            //if the property belongs to a group, print group and a dot
-            if(prop->group != NULL && strlen(prop->group) > 0){
-                fprintf(fp, "%s.", prop->group);
-            }
-
-            //print the property name
-            fprintf(fp, "%s", prop->name);
-            
-
-            //print any parameters
-            if(prop->parameters != NULL && getLength(prop->parameters) > 0){
-                void * paramElem;
-                ListIterator paramIter = createIterator(prop->parameters);
-                while((paramElem = nextElement(&paramIter)) != NULL){
-                    Parameter * param = (Parameter*)paramElem;
-                    fprintf(fp, ";%s=%s", param->name, param->value);
-                }
-            }
-
-            //print the colon the start the value list
-            fprintf(fp, ":");
-            
-            //print property values separated by commas
-            if(prop->values != NULL && getLength(prop->values) > 0){
-                void * valElem;
-                ListIterator valIter = createIterator(prop->values);
-                while((valElem = nextElement(&valIter)) != NULL){
-                    char * value = (char*)valElem;
-                    fprintf(fp, "%s", value);
-                    if(valIter.current != NULL){
-                        fprintf(fp, ";");
-                    }
-                }
-            }
-            fprintf(fp, "\r\n");
+            emitProperty(writer, (Property*)elem);
         }
     }
 
-    //write the birthday
+    //write the birthday and anniversary
     if(obj->birthday != NULL){
-        char * bdayString = dateToString(obj->birthday);
-        fprintf(fp, "BDAY:%s\r\n", bdayString);
-        free(bdayString);
+        emitDate(writer, "BDAY:", obj->birthday);
     }
 
-    //write the anniversary
     if(obj->anniversary != NULL){
-        char * annString = dateToString(obj->anniversary);
-        fprintf(fp, "ANNIVERSARY:%s\r\n", annString);
-        free(annString);
+        emitDate(writer, "ANNIVERSARY:", obj->anniversary);
     }
 
     //write the end
-    fprintf(fp, "END:VCARD\r\n");
+    emitString(writer, "END:VCARD");
+    emitLineEnd(writer);
+}
+
+//length of a card in vCard format, folding included
+size_t cardTextLength(const Card * obj){
+
+    LineWriter writer = { NULL, 0, 0 };
+    emitCard(&writer, obj);
+    return writer.length;
+}
+
+//appends a card in vCard format to a builder
+void appendCardText(StringBuilder * builder, const Card * obj){
+
+    LineWriter writer = { builder, 0, 0 };
+    emitCard(&writer, obj);
+}
+
+/*
+    This function serializes a card into a new builder, sized to fit it exactly
+*/
+static bool serializeCard(const Card * obj, StringBuilder * builder){
 
-    //close the file
-    fclose(fp);
+    initializeStringBuilder(builder, cardTextLength(obj));
+    appendCardText(builder, obj);
+
+    if(builder->failed){
+        freeStringBuilder(builder);
+        return false;
+    }
+    return true;
+}
+
+/*
+    This function serializes a card and writes it to fileName in place, or atomically through a temporary file
+*/
+static VCardErrorCode writeCardFile(const char* fileName, const Card* obj, bool atomic){
+
+    //check if the file name and card object are null
+    if(fileName == NULL || obj == NULL){
+        return WRITE_ERROR;
+    }
+
+    //check if the file extension is valid
+    if(!validFileExtension(fileName)){
+        return WRITE_ERROR;
+    }
+
+    StringBuilder builder;
+    if(!serializeCard(obj, &builder)){
+        return OTHER_ERROR;
+    }
+
+    OutputFile out;
+    if(!openOutputFile(&out, fileName, atomic)){
+        freeStringBuilder(&builder);
+        return WRITE_ERROR;
+    }
+
+    bool written = writeOutputFile(&out, builder.data, builder.length);
+    freeStringBuilder(&builder);
+
+    if(!closeOutputFile(&out, written) || !written){
+        return WRITE_ERROR;
+    }
 
     return OK;
+}
 
+//this function will take the card object and write it to a file
+//the whole card is serialized into memory first and then written with a single write call
+//content lines longer than 75 octets are folded
+VCardErrorCode writeCard(const char* fileName, const Card* obj) {
+    return writeCardFile(fileName, obj, false);
 }
 
+/*
+    This function serializes a card into memory the caller owns.  The length pass runs first, so a buffer
+    that is too small is never partly written past its end, and a NULL buffer only reports the size
+*/
+VCardErrorCode writeCardToBuffer(const Card* obj, char* buffer, size_t size, size_t* length){
+
+    if(length != NULL){
+        *length = 0;
+    }
+
+    if(obj == NULL || (buffer == NULL && size != 0)){
+        return WRITE_ERROR;
+    }
+
+    size_t needed = cardTextLength(obj);
+    if(length != NULL){
+        *length = needed;
+    }
+
+    //size only pass
+    if(buffer == NULL){
+        return OK;
+    }
+
+    if(needed >= size){
+        return WRITE_ERROR;
+    }
+
+    StringBuilder builder;
+    initializeFixedStringBuilder(&builder, buffer, size);
+    appendCardText(&builder, obj);
+
+    return builder.failed ? WRITE_ERROR : OK;
+}
+
+/*
+    This function serializes a card into a new string sized to fit it exactly
+*/
+VCardErrorCode writeCardToString(const Card* obj, char** text, size_t* length){
+
+    if(length != NULL){
+        *length = 0;
+    }
+
+    if(text == NULL){
+        return WRITE_ERROR;
+    }
+    *text = NULL;
+
+    if(obj == NULL){
+        return WRITE_ERROR;
+    }
+
+    StringBuilder builder;
+    if(!serializeCard(obj, &builder)){
+        return OTHER_ERROR;
+    }
+
+    if(length != NULL){
+        *length = builder.length;
+    }
+    *text = builderTakeString(&builder);
+
+    return OK;
+}
+
+/*
+    This function is writeCard, except the card goes to a temporary file in the same directory that is
+    flushed to disk and then renamed over fileName.  Readers see either the old file or the whole new one,
+    even if the process or machine dies part way through
+*/
+VCardErrorCode writeCardAtomic(const char* fileName, const Card* obj){
+    return writeCardFile(fileName, obj, true);
+}
+
+
+/*
+    This function is writeCard with the result also left in ctx, or writeCardAtomic if the context asks
+    for it.  Neither keeps shared state, so cards can be written on several threads at once as long as each thread uses its own context
+*/
+VCardErrorCode writeCardWithContext(VCardContext* ctx, const char* fileName, const Card* obj){
+
+    VCardErrorCode error = (ctx != NULL && ctx->atomicWrite) ? writeCardAtomic(fileName, obj) : writeCard(fileName, obj);
+    if(ctx != NULL){
+        contextError(ctx, error, 0);
+    }
+    return error;
+}
+
+
+//properties from RFC 6350 that validateCard accepts, by id
+static const bool validatedProperties[PROP_ID_COUNT] = {
+    [PROP_FN] = true, [PROP_N] = true, [PROP_BDAY] = true, [PROP_ANNIVERSARY] = true, [PROP_GENDER] = true,
+    [PROP_ADR] = true, [PROP_TEL] = true, [PROP_EMAIL] = true, [PROP_IMPP] = true, [PROP_LANG] = true,
+    [PROP_TZ] = true, [PROP_GEO] = true, [PROP_TITLE] = true, [PROP_ROLE] = true, [PROP_LOGO] = true,
+    [PROP_ORG] = true, [PROP_MEMBER] = true, [PROP_RELATED] = true, [PROP_CATEGORIES] = true, [PROP_NOTE] = true,
+    [PROP_PRODID] = true, [PROP_REV] = true, [PROP_SOUND] = true, [PROP_UID] = true, [PROP_CLIENTPIDMAP] = true,
+    [PROP_URL] = true, [PROP_KEY] = true, [PROP_FBURL] = true, [PROP_CALADRURI] = true, [PROP_CALURI] = true
+};
+
+//properties that must have at least one value, by id
+static const bool mustHaveValues[PROP_ID_COUNT] = {
+    [PROP_FN] = true, [PROP_N] = true, [PROP_TEL] = true, [PROP_EMAIL] = true, [PROP_IMPP] = true,
+    [PROP_LANG] = true, [PROP_TZ] = true, [PROP_GEO] = true, [PROP_TITLE] = true, [PROP_ROLE] = true,
+    [PROP_ORG] = true, [PROP_MEMBER] = true, [PROP_RELATED] = true, [PROP_URL] = true
+};
+
+//the id of a property's name.  The stored id is only used when it still names the property, since a property
+//built by hand may never have had it set and one that was renamed still has the old name's id
+static PropertyId checkedPropertyId(const Property * prop){
+
+    if(prop->name == NULL){
+        return PROP_OTHER;
+    }
+
+    if((unsigned)prop->id < PROP_ID_COUNT && prop->id != PROP_OTHER && strcasecmp(propertyIdName(prop->id), prop->name) == 0){
+        return prop->id;
+    }
+    return propertyIdFromName(prop->name, strlen(prop->name));
+}
 
 //will expand on the card validation by checking the properties and their values
 VCardErrorCode validateCard(const Card* obj){
@@ -762,97 +1382,59 @@ VCardErrorCode validateCard(const Card* obj){
         return INV_CARD;
     }
 
-    //check the version property in the optional properties
-    void * element;
-
-
-    //iterate through the optional properties to find the version property, if it is found then return INV_CARD
-    ListIterator iterator = createIterator(obj->optionalProperties);
-    while((element = nextElement(&iterator)) != NULL){
-        Property * prop = (Property*)element;
-        if(strcasecmp(prop->name, "VERSION") == 0){
-            return INV_CARD;
-        }
-    }
-    
-
-    //validate all properties are from RFC 6350
-    const char * validProperties[] = {
-        "FN", "N", "BDAY", "ANNIVERSARY", "GENDER", "ADR", "TEL", "EMAIL",
-        "IMPP", "LANG", "TZ", "GEO", "TITLE", "ROLE", "LOGO", "ORG",
-        "MEMBER", "RELATED", "CATEGORIES", "NOTE", "PRODID", "REV", "SOUND",
-        "UID", "CLIENTPIDMAP", "URL", "KEY", "FBURL", "CALADRURI", "CALURI"
-    };
+    //go through the optional properties once, noting each problem.  A VERSION property outranks
+    //any other problem, then invalid properties come before misplaced dates
+    bool foundVersion = false;
+    bool invalidProp = false;
+    bool foundDate = false;
+    int nCount = 0;
 
-    //iterate through the optional properties
     void * elem;
     ListIterator iter = createIterator(obj->optionalProperties);
-
-    //bool to check if FN is found
-    //bool foundN = false;
-    int nCount = 0;
-
     while((elem = nextElement(&iter)) != NULL){
         Property * prop = (Property*)elem;
 
-        //ensure name is not null or empty
-        if(prop->name == NULL || strlen(prop->name) == 0){
-            return INV_PROP;
-        }
+        PropertyId id = checkedPropertyId(prop);
 
-        //ensure property name is valid
-        bool validProp = false;
-        for(int i = 0; i < sizeof(validProperties) / sizeof(validProperties[0]); i++){
-            if(strcasecmp(validProperties[i], prop->name) == 0){
-                validProp = true;
-                break;
-            }
+        if(id == PROP_VERSION){
+            foundVersion = true;
         }
-        if(!validProp){
-            return INV_PROP;
+        if(id == PROP_BDAY || id == PROP_ANNIVERSARY){
+            foundDate = true;
         }
 
-        //ensure paramaters and value lists are not null
-        if(prop->parameters == NULL || prop->values == NULL){
-            return INV_PROP;
+        //ensure name is not null or empty, and is one that is validated
+        if(prop->name == NULL || strlen(prop->name) == 0 || !validatedProperties[id]){
+            invalidProp = true;
+            continue;
         }
 
-        //check for duplicate version property
-        if(strcasecmp(prop->name, "VERSION") == 0){
-            return INV_PROP;
+        //ensure paramaters and value lists are not null
+        if(prop->parameters == NULL || prop->values == NULL){
+            invalidProp = true;
+            continue;
         }
 
         //special cases for cardinality
-        if(strcasecmp(prop->name, "N") == 0){
+        if(id == PROP_N){
             nCount++;
             if(getLength(prop->values) != 5){
-                return INV_PROP;
+                invalidProp = true;
             }
         }
 
-        //check for empty values
-        //some properties can have empty values
-        const char * mustHaveValues[] = {
-            "FN", "N", "TEL", "EMAIL", "IMPP", "LANG", "TZ", "GEO", 
-            "TITLE", "ROLE", "ORG", "MEMBER", "RELATED", "URL"
-        };
-
-        //check if the property requires a value
-        bool requiresValue = false;
-        for(int i = 0; i < sizeof(mustHaveValues) / sizeof(mustHaveValues[0]); i++){
-            if(strcasecmp(mustHaveValues[i], prop->name) == 0){
-                requiresValue = true;
-                break;
-            }
+        //check if the property has values, some properties can have empty values
+        if(mustHaveValues[id] && getLength(prop->values) == 0){
+            invalidProp = true;
         }
+    }
 
-        //check if the property has values
-        if(requiresValue && getLength(prop->values) == 0){
-            return INV_PROP;
-        }
+    //VERSION belongs to the card and is never an optional property
+    if(foundVersion){
+        return INV_CARD;
     }
 
-    if(nCount > 1){
+    if(invalidProp || nCount > 1){
         return INV_PROP;
     }
 
@@ -893,19 +1475,9 @@ VCardErrorCode validateCard(const Card* obj){
         }
     }
 
-    //check optional properties for invalid bday/anniversary placement
-    void * elem2;
-    ListIterator iter2 = createIterator(obj->optionalProperties);
-    while((elem2 = nextElement(&iter2)) != NULL){
-        Property * prop = (Property*)elem2;
-        
-        if(strcasecmp(prop->name, "VERSION") == 0){
-            return INV_CARD;
-        }
-
-        if(strcasecmp(prop->name, "BDAY") == 0 || strcasecmp(prop->name, "ANNIVERSARY") == 0){
-            return INV_DT;
-        } 
+    //BDAY and ANNIVERSARY belong in the card's date fields, not the optional properties
+    if(foundDate){
+        return INV_DT;
     }
 
 
@@ -915,11 +1487,14 @@ VCardErrorCode validateCard(const Card* obj){
 }
 
 
+/*
+    This function is validateCard with the result also left in ctx, for use alongside createCardWithContext
+*/
+VCardErrorCode validateCardWithContext(VCardContext* ctx, const Card* obj){
 
-
-
-
-
-
-
-
+    VCardErrorCode error = validateCard(obj);
+    if(ctx != NULL){
+        contextError(ctx, error, 0);
+    }
+    return error;
+}
@@ -0,0 +1,91 @@
+#include <strings.h>
+
+#include "VCParser.h"
+
+/*
+    Property names from RFC 6350 are resolved to a PropertyId with a perfect hash.  The hash only looks at the
+    length and the first, second and last letters, folded to lower case, and no two known names share a slot,
+    so a lookup is one table read and one compare against the name in that slot
+*/
+
+#define PROPERTY_SLOTS 128
+
+//canonical spelling of each id, in the same order as PropertyId
+static const char * const propertyNames[PROP_ID_COUNT] = {
+    "", "SOURCE", "KIND", "XML", "FN", "N", "NICKNAME", "PHOTO", "BDAY", "ANNIVERSARY", "GENDER", "ADR",
+    "TEL", "EMAIL", "IMPP", "LANG", "TZ", "GEO", "TITLE", "ROLE", "LOGO", "ORG", "MEMBER", "RELATED",
+    "CATEGORIES", "NOTE", "PRODID", "REV", "SOUND", "UID", "CLIENTPIDMAP", "URL", "VERSION", "KEY",
+    "FBURL", "CALADRURI", "CALURI"
+};
+
+static const size_t propertyNameLengths[PROP_ID_COUNT] = {
+    0, 6, 4, 3, 2, 1, 8, 5, 4, 11, 6, 3, 3, 5, 4, 4, 2, 3, 5, 4, 4, 3, 6, 7, 10, 4, 6, 3, 5, 3, 12, 3, 7, 3, 5, 9, 6
+};
+
+//the id in each hash slot, PROP_OTHER where no known name lands
+static const unsigned char propertySlots[PROPERTY_SLOTS] = {
+    PROP_OTHER, PROP_VERSION, PROP_OTHER, PROP_OTHER,
+    PROP_ADR, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_CATEGORIES, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_PHOTO, PROP_OTHER, PROP_XML,
+    PROP_FN, PROP_GENDER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_MEMBER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_CLIENTPIDMAP,
+    PROP_URL, PROP_IMPP, PROP_OTHER, PROP_OTHER,
+    PROP_LOGO, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_LANG, PROP_RELATED, PROP_TZ, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_KIND,
+    PROP_OTHER, PROP_CALURI, PROP_OTHER, PROP_OTHER,
+    PROP_CALADRURI, PROP_REV, PROP_OTHER, PROP_OTHER,
+    PROP_UID, PROP_OTHER, PROP_BDAY, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_NICKNAME, PROP_OTHER,
+    PROP_OTHER, PROP_TITLE, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_KEY, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_FBURL,
+    PROP_SOUND, PROP_OTHER, PROP_NOTE, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_ROLE, PROP_OTHER,
+    PROP_OTHER, PROP_SOURCE, PROP_PRODID, PROP_N,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_TEL,
+    PROP_ANNIVERSARY, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_ORG, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_GEO, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_OTHER, PROP_OTHER,
+    PROP_OTHER, PROP_OTHER, PROP_EMAIL, PROP_OTHER,
+};
+
+
+static unsigned int propertySlot(const char * name, size_t length){
+
+    //or-ing in 0x20 lower cases letters, anything else that collides is caught by the compare
+    unsigned int first = (unsigned char)name[0] | 0x20;
+    unsigned int second = length > 1 ? ((unsigned char)name[1] | 0x20) : 0;
+    unsigned int last = (unsigned char)name[length - 1] | 0x20;
+
+    return (first + second * 4 + last * 8 + (unsigned int)length) & (PROPERTY_SLOTS - 1);
+}
+
+PropertyId propertyIdFromName(const char* name, size_t length){
+
+    if(name == NULL || length == 0){
+        return PROP_OTHER;
+    }
+
+    PropertyId id = (PropertyId)propertySlots[propertySlot(name, length)];
+    if(id != PROP_OTHER && propertyNameLengths[id] == length && strncasecmp(propertyNames[id], name, length) == 0){
+        return id;
+    }
+    return PROP_OTHER;
+}
+
+const char* propertyIdName(PropertyId id){
+
+    if(id < PROP_OTHER || id >= PROP_ID_COUNT){
+        return "";
+    }
+    return propertyNames[id];
+}
@@ -0,0 +1,334 @@
+#include "VCPush.h"
+#include "VCHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+
+
+struct vCardPushParser {
+    CardHandler handler;
+    void * handlerData;
+
+    //parse state and options for the card being read
+    VCardContext ctx;
+    Card * card;
+
+    //set once the handler asks to stop, nothing more is parsed until the input is finished
+    bool stopped;
+
+    //set after a card fails to parse so the rest of it is skipped
+    bool skipToEnd;
+
+    //a physical line that has not had its LF yet
+    ByteBuffer partial;
+
+    //the unfolded line waiting to see whether the next line continues it.  While it is unchanged
+    //from the chunk being fed it is only a span into that chunk, and is copied into logical when
+    //the chunk runs out or a continuation line has to be added to it
+    bool hasLogical;
+    const char * logicalSpan;
+    size_t logicalSpanLength;
+    ByteBuffer logical;
+
+    //physical lines seen so far, and the line the waiting unfolded line started on
+    int linesRead;
+    int logicalLine;
+};
+
+
+//moves the waiting unfolded line out of the chunk and into the parser's own buffer
+static bool keepLogical(VCardPushParser * parser){
+
+    if(parser->hasLogical && parser->logicalSpan != NULL){
+        parser->logical.length = 0;
+        if(!appendBytes(&parser->logical, parser->logicalSpan, parser->logicalSpanLength)){
+            return false;
+        }
+        parser->logicalSpan = NULL;
+    }
+    return true;
+}
+
+//starts a new card state, keeping the options
+static void resetPushCard(VCardPushParser * parser){
+
+    resetCardState(&parser->ctx);
+
+    deleteCard(parser->card);
+    parser->card = NULL;
+}
+
+//hands an error for the current card to the handler and skips the rest of it
+static void reportCardError(VCardPushParser * parser, VCardErrorCode error, int line){
+
+    parser->skipToEnd = !parser->ctx.foundEnd;
+    resetPushCard(parser);
+
+    if(!parser->handler(parser->handlerData, NULL, error, line)){
+        parser->stopped = true;
+    }
+}
+
+//parses the waiting unfolded line, handing the card over once its END line is in
+static VCardErrorCode parseLogical(VCardPushParser * parser){
+
+    const char * line = parser->logicalSpan ? parser->logicalSpan : parser->logical.data;
+    size_t length = parser->logicalSpan ? parser->logicalSpanLength : parser->logical.length;
+
+    parser->hasLogical = false;
+    parser->logicalSpan = NULL;
+
+    //blank lines are skipped
+    if(length == 0){
+        return OK;
+    }
+
+    if(parser->card == NULL){
+        CardArena * arena = NULL;
+        if(parser->ctx.useArena){
+            arena = createArena(4096);
+            if(arena == NULL){
+                return OTHER_ERROR;
+            }
+        }
+
+        parser->card = initializeCard(arena, nodePoolAllocator(parser->ctx.nodePool));
+        if(parser->card == NULL){
+            freeArena(arena);
+            return OTHER_ERROR;
+        }
+    }
+
+    if(!parseSingleVCardLine(line, length, parser->card, &parser->ctx)){
+        reportCardError(parser, parser->ctx.error, parser->logicalLine);
+        return OK;
+    }
+
+    if(!parser->ctx.done){
+        return OK;
+    }
+
+    //the card is complete
+    if(parser->card->fn == NULL || !parser->ctx.foundVersion){
+        reportCardError(parser, INV_CARD, 0);
+        return OK;
+    }
+
+    Card * card = parser->card;
+    parser->card = NULL;
+    resetPushCard(parser);
+
+    if(parser->ctx.sortProperties){
+        sortCardProperties(card);
+    }
+
+    if(!parser->handler(parser->handlerData, card, OK, 0)){
+        parser->stopped = true;
+    }
+    return OK;
+}
+
+//handles one physical line, including its line ending.  inChunk is set if the line is part of
+//the chunk being fed and can be pointed at rather than copied
+static VCardErrorCode handlePhysicalLine(VCardPushParser * parser, const char * line, size_t length, bool inChunk){
+
+    parser->linesRead++;
+
+    //skip the rest of a card that failed, stopping after its END or before the next BEGIN
+    if(parser->skipToEnd){
+        if(length >= 4 && strncasecmp(line, "END:", 4) == 0){
+            parser->skipToEnd = false;
+            return OK;
+        }
+        if(length < 6 || strncasecmp(line, "BEGIN:", 6) != 0){
+            return OK;
+        }
+        parser->skipToEnd = false;
+    }
+
+    //every line has to end in CRLF, and that is checked before the line waiting ahead of it is parsed
+    if(length < 2 || line[length - 2] != '\r' || line[length - 1] != '\n'){
+        size_t waiting = parser->logicalSpan ? parser->logicalSpanLength : parser->logical.length;
+        bool inCard = parser->ctx.foundBegin || (parser->hasLogical && waiting > 0);
+
+        parser->hasLogical = false;
+        parser->logicalSpan = NULL;
+
+        //outside of a card there is no card to blame, so the input as a whole is bad
+        if(!inCard){
+            resetPushCard(parser);
+            parser->stopped = true;
+            return INV_FILE;
+        }
+
+        reportCardError(parser, INV_CARD, parser->linesRead);
+        return OK;
+    }
+    length -= 2;
+
+    //a continuation line is added to the waiting line without its leading whitespace
+    if(length > 0 && (line[0] == ' ' || line[0] == '\t')){
+        if(!parser->hasLogical){
+            parser->hasLogical = true;
+            parser->logicalSpan = NULL;
+            parser->logical.length = 0;
+            parser->logicalLine = parser->linesRead;
+        }
+
+        if(!keepLogical(parser) || !appendBytes(&parser->logical, line + 1, length - 1)){
+            return OTHER_ERROR;
+        }
+        return OK;
+    }
+
+    //a fresh line means the waiting line is complete
+    if(parser->hasLogical){
+        VCardErrorCode error = parseLogical(parser);
+        if(error != OK){
+            return error;
+        }
+
+        if(parser->stopped){
+            return OK;
+        }
+
+        //the card this line belonged to failed, so it is skipped with the rest
+        if(parser->skipToEnd){
+            parser->linesRead--;
+            return handlePhysicalLine(parser, line, length + 2, inChunk);
+        }
+    }
+
+    parser->hasLogical = true;
+    parser->logicalLine = parser->linesRead;
+    if(inChunk){
+        parser->logicalSpan = line;
+        parser->logicalSpanLength = length;
+    } else {
+        parser->logicalSpan = NULL;
+        parser->logical.length = 0;
+        if(!appendBytes(&parser->logical, line, length)){
+            return OTHER_ERROR;
+        }
+    }
+
+    return OK;
+}
+
+
+VCardPushParser* createPushParser(const VCardContext* options, CardHandler handler, void* handlerData){
+
+    if(handler == NULL){
+        return NULL;
+    }
+
+    VCardPushParser * parser = calloc(1, sizeof(VCardPushParser));
+    if(parser == NULL){
+        return NULL;
+    }
+
+    parser->handler = handler;
+    parser->handlerData = handlerData;
+
+    if(options != NULL){
+        parser->ctx = *options;
+        resetCardState(&parser->ctx);
+    } else {
+        initializeContext(&parser->ctx);
+    }
+
+    return parser;
+}
+
+VCardErrorCode pushCardBytes(VCardPushParser* parser, const char* data, size_t length){
+
+    if(parser == NULL || (data == NULL && length > 0)){
+        return OTHER_ERROR;
+    }
+
+    const char * p = data;
+    const char * end = data + length;
+    VCardErrorCode error = OK;
+
+    while(p < end && !parser->stopped && error == OK){
+        const char * lf = memchr(p, '\n', end - p);
+
+        if(lf == NULL){
+            //the rest of the chunk is the start of a line
+            if(!appendBytes(&parser->partial, p, end - p)){
+                error = OTHER_ERROR;
+            }
+            break;
+        }
+
+        if(parser->partial.length > 0){
+            //finish the line that started in an earlier chunk
+            if(!appendBytes(&parser->partial, p, lf + 1 - p)){
+                error = OTHER_ERROR;
+                break;
+            }
+            error = handlePhysicalLine(parser, parser->partial.data, parser->partial.length, false);
+            parser->partial.length = 0;
+        } else {
+            error = handlePhysicalLine(parser, p, lf + 1 - p, true);
+        }
+
+        p = lf + 1;
+    }
+
+    //the chunk belongs to the caller, so a waiting line that points into it has to be copied
+    if(!keepLogical(parser) && error == OK){
+        error = OTHER_ERROR;
+    }
+
+    return error;
+}
+
+VCardErrorCode finishPushParser(VCardPushParser* parser){
+
+    if(parser == NULL){
+        return OTHER_ERROR;
+    }
+
+    VCardErrorCode error = OK;
+
+    if(!parser->stopped){
+        if(parser->partial.length > 0){
+            //the last line never got its line ending
+            error = handlePhysicalLine(parser, parser->partial.data, parser->partial.length, false);
+        } else if(parser->hasLogical){
+            error = parseLogical(parser);
+        }
+
+        //a card that never reached its END line
+        if(error == OK && !parser->stopped && parser->ctx.foundBegin){
+            reportCardError(parser, INV_CARD, 0);
+        }
+    }
+
+    //ready for a new input
+    resetPushCard(parser);
+    parser->stopped = false;
+    parser->skipToEnd = false;
+    parser->hasLogical = false;
+    parser->logicalSpan = NULL;
+    parser->partial.length = 0;
+    parser->logical.length = 0;
+    parser->linesRead = 0;
+
+    return error;
+}
+
+void deletePushParser(VCardPushParser* parser){
+
+    if(parser == NULL){
+        return;
+    }
+
+    deleteCard(parser->card);
+    free(parser->partial.data);
+    free(parser->logical.data);
+    free(parser);
+}
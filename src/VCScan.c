@@ -0,0 +1,176 @@
+#include "VCScan.h"
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+
+//bytes the scanner marks
+static const bool isDelimiter[256] = {
+    ['\r'] = true, ['\n'] = true, [':'] = true, [';'] = true,
+    ['='] = true, [','] = true, ['.'] = true, ['\\'] = true
+};
+
+
+//each kernel fills one bitmap word for each whole 64 byte block
+typedef void (*ScanKernel)(const char * data, size_t blocks, uint64_t * bitmap);
+
+
+static void scanBlocksScalar(const char * data, size_t blocks, uint64_t * bitmap){
+
+    for(size_t b = 0; b < blocks; b++){
+        uint64_t word = 0;
+        const unsigned char * block = (const unsigned char *)data + b * 64;
+
+        for(int i = 0; i < 64; i++){
+            word |= (uint64_t)isDelimiter[block[i]] << i;
+        }
+        bitmap[b] = word;
+    }
+}
+
+
+#if defined(__x86_64__)
+
+//SSE2 is part of x86-64, so this kernel needs no check
+static inline uint32_t matchSSE2(__m128i v){
+
+    __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('=')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+
+    return (uint32_t)_mm_movemask_epi8(m);
+}
+
+static void scanBlocksSSE2(const char * data, size_t blocks, uint64_t * bitmap){
+
+    for(size_t b = 0; b < blocks; b++){
+        const char * block = data + b * 64;
+
+        uint64_t m0 = matchSSE2(_mm_loadu_si128((const __m128i *)block));
+        uint64_t m1 = matchSSE2(_mm_loadu_si128((const __m128i *)(block + 16)));
+        uint64_t m2 = matchSSE2(_mm_loadu_si128((const __m128i *)(block + 32)));
+        uint64_t m3 = matchSSE2(_mm_loadu_si128((const __m128i *)(block + 48)));
+
+        bitmap[b] = m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t matchAVX2(__m256i v){
+
+    __m256i m = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('=')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+
+    return (uint32_t)_mm256_movemask_epi8(m);
+}
+
+__attribute__((target("avx2")))
+static void scanBlocksAVX2(const char * data, size_t blocks, uint64_t * bitmap){
+
+    for(size_t b = 0; b < blocks; b++){
+        const char * block = data + b * 64;
+
+        uint64_t lo = matchAVX2(_mm256_loadu_si256((const __m256i *)block));
+        uint64_t hi = matchAVX2(_mm256_loadu_si256((const __m256i *)(block + 32)));
+
+        bitmap[b] = lo | (hi << 32);
+    }
+}
+
+#endif
+
+
+static ScanKernel scanKernel = &scanBlocksScalar;
+static const char * scanKernelName = "scalar";
+
+//picks the best kernel the CPU supports once, when the library is loaded
+__attribute__((constructor))
+static void chooseScanKernel(void){
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        scanKernel = &scanBlocksAVX2;
+        scanKernelName = "avx2";
+    } else {
+        scanKernel = &scanBlocksSSE2;
+        scanKernelName = "sse2";
+    }
+#endif
+}
+
+
+void scanDelimiters(const char * data, size_t length, uint64_t * bitmap){
+
+    size_t blocks = length / 64;
+    scanKernel(data, blocks, bitmap);
+
+    //the last partial block is copied out so the kernel never reads past the end of the span
+    size_t left = length - blocks * 64;
+    if(left > 0){
+        char tail[64];
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, data + blocks * 64, left);
+        scanKernel(tail, 1, bitmap + blocks);
+    }
+}
+
+void startDelimiterCursor(DelimiterCursor * cursor, const char * data, size_t length){
+
+    cursor->data = data;
+    cursor->length = length;
+    cursor->windowStart = 0;
+    cursor->wordIndex = 0;
+    cursor->wordCount = 0;
+}
+
+const char * nextDelimiter(DelimiterCursor * cursor){
+
+    while(true){
+        //take the lowest set bit left in the window
+        while(cursor->wordIndex < cursor->wordCount){
+            uint64_t word = cursor->bitmap[cursor->wordIndex];
+            if(word != 0){
+                cursor->bitmap[cursor->wordIndex] = word & (word - 1);
+                size_t offset = cursor->windowStart + cursor->wordIndex * 64 + (size_t)__builtin_ctzll(word);
+                return cursor->data + offset;
+            }
+            cursor->wordIndex++;
+        }
+
+        //then scan the next window
+        size_t nextStart = cursor->windowStart + cursor->wordCount * 64;
+        if(nextStart >= cursor->length){
+            return NULL;
+        }
+
+        size_t windowLength = cursor->length - nextStart;
+        if(windowLength > SCAN_WINDOW_WORDS * 64){
+            windowLength = SCAN_WINDOW_WORDS * 64;
+        }
+
+        scanDelimiters(cursor->data + nextStart, windowLength, cursor->bitmap);
+        cursor->windowStart = nextStart;
+        cursor->wordIndex = 0;
+        cursor->wordCount = (windowLength + 63) / 64;
+    }
+}
+
+const char * delimiterScannerName(void){
+    return scanKernelName;
+}
@@ -0,0 +1,568 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCWatch.h"
+#include "VCBatch.h"
+#include "VCHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+
+
+//events that mean a card file has a new state: written and closed, moved in or out, or deleted
+#define CARD_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+
+//events that mean the directory itself has gone
+#define GONE_EVENTS (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED)
+
+typedef struct watchEntry {
+    WatchedCard card;
+    size_t hash;
+
+    //where the entry is in the watcher's entries array
+    int position;
+
+    struct watchEntry * nextInBucket;
+} WatchEntry;
+
+struct vCardWatcher {
+    char * dirName;
+    int fd;
+    bool gone;
+
+    //threads and options for parsing
+    int threads;
+    VCardContext options;
+
+    //entries by file name, chained
+    WatchEntry ** buckets;
+    size_t bucketCount;
+
+    //every entry, packed so they can be read by position
+    WatchEntry ** entries;
+    int entryCount;
+    int entryCapacity;
+
+    //changes made by the last update, each with its own copy of the file name
+    CardChange * changes;
+    int changeCount;
+    int changeCapacity;
+};
+
+//the new state of one file, worked out on a pool thread and then put in the index
+typedef struct refresh {
+    char * fileName;
+    bool exists;
+    WatchedCard card;
+} Refresh;
+
+typedef struct refreshJob {
+    VCardWatcher * watcher;
+    Refresh * refreshes;
+
+    //one context per worker thread
+    VCardContext * contexts;
+} RefreshJob;
+
+
+//FNV-1a over the file name
+static size_t hashFileName(const char * fileName){
+
+    size_t hash = 2166136261u;
+    for(const unsigned char * c = (const unsigned char *)fileName; *c != '\0'; c++){
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+static WatchEntry * findEntry(const VCardWatcher * watcher, const char * fileName, size_t hash){
+
+    WatchEntry * entry = watcher->buckets[hash & (watcher->bucketCount - 1)];
+    while(entry != NULL && (entry->hash != hash || strcmp(entry->card.fileName, fileName) != 0)){
+        entry = entry->nextInBucket;
+    }
+    return entry;
+}
+
+//frees the strings of a card summary
+static void clearWatchedCard(WatchedCard * card){
+    free(card->fileName);
+    free(card->fn);
+    free(card->birthday);
+    free(card->anniversary);
+    memset(card, 0, sizeof(WatchedCard));
+}
+
+static bool sameText(const char * first, const char * second){
+    if(first == NULL || second == NULL){
+        return first == second;
+    }
+    return strcmp(first, second) == 0;
+}
+
+static bool sameSummary(const WatchedCard * first, const WatchedCard * second){
+    return first->error == second->error && first->otherCount == second->otherCount && sameText(first->fn, second->fn)
+        && sameText(first->birthday, second->birthday) && sameText(first->anniversary, second->anniversary);
+}
+
+//doubles the table once it is three quarters full, keeping chains short
+static void growBuckets(VCardWatcher * watcher){
+
+    if((size_t)watcher->entryCount * 4 < watcher->bucketCount * 3){
+        return;
+    }
+
+    size_t count = watcher->bucketCount * 2;
+    WatchEntry ** buckets = calloc(count, sizeof(WatchEntry*));
+    if(buckets == NULL){
+        //the chains just get longer
+        return;
+    }
+
+    for(int i = 0; i < watcher->entryCount; i++){
+        WatchEntry * entry = watcher->entries[i];
+        entry->nextInBucket = buckets[entry->hash & (count - 1)];
+        buckets[entry->hash & (count - 1)] = entry;
+    }
+
+    free(watcher->buckets);
+    watcher->buckets = buckets;
+    watcher->bucketCount = count;
+}
+
+//adds a new entry, taking over the strings in card
+static bool addEntry(VCardWatcher * watcher, WatchedCard * card, size_t hash){
+
+    if(watcher->entryCount == watcher->entryCapacity){
+        int capacity = watcher->entryCapacity ? watcher->entryCapacity * 2 : 64;
+        WatchEntry ** bigger = realloc(watcher->entries, sizeof(WatchEntry*) * capacity);
+        if(bigger == NULL){
+            return false;
+        }
+        watcher->entries = bigger;
+        watcher->entryCapacity = capacity;
+    }
+
+    WatchEntry * entry = malloc(sizeof(WatchEntry));
+    if(entry == NULL){
+        return false;
+    }
+
+    entry->card = *card;
+    memset(card, 0, sizeof(WatchedCard));
+    entry->hash = hash;
+    entry->position = watcher->entryCount;
+
+    size_t bucket = hash & (watcher->bucketCount - 1);
+    entry->nextInBucket = watcher->buckets[bucket];
+    watcher->buckets[bucket] = entry;
+    watcher->entries[watcher->entryCount++] = entry;
+
+    growBuckets(watcher);
+    return true;
+}
+
+static void removeEntry(VCardWatcher * watcher, WatchEntry * entry){
+
+    WatchEntry ** link = &watcher->buckets[entry->hash & (watcher->bucketCount - 1)];
+    while(*link != entry){
+        link = &(*link)->nextInBucket;
+    }
+    *link = entry->nextInBucket;
+
+    //the last entry fills the gap
+    WatchEntry * last = watcher->entries[--watcher->entryCount];
+    watcher->entries[entry->position] = last;
+    last->position = entry->position;
+
+    clearWatchedCard(&entry->card);
+    free(entry);
+}
+
+static void clearChanges(VCardWatcher * watcher){
+
+    for(int i = 0; i < watcher->changeCount; i++){
+        free((char*)watcher->changes[i].fileName);
+    }
+    watcher->changeCount = 0;
+}
+
+static void addChange(VCardWatcher * watcher, CardChangeKind kind, const char * fileName){
+
+    if(watcher->changeCount == watcher->changeCapacity){
+        int capacity = watcher->changeCapacity ? watcher->changeCapacity * 2 : 16;
+        CardChange * bigger = realloc(watcher->changes, sizeof(CardChange) * capacity);
+        if(bigger == NULL){
+            return;
+        }
+        watcher->changes = bigger;
+        watcher->changeCapacity = capacity;
+    }
+
+    char * name = myStrDup(fileName);
+    if(name != NULL){
+        watcher->changes[watcher->changeCount].kind = kind;
+        watcher->changes[watcher->changeCount].fileName = name;
+        watcher->changeCount++;
+    }
+}
+
+//fills in a summary from a parsed card, as far as memory allows
+static void summarizeCard(WatchedCard * summary, const Card * card){
+
+    if(card->fn != NULL && card->fn->values != NULL && card->fn->values->head != NULL){
+        summary->fn = myStrDup((char*)card->fn->values->head->data);
+    }
+    if(card->birthday != NULL){
+        summary->birthday = dateToString(card->birthday);
+    }
+    if(card->anniversary != NULL){
+        summary->anniversary = dateToString(card->anniversary);
+    }
+    summary->otherCount = getLength(card->optionalProperties);
+}
+
+//reads one file on a pool thread, nothing shared is touched here
+static void readRefresh(void * arg, int index, int worker){
+
+    RefreshJob * job = (RefreshJob*)arg;
+    Refresh * refresh = &job->refreshes[index];
+
+    size_t dirLength = strlen(job->watcher->dirName);
+    size_t nameLength = strlen(refresh->fileName);
+    char * path = malloc(dirLength + nameLength + 2);
+    if(path == NULL){
+        //leave the index as it is, the next event for the file will try again
+        refresh->exists = true;
+        refresh->card.error = OTHER_ERROR;
+        return;
+    }
+    memcpy(path, job->watcher->dirName, dirLength);
+    path[dirLength] = '/';
+    memcpy(path + dirLength + 1, refresh->fileName, nameLength + 1);
+
+    struct stat info;
+    refresh->exists = stat(path, &info) == 0 && S_ISREG(info.st_mode);
+
+    if(refresh->exists){
+        Card * card = NULL;
+        refresh->card.error = createCardWithContext(&job->contexts[worker], path, &card);
+        if(refresh->card.error == OK){
+            summarizeCard(&refresh->card, card);
+            deleteCard(card);
+        }
+    }
+
+    free(path);
+}
+
+//puts the new state of a file into the index and records the change, if there was one
+static void applyRefresh(VCardWatcher * watcher, Refresh * refresh){
+
+    size_t hash = hashFileName(refresh->fileName);
+    WatchEntry * entry = findEntry(watcher, refresh->fileName, hash);
+
+    if(!refresh->exists){
+        if(entry != NULL){
+            removeEntry(watcher, entry);
+            addChange(watcher, CARD_REMOVED, refresh->fileName);
+        }
+        return;
+    }
+
+    //the file could not be read for lack of memory, keep what is there
+    if(refresh->card.error == OTHER_ERROR && entry != NULL){
+        return;
+    }
+
+    if(entry != NULL){
+        if(sameSummary(&entry->card, &refresh->card)){
+            return;
+        }
+
+        //the entry keeps its name, the rest is replaced
+        refresh->card.fileName = entry->card.fileName;
+        entry->card.fileName = NULL;
+        clearWatchedCard(&entry->card);
+        entry->card = refresh->card;
+        memset(&refresh->card, 0, sizeof(WatchedCard));
+        addChange(watcher, CARD_UPDATED, refresh->fileName);
+        return;
+    }
+
+    refresh->card.fileName = myStrDup(refresh->fileName);
+    if(refresh->card.fileName != NULL && addEntry(watcher, &refresh->card, hash)){
+        addChange(watcher, CARD_ADDED, refresh->fileName);
+    }
+}
+
+static int compareNames(const void * first, const void * second){
+    return strcmp(*(char * const *)first, *(char * const *)second);
+}
+
+//reads every named file again, in parallel, and updates the index.  Takes over the names
+static void refreshFiles(VCardWatcher * watcher, char ** names, int count){
+
+    if(count == 0){
+        return;
+    }
+
+    //each file only needs reading once however many events named it
+    qsort(names, count, sizeof(char*), &compareNames);
+    int unique = 0;
+    for(int i = 0; i < count; i++){
+        if(unique > 0 && strcmp(names[unique - 1], names[i]) == 0){
+            free(names[i]);
+        } else {
+            names[unique++] = names[i];
+        }
+    }
+
+    Refresh * refreshes = calloc(unique, sizeof(Refresh));
+    VCardContext * contexts = malloc(sizeof(VCardContext) * watcher->threads);
+    if(refreshes != NULL && contexts != NULL){
+        for(int i = 0; i < watcher->threads; i++){
+            contexts[i] = watcher->options;
+        }
+        for(int i = 0; i < unique; i++){
+            refreshes[i].fileName = names[i];
+        }
+
+        RefreshJob job = { watcher, refreshes, contexts };
+        runWorkStealing(unique, watcher->threads, &readRefresh, &job);
+
+        for(int i = 0; i < unique; i++){
+            applyRefresh(watcher, &refreshes[i]);
+            clearWatchedCard(&refreshes[i].card);
+        }
+    }
+
+    for(int i = 0; i < unique; i++){
+        free(names[i]);
+    }
+    free(refreshes);
+    free(contexts);
+}
+
+//appends a copy of a name to a growing list
+static bool addName(char *** names, int * count, int * capacity, const char * name){
+
+    if(*count == *capacity){
+        int bigger = *capacity ? *capacity * 2 : 64;
+        char ** grown = realloc(*names, sizeof(char*) * bigger);
+        if(grown == NULL){
+            return false;
+        }
+        *names = grown;
+        *capacity = bigger;
+    }
+
+    char * copy = myStrDup(name);
+    if(copy == NULL){
+        return false;
+    }
+    (*names)[(*count)++] = copy;
+    return true;
+}
+
+//checks every card file in the directory and every file in the index, for the first scan and after lost events
+static bool rescanDirectory(VCardWatcher * watcher){
+
+    DIR * dir = opendir(watcher->dirName);
+    if(dir == NULL){
+        return false;
+    }
+
+    char ** names = NULL;
+    int count = 0;
+    int capacity = 0;
+
+    struct dirent * entry;
+    while((entry = readdir(dir)) != NULL){
+        if(validFileExtension(entry->d_name)){
+            addName(&names, &count, &capacity, entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    //files in the index that are no longer listed get removed
+    for(int i = 0; i < watcher->entryCount; i++){
+        addName(&names, &count, &capacity, watcher->entries[i]->card.fileName);
+    }
+
+    refreshFiles(watcher, names, count);
+    free(names);
+    return true;
+}
+
+
+VCardWatcher* createCardWatcher(const char* dirName, int threads, const VCardContext* options){
+
+    if(dirName == NULL){
+        return NULL;
+    }
+
+    VCardWatcher * watcher = calloc(1, sizeof(VCardWatcher));
+    if(watcher == NULL){
+        return NULL;
+    }
+
+    if(threads <= 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    watcher->threads = threads;
+
+    if(options != NULL){
+        watcher->options = *options;
+    } else {
+        initializeContext(&watcher->options);
+    }
+
+    //cards are only summarized and then freed, so they are built in an arena
+    watcher->options.useArena = true;
+
+    watcher->bucketCount = 64;
+    watcher->buckets = calloc(watcher->bucketCount, sizeof(WatchEntry*));
+    watcher->dirName = myStrDup(dirName);
+
+    //start watching before the first scan, so nothing written during it is missed
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watcher->buckets == NULL || watcher->dirName == NULL || watcher->fd < 0
+        || inotify_add_watch(watcher->fd, dirName, CARD_EVENTS | GONE_EVENTS | IN_ONLYDIR) < 0
+        || !rescanDirectory(watcher)){
+        deleteCardWatcher(watcher);
+        return NULL;
+    }
+
+    //everything found by the first scan is just the starting state
+    clearChanges(watcher);
+
+    return watcher;
+}
+
+int updateCardWatcher(VCardWatcher* watcher, int timeoutMs){
+
+    if(watcher == NULL){
+        return -1;
+    }
+
+    clearChanges(watcher);
+    if(watcher->gone){
+        return -1;
+    }
+
+    struct pollfd waitFor = { watcher->fd, POLLIN, 0 };
+    int ready = poll(&waitFor, 1, timeoutMs);
+    if(ready < 0 && errno != EINTR){
+        return -1;
+    }
+    if(ready <= 0){
+        return 0;
+    }
+
+    char ** names = NULL;
+    int count = 0;
+    int capacity = 0;
+    bool overflow = false;
+
+    //events come aligned for struct inotify_event
+    _Alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while((length = read(watcher->fd, buffer, sizeof(buffer))) > 0){
+        for(char * ptr = buffer; ptr < buffer + length; ){
+            const struct inotify_event * event = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW){
+                overflow = true;
+            } else if(event->mask & GONE_EVENTS){
+                watcher->gone = true;
+            } else if(event->len > 0 && validFileExtension(event->name)){
+                //without memory for the name, check everything once there is
+                overflow = !addName(&names, &count, &capacity, event->name) || overflow;
+            }
+        }
+    }
+
+    if(overflow){
+        for(int i = 0; i < count; i++){
+            free(names[i]);
+        }
+        if(!rescanDirectory(watcher)){
+            watcher->gone = true;
+        }
+    } else {
+        refreshFiles(watcher, names, count);
+    }
+    free(names);
+
+    return watcher->gone ? -1 : watcher->changeCount;
+}
+
+int cardWatcherFd(const VCardWatcher* watcher){
+    return watcher != NULL ? watcher->fd : -1;
+}
+
+int cardChangeCount(const VCardWatcher* watcher){
+    return watcher != NULL ? watcher->changeCount : 0;
+}
+
+const CardChange* cardChangeAt(const VCardWatcher* watcher, int index){
+
+    if(watcher == NULL || index < 0 || index >= watcher->changeCount){
+        return NULL;
+    }
+    return &watcher->changes[index];
+}
+
+int watchedCardCount(const VCardWatcher* watcher){
+    return watcher != NULL ? watcher->entryCount : 0;
+}
+
+const WatchedCard* watchedCardAt(const VCardWatcher* watcher, int index){
+
+    if(watcher == NULL || index < 0 || index >= watcher->entryCount){
+        return NULL;
+    }
+    return &watcher->entries[index]->card;
+}
+
+const WatchedCard* findWatchedCard(const VCardWatcher* watcher, const char* fileName){
+
+    if(watcher == NULL || fileName == NULL){
+        return NULL;
+    }
+
+    WatchEntry * entry = findEntry(watcher, fileName, hashFileName(fileName));
+    return entry != NULL ? &entry->card : NULL;
+}
+
+void deleteCardWatcher(VCardWatcher* watcher){
+
+    if(watcher == NULL){
+        return;
+    }
+
+    for(int i = 0; i < watcher->entryCount; i++){
+        clearWatchedCard(&watcher->entries[i]->card);
+        free(watcher->entries[i]);
+    }
+
+    clearChanges(watcher);
+    if(watcher->fd >= 0){
+        close(watcher->fd);
+    }
+
+    free(watcher->changes);
+    free(watcher->entries);
+    free(watcher->buckets);
+    free(watcher->dirName);
+    free(watcher);
+}
@@ -1,12 +1,36 @@
 #include "VCParser.h"
 #include "VCHelpers.h"
+#include "VCBatch.h"
+#include "VCCache.h"
 #include <stdio.h>
 #include <stdlib.h>
 
 
+//room for each text field of CardFields, terminator included
+#define CARD_FIELD_LENGTH 256
+
+//the fields the Python side shows for a card, filled in by getCardFields.  The layout is mirrored by a
+//ctypes Structure in bin/A3Main.py, so the two must change together
+typedef struct cardFields {
+    //VCardErrorCode from parsing the file, the other fields are only filled in when it is OK
+    int error;
+
+    //number of optional properties
+    int otherCount;
+
+    //set if any of the text fields below had to be cut short to fit
+    int truncated;
+
+    //first value of FN, and BDAY and ANNIVERSARY as dateToString shows them.  Empty if missing
+    char fn[CARD_FIELD_LENGTH];
+    char birthday[CARD_FIELD_LENGTH];
+    char anniversary[CARD_FIELD_LENGTH];
+} CardFields;
+
 
 //this wrapper function creates a card object from a given file
 //converts it to a string, deletes the card, and returns the string
+//the string belongs to the caller, who must hand it back to freeCardString
 
 char * getCardSummary(const char * fileName){
 
@@ -20,8 +44,10 @@ char * getCardSummary(const char * fileName){
     VCardErrorCode error = createCard((char *)fileName, &card);
 
     if(error != OK || card == NULL){
+        char * errorText = errorToString(error);
         char errorMsg[100];
-        sprintf(errorMsg, "Error: %s", errorToString(error));
+        snprintf(errorMsg, sizeof(errorMsg), "Error: %s", errorText);
+        free(errorText);
         return myStrDup(errorMsg);
     }
 
@@ -36,6 +62,138 @@ char * getCardSummary(const char * fileName){
 }
 
 
+//frees a string returned by getCardSummary.  Python cannot free it with its own allocator, so every string
+//this library hands out must come back here.  NULL is ignored
+void freeCardString(char * str){
+    free(str);
+}
+
+//cache getCardFields reads cards through, NULL unless enableCardCache was called
+static VCardCache * cardCache = NULL;
+
+//turns on caching of parsed cards for getCardFields and its batch version, keeping up to memoryBudget bytes of cards.
+//Calling it again only changes the budget.  Returns OK, or OTHER_ERROR if the cache could not be made.
+//This and disableCardCache must not run while other calls into the wrapper are running
+int enableCardCache(size_t memoryBudget){
+
+    if(cardCache != NULL){
+        setCardCacheBudget(cardCache, memoryBudget);
+        return OK;
+    }
+
+    cardCache = createCardCache(memoryBudget, NULL);
+    return cardCache != NULL ? OK : OTHER_ERROR;
+}
+
+void disableCardCache(void){
+    deleteCardCache(cardCache);
+    cardCache = NULL;
+}
+
+//drops a file from the cache, for callers that know it changed.  Edits made through updateCard are noticed anyway,
+//since they replace the file.  Returns 1 if the file was cached
+int invalidateCardCache(const char * fileName){
+    return invalidateCachedCard(cardCache, fileName) ? 1 : 0;
+}
+
+//fills in the cache counters, all zero if the cache is off
+void getCardCacheCounters(CardCacheStats * stats){
+    getCardCacheStats(cardCache, stats);
+}
+
+//copies text into a field with room for size bytes, cutting it short at a character boundary if it does not fit.
+//Returns how many bytes were copied
+static size_t copyField(char * field, size_t size, const char * text, int * truncated){
+
+    size_t length = strlen(text);
+    if(length >= size){
+        length = size - 1;
+        while(length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80){
+            length--;
+        }
+        *truncated = 1;
+    }
+
+    memcpy(field, text, length);
+    field[length] = '\0';
+    return length;
+}
+
+//copies a date into a field the way dateToString writes it, without building the string
+static void copyDateField(char * field, const DateTime * date, int * truncated){
+
+    field[0] = '\0';
+    if(date == NULL){
+        return;
+    }
+
+    if(date->isText){
+        copyField(field, CARD_FIELD_LENGTH, date->text, truncated);
+        return;
+    }
+
+    size_t used = copyField(field, CARD_FIELD_LENGTH, date->date, truncated);
+    if(date->time != NULL && date->time[0] != '\0'){
+        if(used + 2 > CARD_FIELD_LENGTH){
+            *truncated = 1;
+            return;
+        }
+        field[used] = 'T';
+        copyField(field + used + 1, CARD_FIELD_LENGTH - used - 1, date->time, truncated);
+    }
+}
+
+//this wrapper function parses a card and fills in the fields the Python side uses, without going through
+//the text of cardToString.  fields belongs to the caller, so nothing has to be freed afterwards
+int getCardFields(const char * fileName, CardFields * fields){
+
+    if(fields == NULL){
+        return OTHER_ERROR;
+    }
+
+    memset(fields, 0, sizeof(CardFields));
+
+    if(fileName == NULL){
+        fields->error = INV_FILE;
+        return fields->error;
+    }
+
+    //the card comes from the cache, or is parsed just for this call
+    CachedCard * cached = NULL;
+    Card * parsed = NULL;
+    const Card * card;
+    if(cardCache != NULL){
+        fields->error = getCachedCard(cardCache, fileName, &cached);
+        card = cachedCardOf(cached);
+    } else {
+        //a card that only lives for this call is built in an arena and freed in one go
+        VCardContext ctx;
+        initializeContext(&ctx);
+        ctx.useArena = true;
+        fields->error = createCardWithContext(&ctx, (char *)fileName, &parsed);
+        card = parsed;
+    }
+
+    if(fields->error != OK || card == NULL){
+        releaseCachedCard(cardCache, cached);
+        deleteCard(parsed);
+        return fields->error;
+    }
+
+    if(card->fn != NULL && card->fn->values != NULL && card->fn->values->head != NULL){
+        copyField(fields->fn, CARD_FIELD_LENGTH, (char*)card->fn->values->head->data, &fields->truncated);
+    }
+
+    fields->otherCount = getLength(card->optionalProperties);
+    copyDateField(fields->birthday, card->birthday, &fields->truncated);
+    copyDateField(fields->anniversary, card->anniversary, &fields->truncated);
+
+    releaseCachedCard(cardCache, cached);
+    deleteCard(parsed);
+    return fields->error;
+}
+
+
 VCardErrorCode updateCardFN(Card * card, const char * newFN){
 
     if(card == NULL || newFN == NULL){
@@ -56,6 +214,7 @@ VCardErrorCode updateCardFN(Card * card, const char * newFN){
         }
         newProp->name = myStrDup("FN");
         newProp->group = myStrDup("");
+        newProp->id = PROP_FN;
         newProp->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
         newProp->values = initializeList(&valueToString, &deleteValue, &compareValues);
         char * fnValue = myStrDup(newFN);
@@ -107,8 +266,8 @@ VCardErrorCode updateCard(const char * fileName, const char * newFN){
         return error;
     }
 
-    //write the updated card to a file
-    error = writeCard((char *)fileName, card);
+    //replace the file in one step so a crash never leaves a half written card behind
+    error = writeCardAtomic((char *)fileName, card);
 
     //clean up the card object
     deleteCard(card);
@@ -132,24 +291,20 @@ VCardErrorCode createNewCard(const char * fileName, const char * fnValue){
 
 
     //allocate a new card obj
-    Card * newCard = malloc(sizeof(Card));
+    Card * newCard = createEmptyCard();
     if(!newCard){
         return OTHER_ERROR;
     }
-    //initialize the card object
-    newCard->fn = NULL;
-    newCard->optionalProperties = initializeList(&propertyToString, &deleteProperty, &compareProperties);
-    newCard->anniversary = NULL;
-    newCard->birthday = NULL;
 
     //build an FN property, only allowed to edit filename and FN
     Property * fnProp = malloc(sizeof(Property));
     if(!fnProp){
-        free(newCard);
+        deleteCard(newCard);
         return OTHER_ERROR;
     }
     fnProp->name = myStrDup("FN");
     fnProp->group = myStrDup("");
+    fnProp->id = PROP_FN;
     fnProp->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
 
     //initialize the values list for FN property
@@ -169,7 +324,7 @@ VCardErrorCode createNewCard(const char * fileName, const char * fnValue){
     }
 
     //write the card to disk
-    VCardErrorCode writeError = writeCard((char *)fileName, newCard);
+    VCardErrorCode writeError = writeCardAtomic((char *)fileName, newCard);
 
     //clean up the card object
     deleteCard(newCard);
@@ -177,3 +332,94 @@ VCardErrorCode createNewCard(const char * fileName, const char * fnValue){
     return writeError;
 
 }
+
+
+//BATCH WRAPPERS
+//these run one of the wrappers above over many files in a single call from Python.  Each file gets its
+//own slot in a result array the caller owns, and the work is spread over a thread pool.  Nothing is
+//kept between calls, so several Python threads can run batches at the same time
+
+typedef struct wrapperBatch {
+    const char * const * fileNames;
+    const char * const * fnValues;
+    CardFields * fields;
+    int * errors;
+} WrapperBatch;
+
+static void fieldsBatchFile(void * arg, int index, int worker){
+    (void)worker;
+    WrapperBatch * batch = (WrapperBatch*)arg;
+    getCardFields(batch->fileNames[index], &batch->fields[index]);
+}
+
+static void updateBatchFile(void * arg, int index, int worker){
+    (void)worker;
+    WrapperBatch * batch = (WrapperBatch*)arg;
+    batch->errors[index] = updateCard(batch->fileNames[index], batch->fnValues[index]);
+}
+
+static void createBatchFile(void * arg, int index, int worker){
+    (void)worker;
+    WrapperBatch * batch = (WrapperBatch*)arg;
+    batch->errors[index] = createNewCard(batch->fileNames[index], batch->fnValues[index]);
+}
+
+//fills fields[i] for fileNames[i] like getCardFields, and returns how many files parsed, or -1 if the arguments are bad.
+//threads is the number of threads to use, or 0 or less for one per CPU
+int getCardFieldsBatch(const char * const * fileNames, int count, CardFields * fields, int threads){
+
+    if(count < 0 || (count > 0 && (fileNames == NULL || fields == NULL))){
+        return -1;
+    }
+
+    WrapperBatch batch = { fileNames, NULL, fields, NULL };
+    runWorkStealing(count, threads, &fieldsBatchFile, &batch);
+
+    int parsed = 0;
+    for(int i = 0; i < count; i++){
+        if(fields[i].error == OK){
+            parsed++;
+        }
+    }
+    return parsed;
+}
+
+//sets FN of each file like updateCard, leaving each error in errors[i].  Returns how many succeeded, or -1 if the
+//arguments are bad.  A file must not appear twice in one batch
+int updateCardBatch(const char * const * fileNames, const char * const * newFNs, int count, int * errors, int threads){
+
+    if(count < 0 || (count > 0 && (fileNames == NULL || newFNs == NULL || errors == NULL))){
+        return -1;
+    }
+
+    WrapperBatch batch = { fileNames, newFNs, NULL, errors };
+    runWorkStealing(count, threads, &updateBatchFile, &batch);
+
+    int updated = 0;
+    for(int i = 0; i < count; i++){
+        if(errors[i] == OK){
+            updated++;
+        }
+    }
+    return updated;
+}
+
+//creates each file like createNewCard, leaving each error in errors[i].  Returns how many succeeded, or -1 if the
+//arguments are bad.  A file must not appear twice in one batch
+int createNewCardBatch(const char * const * fileNames, const char * const * fnValues, int count, int * errors, int threads){
+
+    if(count < 0 || (count > 0 && (fileNames == NULL || fnValues == NULL || errors == NULL))){
+        return -1;
+    }
+
+    WrapperBatch batch = { fileNames, fnValues, NULL, errors };
+    runWorkStealing(count, threads, &createBatchFile, &batch);
+
+    int created = 0;
+    for(int i = 0; i < count; i++){
+        if(errors[i] == OK){
+            created++;
+        }
+    }
+    return created;
+}
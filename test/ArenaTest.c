@@ -0,0 +1,126 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CARD_TEXT \
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Arena\r\nN:Last;First;;;\r\nBDAY:19900101\r\n" \
+    "ANNIVERSARY:20100101\r\nNOTE;LANGUAGE=en:a note\r\nwork.TEL:555\r\nEND:VCARD\r\n"
+
+//a card parsed into an arena holds the same text as one allocated piece by piece
+static void testArenaCard(const char * dir){
+
+    char * path = writeTestFile(dir, "arena.vcf", CARD_TEXT, strlen(CARD_TEXT));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * heapCard = NULL;
+    Card * arenaCard = NULL;
+    CHECK(createCard(path, &heapCard) == OK);
+    CHECK(createCardInArena(path, &arenaCard) == OK);
+
+    if(heapCard != NULL && arenaCard != NULL){
+        CHECK(heapCard->arena == NULL);
+        CHECK(arenaCard->arena != NULL);
+        CHECK(arenaCard->birthday != NULL && arenaCard->anniversary != NULL);
+
+        char * heapText = cardToString(heapCard);
+        char * arenaText = cardToString(arenaCard);
+        CHECK(heapText != NULL && arenaText != NULL && strcmp(heapText, arenaText) == 0);
+        free(heapText);
+        free(arenaText);
+
+        //the index of an arena card is released along with the arena
+        const SmallVector * notes = findPropertiesByName(arenaCard, "note");
+        CHECK(notes != NULL);
+    }
+
+    deleteCard(heapCard);
+    deleteCard(arenaCard);
+    free(path);
+}
+
+//a card that fails to parse leaves nothing behind, with or without an arena
+static void testArenaFailure(const char * dir){
+
+    const char * text = "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n";
+    char * path = writeTestFile(dir, "noname.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * card = NULL;
+    CHECK(createCardInArena(path, &card) == INV_CARD && card == NULL);
+    CHECK(createCard(path, &card) == INV_CARD && card == NULL);
+    free(path);
+}
+
+static Property * makeProperty(const char * name, const char * value){
+
+    Property * prop = malloc(sizeof(Property));
+    if(prop == NULL){
+        return NULL;
+    }
+    prop->name = malloc(strlen(name) + 1);
+    prop->group = malloc(1);
+    prop->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
+    prop->values = initializeList(&valueToString, &deleteValue, &compareValues);
+    prop->id = propertyIdFromName(name, strlen(name));
+
+    char * copy = malloc(strlen(value) + 1);
+    if(prop->name == NULL || prop->group == NULL || prop->parameters == NULL || prop->values == NULL || copy == NULL){
+        free(copy);
+        deleteProperty(prop);
+        return NULL;
+    }
+    strcpy(prop->name, name);
+    prop->group[0] = '\0';
+    strcpy(copy, value);
+    insertBack(prop->values, copy);
+    return prop;
+}
+
+//a card built by hand from createEmptyCard is freed by deleteCard, index and all
+static void testEmptyCard(void){
+
+    Card * card = createEmptyCard();
+    if(!CHECK(card != NULL)){
+        return;
+    }
+    CHECK(card->fn == NULL && card->birthday == NULL && card->anniversary == NULL);
+    CHECK(card->optionalProperties != NULL && getLength(card->optionalProperties) == 0);
+    CHECK(card->arena == NULL && card->listAllocator == NULL && card->index == NULL);
+
+    //an empty card can be deleted as it is
+    deleteCard(createEmptyCard());
+
+    card->fn = makeProperty("FN", "By Hand");
+    Property * note = makeProperty("NOTE", "built");
+    if(CHECK(card->fn != NULL) && CHECK(note != NULL)){
+        insertBack(card->optionalProperties, note);
+        CHECK(validateCard(card) == OK);
+
+        const SmallVector * notes = findPropertiesByName(card, "NOTE");
+        CHECK(notes != NULL && card->index != NULL);
+    }
+
+    deleteCard(card);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("arena");
+    if(!CHECK(dir != NULL)){
+        return finishTest("ArenaTest");
+    }
+
+    testArenaCard(dir);
+    testArenaFailure(dir);
+    testEmptyCard();
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("ArenaTest");
+}
@@ -0,0 +1,185 @@
+#include "VCParser.h"
+#include "VCBatch.h"
+#include "TestUtils.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ITEM_COUNT 5000
+
+typedef struct workCounts {
+    atomic_int runs[ITEM_COUNT];
+    atomic_int badWorker;
+    int threads;
+} WorkCounts;
+
+//some items take far longer than others, so threads run out early and have to steal
+static void countRun(void * arg, int index, int worker){
+
+    WorkCounts * counts = arg;
+    atomic_fetch_add(&counts->runs[index], 1);
+    if(worker < 0 || worker >= counts->threads){
+        atomic_fetch_add(&counts->badWorker, 1);
+    }
+
+    volatile unsigned spin = 0;
+    for(int i = 0; i < (index % 97 == 0 ? 20000 : 10); i++){
+        spin += i;
+    }
+}
+
+//every index runs exactly once, whatever the thread count
+static void testWorkStealing(void){
+
+    WorkCounts * counts = malloc(sizeof(WorkCounts));
+    if(!CHECK(counts != NULL)){
+        return;
+    }
+
+    int threadCounts[] = { 1, 2, 3, 8 };
+    for(size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++){
+        for(int i = 0; i < ITEM_COUNT; i++){
+            atomic_init(&counts->runs[i], 0);
+        }
+        atomic_init(&counts->badWorker, 0);
+        counts->threads = threadCounts[t];
+
+        int used = runWorkStealing(ITEM_COUNT, threadCounts[t], &countRun, counts);
+        CHECK(used >= 1 && used <= threadCounts[t]);
+
+        int wrong = 0;
+        for(int i = 0; i < ITEM_COUNT; i++){
+            if(atomic_load(&counts->runs[i]) != 1){
+                wrong++;
+            }
+        }
+        CHECK(wrong == 0);
+        CHECK(atomic_load(&counts->badWorker) == 0);
+    }
+
+    //nothing to do runs nothing, and more threads than items is fine
+    atomic_init(&counts->runs[0], 0);
+    atomic_init(&counts->runs[1], 0);
+    counts->threads = 16;
+    runWorkStealing(0, 4, &countRun, counts);
+    CHECK(atomic_load(&counts->runs[0]) == 0);
+    runWorkStealing(2, 16, &countRun, counts);
+    CHECK(atomic_load(&counts->runs[0]) == 1 && atomic_load(&counts->runs[1]) == 1);
+
+    free(counts);
+}
+
+static const char * cardText(int i){
+    switch(i % 3){
+        case 0:
+            return "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Good\r\nEND:VCARD\r\n";
+        case 1:
+            return "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Bad\r\nno colon\r\nEND:VCARD\r\n";
+        default:
+            return "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n";
+    }
+}
+
+static const VCardErrorCode expectedErrors[] = { OK, INV_PROP, INV_CARD };
+
+//results come back in the order the files were given, with the errors createCard would give
+static void testParseFiles(const char * dir){
+
+    int count = 60;
+    char * paths[60];
+    int written = 0;
+    for(int i = 0; i < count; i++){
+        char name[32];
+        sprintf(name, "card%02d.vcf", i);
+        paths[i] = writeTestFile(dir, name, cardText(i), strlen(cardText(i)));
+        if(paths[i] != NULL){
+            written++;
+        }
+    }
+    if(!CHECK(written == count)){
+        for(int i = 0; i < count; i++){
+            free(paths[i]);
+        }
+        return;
+    }
+
+    VCardContext options;
+    initializeContext(&options);
+    options.useArena = true;
+
+    CardBatch * batch = NULL;
+    if(CHECK(parseCardFiles((const char * const *)paths, count, 4, &options, &batch) == OK)){
+        CHECK(batch->count == count);
+        int wrong = 0;
+        for(int i = 0; i < batch->count; i++){
+            BatchResult * result = &batch->results[i];
+            if(strcmp(result->fileName, paths[i]) != 0 || result->error != expectedErrors[i % 3]){
+                wrong++;
+            } else if(result->error == OK && (result->card == NULL || result->card->arena == NULL)){
+                wrong++;
+            } else if(result->error != OK && result->card != NULL){
+                wrong++;
+            } else if(result->error == INV_PROP && result->errorLine != 4){
+                wrong++;
+            }
+        }
+        CHECK(wrong == 0);
+    }
+    deleteCardBatch(batch);
+
+    //an empty list is an empty batch
+    batch = NULL;
+    if(CHECK(parseCardFiles(NULL, 0, 2, NULL, &batch) == OK)){
+        CHECK(batch->count == 0);
+    }
+    deleteCardBatch(batch);
+
+    for(int i = 0; i < count; i++){
+        free(paths[i]);
+    }
+}
+
+//only card files are parsed, sorted by name
+static void testParseDirectory(const char * dir){
+
+    char * other = writeTestFile(dir, "notes.txt", "not a card", 10);
+    char * vcard = writeTestFile(dir, "zz.vcard", cardText(0), strlen(cardText(0)));
+    CHECK(other != NULL && vcard != NULL);
+
+    CardBatch * batch = NULL;
+    if(CHECK(parseCardDirectory(dir, 3, NULL, &batch) == OK)){
+        CHECK(batch->count == 61);
+        int unsorted = 0;
+        for(int i = 1; i < batch->count; i++){
+            if(strcmp(batch->results[i - 1].fileName, batch->results[i].fileName) >= 0){
+                unsorted++;
+            }
+        }
+        CHECK(unsorted == 0);
+        CHECK(batch->count == 0 || (batch->results[batch->count - 1].error == OK && strstr(batch->results[batch->count - 1].fileName, "zz.vcard") != NULL));
+    }
+    deleteCardBatch(batch);
+
+    batch = NULL;
+    CHECK(parseCardDirectory("/nonexistent/cards", 2, NULL, &batch) == INV_FILE && batch == NULL);
+
+    free(other);
+    free(vcard);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("batch");
+    if(!CHECK(dir != NULL)){
+        return finishTest("BatchTest");
+    }
+
+    testWorkStealing();
+    testParseFiles(dir);
+    testParseDirectory(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("BatchTest");
+}
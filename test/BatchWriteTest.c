@@ -0,0 +1,203 @@
+#include "VCParser.h"
+#include "VCBatch.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//more than one chunk of the parallel writer
+#define CARD_COUNT 1200
+
+static char * joinPath(const char * dir, const char * name){
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char * path = malloc(length);
+    if(path != NULL){
+        snprintf(path, length, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+static Card * parseText(const char * dir, const char * text){
+
+    char * path = writeTestFile(dir, "source.vcf", text, strlen(text));
+    Card * card = NULL;
+    if(path == NULL || createCard(path, &card) != OK){
+        card = NULL;
+    }
+    free(path);
+    return card;
+}
+
+//every card written one after another, the way the batch writers should lay them out
+static char * expectedText(Card ** cards, int count){
+
+    size_t total = 0;
+    for(int i = 0; i < count; i++){
+        size_t length = 0;
+        writeCardToBuffer(cards[i], NULL, 0, &length);
+        total += length;
+    }
+
+    char * text = malloc(total + 1);
+    if(text == NULL){
+        return NULL;
+    }
+    size_t used = 0;
+    for(int i = 0; i < count; i++){
+        size_t length = 0;
+        if(writeCardToBuffer(cards[i], text + used, total + 1 - used, &length) != OK){
+            free(text);
+            return NULL;
+        }
+        used += length;
+    }
+    return text;
+}
+
+//an array written on one thread or several gives the same file, in order
+static void testArray(const char * dir, Card ** cards){
+
+    char * expected = expectedText(cards, CARD_COUNT);
+    if(!CHECK(expected != NULL)){
+        return;
+    }
+
+    const int threadCounts[] = { 1, 4, 0 };
+    for(int i = 0; i < 3; i++){
+        char name[32];
+        sprintf(name, "array%d.vcf", i);
+        char * path = joinPath(dir, name);
+        if(!CHECK(path != NULL)){
+            continue;
+        }
+
+        VCardContext options;
+        initializeContext(&options);
+        options.atomicWrite = i == 2;
+        CHECK(writeCardFileBatch(path, (const Card* const*)cards, CARD_COUNT, threadCounts[i], &options) == OK);
+        char * written = readTestFile(path, NULL);
+        CHECK(written != NULL && strcmp(written, expected) == 0);
+        free(written);
+        free(path);
+    }
+    free(expected);
+}
+
+//a stream that parses each card as it is asked for and frees the one before, so a writer that holds on
+//to a card past the next call reads freed memory
+typedef struct freeingStream {
+    const char * dir;
+    int next;
+    int count;
+    Card * current;
+} FreeingStream;
+
+static const Card * nextFreeingCard(void * data){
+
+    FreeingStream * stream = data;
+    deleteCard(stream->current);
+    stream->current = NULL;
+    if(stream->next >= stream->count){
+        return NULL;
+    }
+
+    char text[128];
+    sprintf(text, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Streamed %d\r\nNOTE:%d\r\nEND:VCARD\r\n", stream->next, stream->next * 7);
+    stream->current = parseText(stream->dir, text);
+    stream->next++;
+    return stream->current;
+}
+
+static void testStream(const char * dir){
+
+    char * path = joinPath(dir, "stream.vcf");
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    const int threadCounts[] = { 1, 4 };
+    for(int i = 0; i < 2; i++){
+        FreeingStream stream = { dir, 0, CARD_COUNT, NULL };
+        CHECK(writeCardStream(path, &nextFreeingCard, &stream, threadCounts[i], NULL) == OK);
+        CHECK(stream.next == CARD_COUNT && stream.current == NULL);
+
+        //the file holds every card, each one whole
+        char * written = readTestFile(path, NULL);
+        int found = 0;
+        for(const char * at = written; at != NULL && (at = strstr(at, "FN:Streamed ")) != NULL; at++){
+            int number = -1;
+            int note = -1;
+            if(sscanf(at, "FN:Streamed %d\r\nNOTE:%d\r\n", &number, &note) == 2 && number == found && note == found * 7){
+                found++;
+            }
+        }
+        CHECK(found == CARD_COUNT);
+        free(written);
+    }
+    free(path);
+}
+
+static void testErrors(const char * dir, Card ** cards){
+
+    char * wrong = joinPath(dir, "cards.txt");
+    char * good = joinPath(dir, "errors.vcf");
+    if(!CHECK(wrong != NULL && good != NULL)){
+        free(wrong);
+        free(good);
+        return;
+    }
+
+    CHECK(writeCardFileBatch(wrong, (const Card* const*)cards, 2, 4, NULL) == WRITE_ERROR);
+    CHECK(writeCardFileBatch(NULL, (const Card* const*)cards, 2, 4, NULL) == WRITE_ERROR);
+    CHECK(writeCardFileBatch(good, NULL, 2, 4, NULL) == WRITE_ERROR);
+    CHECK(writeCardFileBatch(good, (const Card* const*)cards, -1, 4, NULL) == WRITE_ERROR);
+
+    const Card * withNull[] = { cards[0], NULL, cards[1] };
+    CHECK(writeCardFileBatch(good, withNull, 3, 4, NULL) == WRITE_ERROR);
+    CHECK(writeCardStream(good, NULL, NULL, 4, NULL) == WRITE_ERROR);
+
+    //no cards makes an empty file
+    CHECK(writeCardFileBatch(good, NULL, 0, 4, NULL) == OK);
+    size_t length = 1;
+    char * written = readTestFile(good, &length);
+    CHECK(written != NULL && length == 0);
+    free(written);
+
+    free(wrong);
+    free(good);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("batchwrite");
+    if(!CHECK(dir != NULL)){
+        return finishTest("BatchWriteTest");
+    }
+
+    Card ** cards = calloc(CARD_COUNT, sizeof(Card*));
+    int parsed = 0;
+    for(int i = 0; cards != NULL && i < CARD_COUNT; i++){
+        char text[256];
+        sprintf(text, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Card %d\r\nitem%d.TEL;TYPE=cell:%d\r\nNOTE:%.*s\r\nEND:VCARD\r\n",
+                i, i % 5, i, i % 120, "a note that is long enough to be folded when it is written out, once it passes the seventy five octet limit");
+        cards[i] = parseText(dir, text);
+        if(cards[i] != NULL){
+            parsed++;
+        }
+    }
+
+    if(CHECK(parsed == CARD_COUNT)){
+        testArray(dir, cards);
+        testStream(dir);
+        testErrors(dir, cards);
+    }
+
+    for(int i = 0; cards != NULL && i < CARD_COUNT; i++){
+        deleteCard(cards[i]);
+    }
+    free(cards);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("BatchWriteTest");
+}
@@ -0,0 +1,116 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char * cardTexts[] = {
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Small\r\nEND:VCARD\r\n",
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Buffered\r\nN:A;B;;;\r\nitem1.TEL;TYPE=cell;PREF=1:555\r\n"
+    "NOTE:a note long enough that the writer has to fold it over more than one line of the output, "
+    "since lines are kept to seventy five octets\r\nBDAY:19900101T101010Z\r\nANNIVERSARY:circa 2000\r\nEND:VCARD\r\n",
+};
+
+//the buffer and string forms give exactly what writeCard puts in a file, and the size only pass measures it
+static void testSameAsFile(const char * dir, const char * text, int index){
+
+    char name[32];
+    sprintf(name, "card%d.vcf", index);
+    char * path = writeTestFile(dir, name, text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * card = NULL;
+    if(!CHECK(createCard(path, &card) == OK)){
+        free(path);
+        return;
+    }
+
+    sprintf(name, "written%d.vcf", index);
+    char * writtenPath = writeTestFile(dir, name, "", 0);
+    size_t fileLength = 0;
+    char * fileText = NULL;
+    if(CHECK(writtenPath != NULL) && CHECK(writeCard(writtenPath, card) == OK)){
+        fileText = readTestFile(writtenPath, &fileLength);
+    }
+    if(!CHECK(fileText != NULL)){
+        deleteCard(card);
+        free(writtenPath);
+        free(path);
+        return;
+    }
+
+    size_t needed = 1;
+    CHECK(writeCardToBuffer(card, NULL, 0, &needed) == OK);
+    CHECK(needed == fileLength);
+
+    //exactly big enough, with a guard byte past the end
+    char * buffer = malloc(needed + 2);
+    if(CHECK(buffer != NULL)){
+        buffer[needed + 1] = '#';
+        size_t length = 0;
+        CHECK(writeCardToBuffer(card, buffer, needed + 1, &length) == OK);
+        CHECK(length == needed && buffer[needed] == '\0' && memcmp(buffer, fileText, needed) == 0);
+        CHECK(buffer[needed + 1] == '#');
+
+        //one short, with no room for the terminator, and far too small
+        memset(buffer, '#', needed + 2);
+        length = 0;
+        CHECK(writeCardToBuffer(card, buffer, needed, &length) == WRITE_ERROR);
+        CHECK(length == needed);
+        CHECK(buffer[needed] == '#' && buffer[needed + 1] == '#');
+        CHECK(writeCardToBuffer(card, buffer, 10, NULL) == WRITE_ERROR);
+        CHECK(buffer[10] == '#');
+    }
+    free(buffer);
+
+    char * string = NULL;
+    size_t length = 0;
+    CHECK(writeCardToString(card, &string, &length) == OK);
+    CHECK(string != NULL && length == fileLength && strlen(string) == length && memcmp(string, fileText, length) == 0);
+    free(string);
+
+    deleteCard(card);
+    free(fileText);
+    free(writtenPath);
+    free(path);
+}
+
+static void testBadArguments(void){
+
+    char buffer[16];
+    size_t length = 1;
+    CHECK(writeCardToBuffer(NULL, buffer, sizeof(buffer), &length) == WRITE_ERROR && length == 0);
+    CHECK(writeCardToBuffer(NULL, NULL, 0, NULL) == WRITE_ERROR);
+
+    Card * card = createEmptyCard();
+    if(CHECK(card != NULL)){
+        length = 1;
+        CHECK(writeCardToBuffer(card, NULL, sizeof(buffer), &length) == WRITE_ERROR && length == 0);
+        CHECK(writeCardToString(card, NULL, NULL) == WRITE_ERROR);
+    }
+    deleteCard(card);
+
+    char * string = buffer;
+    length = 1;
+    CHECK(writeCardToString(NULL, &string, &length) == WRITE_ERROR);
+    CHECK(string == NULL && length == 0);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("buffer");
+    if(!CHECK(dir != NULL)){
+        return finishTest("BufferTest");
+    }
+
+    for(int i = 0; i < (int)(sizeof(cardTexts) / sizeof(cardTexts[0])); i++){
+        testSameAsFile(dir, cardTexts[i], i);
+    }
+    testBadArguments();
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("BufferTest");
+}
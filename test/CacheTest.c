@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCParser.h"
+#include "VCCache.h"
+#include "TestUtils.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_COUNT 20
+#define LOOKUP_THREADS 4
+#define LOOKUPS_PER_THREAD 2000
+
+static char * writeCardFile(const char * dir, const char * name, const char * fn){
+
+    char text[256];
+    snprintf(text, sizeof(text), "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:%s\r\nNOTE:cached\r\nEND:VCARD\r\n", fn);
+    return writeTestFile(dir, name, text, strlen(text));
+}
+
+static const char * fnOf(const CachedCard * entry){
+    const Card * card = cachedCardOf(entry);
+    return card != NULL ? getFromFront(card->fn->values) : NULL;
+}
+
+static CardCacheStats statsOf(VCardCache * cache){
+    CardCacheStats stats;
+    getCardCacheStats(cache, &stats);
+    return stats;
+}
+
+//a second lookup is a hit on the same card, and a handle stays good until it is released
+static void testHits(const char * dir){
+
+    VCardCache * cache = createCardCache(1 << 20, NULL);
+    char * path = writeCardFile(dir, "hit.vcf", "First");
+    if(!CHECK(cache != NULL && path != NULL)){
+        deleteCardCache(cache);
+        free(path);
+        return;
+    }
+
+    CachedCard * first = NULL;
+    CachedCard * second = NULL;
+    CHECK(getCachedCard(cache, path, &first) == OK && first != NULL);
+    CHECK(getCachedCard(cache, path, &second) == OK && second == first);
+    CHECK(strcmp(fnOf(second), "First") == 0);
+
+    CardCacheStats stats = statsOf(cache);
+    CHECK(stats.hits == 1 && stats.misses == 1 && stats.entries == 1 && stats.memoryUsed > 0);
+
+    //dropping the entry leaves both handles good
+    CHECK(invalidateCachedCard(cache, path));
+    CHECK(!invalidateCachedCard(cache, path));
+    CHECK(strcmp(fnOf(first), "First") == 0);
+    releaseCachedCard(cache, first);
+    CHECK(strcmp(fnOf(second), "First") == 0);
+    releaseCachedCard(cache, second);
+
+    stats = statsOf(cache);
+    CHECK(stats.entries == 0 && stats.memoryUsed == 0 && stats.invalidations == 1);
+
+    CHECK(getCachedCard(cache, path, &first) == OK);
+    clearCardCache(cache);
+    CHECK(strcmp(fnOf(first), "First") == 0);
+    releaseCachedCard(cache, first);
+    releaseCachedCard(cache, NULL);
+    CHECK(statsOf(cache).entries == 0);
+
+    CHECK(getCachedCard(NULL, path, &first) == INV_FILE && first == NULL);
+    CHECK(getCachedCard(cache, NULL, &first) == INV_FILE);
+    CHECK(cachedCardOf(NULL) == NULL);
+
+    deleteCardCache(cache);
+    deleteCardCache(NULL);
+    free(path);
+}
+
+//a file that changes in size, in time alone, or is replaced by another file is parsed again
+static void testChanges(const char * dir){
+
+    VCardCache * cache = createCardCache(1 << 20, NULL);
+    char * path = writeCardFile(dir, "change.vcf", "Before");
+    if(!CHECK(cache != NULL && path != NULL)){
+        deleteCardCache(cache);
+        free(path);
+        return;
+    }
+
+    CachedCard * entry = NULL;
+    CHECK(getCachedCard(cache, path, &entry) == OK);
+    releaseCachedCard(cache, entry);
+
+    //a different size
+    free(writeCardFile(dir, "change.vcf", "Longer name"));
+    CHECK(getCachedCard(cache, path, &entry) == OK && strcmp(fnOf(entry), "Longer name") == 0);
+    releaseCachedCard(cache, entry);
+
+    //the same size, with only the time to tell
+    free(writeCardFile(dir, "change.vcf", "Shorter nam"));
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 1000000000, 5 } };
+    CHECK(utimensat(AT_FDCWD, path, times, 0) == 0);
+    CHECK(getCachedCard(cache, path, &entry) == OK && strcmp(fnOf(entry), "Shorter nam") == 0);
+    releaseCachedCard(cache, entry);
+
+    //replaced with another file, even one with the same size and time
+    char * other = writeCardFile(dir, "other.vcf", "Replacement");
+    if(CHECK(other != NULL)){
+        CHECK(utimensat(AT_FDCWD, other, times, 0) == 0);
+        CHECK(rename(other, path) == 0);
+        CHECK(getCachedCard(cache, path, &entry) == OK && strcmp(fnOf(entry), "Replacement") == 0);
+        releaseCachedCard(cache, entry);
+    }
+    free(other);
+
+    CardCacheStats stats = statsOf(cache);
+    CHECK(stats.hits == 0 && stats.misses == 4 && stats.invalidations == 3 && stats.entries == 1);
+
+    //a file that fails to parse is cached with its error, and a file that is gone takes its entry with it
+    const char * bad = "BEGIN:VCARD\r\nVERSION:4.0\r\nEND:VCARD\r\n";
+    free(writeTestFile(dir, "change.vcf", bad, strlen(bad)));
+    CHECK(getCachedCard(cache, path, &entry) == INV_CARD && entry == NULL);
+    CHECK(getCachedCard(cache, path, &entry) == INV_CARD && entry == NULL);
+    CHECK(statsOf(cache).hits == 1);
+
+    CHECK(unlink(path) == 0);
+    CHECK(getCachedCard(cache, path, &entry) == INV_FILE && entry == NULL);
+    CHECK(statsOf(cache).entries == 0);
+
+    deleteCardCache(cache);
+    free(path);
+}
+
+//the least recently used cards go first once the budget is passed
+static void testEviction(char ** paths){
+
+    //the size of one card, measured with a cache of its own
+    VCardCache * cache = createCardCache(1 << 20, NULL);
+    if(!CHECK(cache != NULL)){
+        return;
+    }
+    CachedCard * entry = NULL;
+    CHECK(getCachedCard(cache, paths[0], &entry) == OK);
+    releaseCachedCard(cache, entry);
+    size_t cardMemory = statsOf(cache).memoryUsed;
+    deleteCardCache(cache);
+
+    //room for four cards, and less than five
+    cache = createCardCache(cardMemory * 4 + cardMemory / 2, NULL);
+    if(!CHECK(cache != NULL)){
+        return;
+    }
+    for(int i = 0; i < 4; i++){
+        CHECK(getCachedCard(cache, paths[i], &entry) == OK);
+        releaseCachedCard(cache, entry);
+    }
+
+    //using the first card again makes the second the oldest, so it is the one to go
+    CHECK(getCachedCard(cache, paths[0], &entry) == OK);
+    releaseCachedCard(cache, entry);
+    CHECK(getCachedCard(cache, paths[4], &entry) == OK);
+
+    CardCacheStats stats = statsOf(cache);
+    CHECK(stats.entries == 4 && stats.evictions == 1 && stats.memoryUsed <= stats.memoryBudget);
+    CHECK(!invalidateCachedCard(cache, paths[1]));
+    CHECK(invalidateCachedCard(cache, paths[0]));
+
+    //a smaller budget evicts straight away, even a card that is held, which stays good
+    setCardCacheBudget(cache, 0);
+    stats = statsOf(cache);
+    CHECK(stats.entries == 0 && stats.memoryUsed == 0 && stats.memoryBudget == 0);
+    CHECK(fnOf(entry) != NULL && strcmp(fnOf(entry), "Card 4") == 0);
+    releaseCachedCard(cache, entry);
+
+    deleteCardCache(cache);
+}
+
+typedef struct lookups {
+    VCardCache * cache;
+    char ** paths;
+    unsigned int seed;
+    int wrong;
+} Lookups;
+
+static void * lookUpOften(void * data){
+
+    Lookups * lookups = data;
+    for(int i = 0; i < LOOKUPS_PER_THREAD; i++){
+        int file = rand_r(&lookups->seed) % FILE_COUNT;
+        CachedCard * entry = NULL;
+        char expected[32];
+        sprintf(expected, "Card %d", file);
+        if(getCachedCard(lookups->cache, lookups->paths[file], &entry) != OK || fnOf(entry) == NULL || strcmp(fnOf(entry), expected) != 0){
+            lookups->wrong++;
+        }
+        releaseCachedCard(lookups->cache, entry);
+        if(i % 500 == 0){
+            invalidateCachedCard(lookups->cache, lookups->paths[(file + 1) % FILE_COUNT]);
+        }
+    }
+    return NULL;
+}
+
+//lookups on several threads, with a budget small enough to evict all the time, always get the right card
+static void testThreads(char ** paths){
+
+    VCardCache * cache = createCardCache(2048, NULL);
+    if(!CHECK(cache != NULL)){
+        return;
+    }
+
+    Lookups lookups[LOOKUP_THREADS];
+    pthread_t threads[LOOKUP_THREADS];
+    int started = 0;
+    for(int i = 0; i < LOOKUP_THREADS; i++){
+        lookups[i] = (Lookups){ cache, paths, i + 1, 0 };
+        if(pthread_create(&threads[i], NULL, &lookUpOften, &lookups[i]) == 0){
+            started++;
+        }
+    }
+    CHECK(started == LOOKUP_THREADS);
+
+    int wrong = 0;
+    for(int i = 0; i < started; i++){
+        pthread_join(threads[i], NULL);
+        wrong += lookups[i].wrong;
+    }
+    CHECK(wrong == 0);
+
+    CardCacheStats stats = statsOf(cache);
+    CHECK(stats.hits + stats.misses == (unsigned long)started * LOOKUPS_PER_THREAD);
+    CHECK(stats.evictions > 0 && stats.memoryUsed <= stats.memoryBudget);
+    deleteCardCache(cache);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("cache");
+    if(!CHECK(dir != NULL)){
+        return finishTest("CacheTest");
+    }
+
+    char * paths[FILE_COUNT];
+    int written = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        char name[32];
+        char fn[32];
+        sprintf(name, "card%02d.vcf", i);
+        sprintf(fn, "Card %d", i);
+        paths[i] = writeCardFile(dir, name, fn);
+        if(paths[i] != NULL){
+            written++;
+        }
+    }
+
+    testHits(dir);
+    testChanges(dir);
+    if(CHECK(written == FILE_COUNT)){
+        testEviction(paths);
+        testThreads(paths);
+    }
+
+    for(int i = 0; i < FILE_COUNT; i++){
+        free(paths[i]);
+    }
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("CacheTest");
+}
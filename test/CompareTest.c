@@ -0,0 +1,232 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROPERTY_COUNT 60
+
+static int sign(int value){
+    return (value > 0) - (value < 0);
+}
+
+static char * copyText(const char * text){
+    char * copy = malloc(strlen(text) + 1);
+    if(copy != NULL){
+        strcpy(copy, text);
+    }
+    return copy;
+}
+
+//a property from a small pool of names, groups, values and parameters, so many of them tie on some fields
+static Property * randomProperty(void){
+
+    static const char * names[] = { "TEL", "tel", "EMAIL", "NOTE", "Note", "X-A" };
+    static const char * groups[] = { "", "", "home", "HOME", "work" };
+    static const char * values[] = { "1", "2", "a", "A", "" };
+    static const char * paramNames[] = { "TYPE", "type", "PREF" };
+
+    Property * prop = malloc(sizeof(Property));
+    if(prop == NULL){
+        return NULL;
+    }
+    prop->name = copyText(names[rand() % 6]);
+    prop->group = copyText(groups[rand() % 5]);
+    prop->id = PROP_OTHER;
+    prop->values = initializeList(&valueToString, &deleteValue, &compareValues);
+    prop->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
+
+    for(int i = rand() % 3; i >= 0; i--){
+        insertBack(prop->values, copyText(values[rand() % 5]));
+    }
+    for(int i = rand() % 3; i > 0; i--){
+        Parameter * param = malloc(sizeof(Parameter));
+        if(param != NULL){
+            param->name = copyText(paramNames[rand() % 3]);
+            param->value = copyText(values[rand() % 5]);
+            insertBack(prop->parameters, param);
+        }
+    }
+    return prop;
+}
+
+//the comparator is a total order: it agrees with itself both ways round and chains through a third
+static void testTotalOrder(void){
+
+    Property * props[PROPERTY_COUNT];
+    srand(14);
+    for(int i = 0; i < PROPERTY_COUNT; i++){
+        props[i] = randomProperty();
+        if(!CHECK(props[i] != NULL)){
+            for(int j = 0; j < i; j++){
+                deleteProperty(props[j]);
+            }
+            return;
+        }
+    }
+
+    int asymmetric = 0;
+    int intransitive = 0;
+    for(int i = 0; i < PROPERTY_COUNT; i++){
+        if(compareProperties(props[i], props[i]) != 0){
+            asymmetric++;
+        }
+        for(int j = 0; j < PROPERTY_COUNT; j++){
+            int ij = sign(compareProperties(props[i], props[j]));
+            if(ij != -sign(compareProperties(props[j], props[i]))){
+                asymmetric++;
+            }
+            for(int k = 0; k < PROPERTY_COUNT; k += 7){
+                int jk = sign(compareProperties(props[j], props[k]));
+                int ik = sign(compareProperties(props[i], props[k]));
+                if(ij <= 0 && jk <= 0 && ik > 0){
+                    intransitive++;
+                }
+            }
+        }
+    }
+    CHECK(asymmetric == 0);
+    CHECK(intransitive == 0);
+
+    //names and groups ignore case, values do not
+    Property * first = props[0];
+    Property * second = props[1];
+    free(first->name);
+    free(second->name);
+    free(first->group);
+    free(second->group);
+    first->name = copyText("note");
+    second->name = copyText("NOTE");
+    first->group = copyText("Home");
+    second->group = copyText("hOME");
+    clearList(first->values);
+    clearList(second->values);
+    clearList(first->parameters);
+    clearList(second->parameters);
+    insertBack(first->values, copyText("x"));
+    insertBack(second->values, copyText("x"));
+    CHECK(compareProperties(first, second) == 0);
+    insertBack(second->values, copyText("y"));
+    CHECK(compareProperties(first, second) < 0);
+    insertBack(first->values, copyText("Y"));
+    CHECK(compareProperties(first, second) != 0);
+
+    CHECK(compareProperties(NULL, NULL) == 0);
+    CHECK(compareProperties(first, NULL) > 0 && compareProperties(NULL, first) < 0);
+
+    for(int i = 0; i < PROPERTY_COUNT; i++){
+        deleteProperty(props[i]);
+    }
+}
+
+static void testParametersValuesAndDates(void){
+
+    Parameter a = { "TYPE", "home" };
+    Parameter b = { "type", "home" };
+    Parameter c = { "type", "Home" };
+    CHECK(compareParameters(&a, &b) == 0);
+    CHECK(compareParameters(&a, &c) != 0 && sign(compareParameters(&a, &c)) == -sign(compareParameters(&c, &a)));
+    CHECK(compareParameters(NULL, &a) < 0);
+
+    CHECK(compareValues("a", "a") == 0);
+    CHECK(compareValues("a", "b") < 0 && compareValues("b", "a") > 0);
+    CHECK(compareValues("a", "A") != 0);
+    CHECK(compareValues("", "a") < 0);
+
+    DateTime early = { false, false, "19900101", "", "" };
+    DateTime late = { false, false, "20000101", "", "" };
+    DateTime timed = { false, false, "19900101", "120000", "" };
+    DateTime utc = { true, false, "19900101", "120000", "" };
+    DateTime text = { false, true, "", "", "circa 1800" };
+    CHECK(compareDates(&early, &late) < 0 && compareDates(&late, &early) > 0);
+    CHECK(compareDates(&early, &timed) < 0);
+    CHECK(compareDates(&timed, &utc) < 0);
+    CHECK(compareDates(&late, &text) < 0 && compareDates(&text, &late) > 0);
+    CHECK(compareDates(&text, &text) == 0);
+    CHECK(compareDates(NULL, &text) < 0);
+}
+
+//parsing with sortProperties gives the same order as sorting afterwards, and equal properties keep their order
+static void testSortedCards(const char * dir){
+
+    const char * text =
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Sorted\r\nTEL:2\r\nNOTE:b\r\nEMAIL:x\r\nnote:a\r\nTEL:1\r\n"
+        "home.TEL:1\r\nTEL:1\r\nX-Z:z\r\nEND:VCARD\r\n";
+    char * path = writeTestFile(dir, "sorted.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * parsed = NULL;
+    Card * sorted = NULL;
+    VCardContext ctx;
+    initializeContext(&ctx);
+    ctx.sortProperties = true;
+    CHECK(createCardWithContext(&ctx, path, &parsed) == OK);
+    CHECK(createCard(path, &sorted) == OK);
+
+    if(parsed != NULL && sorted != NULL){
+        //the two equal TEL:1 lines, remembered in card order before sorting
+        Property * equal[2] = { NULL, NULL };
+        int found = 0;
+        ListIterator iter = createIterator(sorted->optionalProperties);
+        Property * prop;
+        while((prop = nextElement(&iter)) != NULL && found < 2){
+            if(strcmp(prop->name, "TEL") == 0 && strcmp(prop->group, "") == 0 && strcmp(getFromFront(prop->values), "1") == 0){
+                equal[found++] = prop;
+            }
+        }
+        CHECK(found == 2);
+
+        sortCardProperties(sorted);
+
+        int outOfOrder = 0;
+        int different = 0;
+        int equalSeen = 0;
+        Property * previous = NULL;
+        ListIterator a = createIterator(parsed->optionalProperties);
+        ListIterator b = createIterator(sorted->optionalProperties);
+        Property * fromParsed;
+        Property * fromSorted;
+        while((fromParsed = nextElement(&a)) != NULL && (fromSorted = nextElement(&b)) != NULL){
+            if(compareProperties(fromParsed, fromSorted) != 0){
+                different++;
+            }
+            if(previous != NULL && compareProperties(previous, fromSorted) > 0){
+                outOfOrder++;
+            }
+            if(found == 2 && equalSeen < 2 && fromSorted == equal[equalSeen]){
+                equalSeen++;
+            }
+            previous = fromSorted;
+        }
+        CHECK(getLength(parsed->optionalProperties) == getLength(sorted->optionalProperties));
+        CHECK(different == 0 && outOfOrder == 0);
+        CHECK(equalSeen == 2);
+
+        //lookups still work on the sorted card
+        const SmallVector * notes = findPropertiesByName(sorted, "NOTE");
+        CHECK(notes != NULL);
+    }
+
+    sortCardProperties(NULL);
+    deleteCard(parsed);
+    deleteCard(sorted);
+    free(path);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("compare");
+    if(!CHECK(dir != NULL)){
+        return finishTest("CompareTest");
+    }
+
+    testTotalOrder();
+    testParametersValuesAndDates();
+    testSortedCards(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("CompareTest");
+}
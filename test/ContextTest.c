@@ -0,0 +1,152 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREAD_COUNT 4
+#define ROUNDS 300
+
+//one file per thread, each with its bad line somewhere else, plus files every thread shares
+typedef struct threadFiles {
+    char * badLine;
+    int errorLine;
+    const char * good;
+    const char * noName;
+    int mismatches;
+} ThreadFiles;
+
+//each thread keeps its own context, so the error and line it sees are always for its own file
+static void * parseInThread(void * data){
+
+    ThreadFiles * files = data;
+    VCardContext ctx;
+    initializeContext(&ctx);
+
+    for(int i = 0; i < ROUNDS; i++){
+        Card * card = NULL;
+
+        if(createCardWithContext(&ctx, files->badLine, &card) != INV_PROP || ctx.error != INV_PROP
+            || ctx.errorLine != files->errorLine || card != NULL){
+            files->mismatches++;
+        }
+
+        if(createCardWithContext(&ctx, (char*)files->good, &card) != OK || ctx.error != OK || card == NULL){
+            files->mismatches++;
+        } else if(validateCardWithContext(&ctx, card) != OK || ctx.error != OK){
+            files->mismatches++;
+        }
+        deleteCard(card);
+
+        if(createCardWithContext(&ctx, (char*)files->noName, &card) != INV_CARD || ctx.error != INV_CARD || card != NULL){
+            files->mismatches++;
+        }
+    }
+    return NULL;
+}
+
+static void testThreads(const char * dir){
+
+    const char * good = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Good\r\nTEL:555\r\nEND:VCARD\r\n";
+    const char * noName = "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n";
+    char * goodPath = writeTestFile(dir, "good.vcf", good, strlen(good));
+    char * noNamePath = writeTestFile(dir, "noname.vcf", noName, strlen(noName));
+
+    ThreadFiles files[THREAD_COUNT];
+    pthread_t threads[THREAD_COUNT];
+    int started = 0;
+
+    for(int t = 0; t < THREAD_COUNT; t++){
+        //thread t has t notes before its bad line
+        char text[512];
+        size_t length = sprintf(text, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Thread\r\n");
+        for(int n = 0; n < t; n++){
+            length += sprintf(text + length, "NOTE:%d\r\n", n);
+        }
+        length += sprintf(text + length, "no colon here\r\nEND:VCARD\r\n");
+
+        char name[32];
+        sprintf(name, "bad%d.vcf", t);
+        files[t].badLine = writeTestFile(dir, name, text, length);
+        files[t].errorLine = 4 + t;
+        files[t].good = goodPath;
+        files[t].noName = noNamePath;
+        files[t].mismatches = 0;
+    }
+
+    if(CHECK(goodPath != NULL && noNamePath != NULL)){
+        for(int t = 0; t < THREAD_COUNT; t++){
+            if(CHECK(files[t].badLine != NULL) && CHECK(pthread_create(&threads[t], NULL, &parseInThread, &files[t]) == 0)){
+                started = t + 1;
+            } else {
+                break;
+            }
+        }
+        for(int t = 0; t < started; t++){
+            pthread_join(threads[t], NULL);
+            CHECK(files[t].mismatches == 0);
+        }
+    }
+
+    for(int t = 0; t < THREAD_COUNT; t++){
+        free(files[t].badLine);
+    }
+    free(goodPath);
+    free(noNamePath);
+}
+
+//a context reports the last call made with it, and atomicWrite picks the write that replaces the file
+static void testContextCalls(const char * dir){
+
+    VCardContext ctx;
+    initializeContext(&ctx);
+    CHECK(ctx.useArena == false && ctx.nodePool == NULL && ctx.wantedCount == 0 && ctx.atomicWrite == false);
+
+    Card * card = NULL;
+    CHECK(createCardWithContext(&ctx, NULL, &card) == INV_FILE && ctx.error == INV_FILE && ctx.errorLine == 0);
+    CHECK(createCardWithContext(&ctx, "card.txt", &card) == INV_FILE && card == NULL);
+    CHECK(createCardWithContext(NULL, "card.vcf", &card) == OTHER_ERROR);
+    CHECK(validateCardWithContext(&ctx, NULL) == INV_CARD && ctx.error == INV_CARD);
+
+    const char * text = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Written\r\nEND:VCARD\r\n";
+    char * path = writeTestFile(dir, "source.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    ctx.useArena = true;
+    if(CHECK(createCardWithContext(&ctx, path, &card) == OK) && CHECK(card->arena != NULL)){
+        ctx.atomicWrite = true;
+        size_t length = strlen(dir) + 16;
+        char * outPath = malloc(length);
+        if(CHECK(outPath != NULL)){
+            snprintf(outPath, length, "%s/out.vcf", dir);
+            CHECK(writeCardWithContext(&ctx, outPath, card) == OK && ctx.error == OK);
+
+            char * written = readTestFile(outPath, NULL);
+            CHECK(written != NULL && strcmp(written, text) == 0);
+            free(written);
+
+            CHECK(writeCardWithContext(&ctx, "out.txt", card) == WRITE_ERROR && ctx.error == WRITE_ERROR);
+        }
+        free(outPath);
+    }
+    deleteCard(card);
+    free(path);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("context");
+    if(!CHECK(dir != NULL)){
+        return finishTest("ContextTest");
+    }
+
+    testThreads(dir);
+    testContextCalls(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("ContextTest");
+}
@@ -0,0 +1,142 @@
+#include "VCParser.h"
+#include "VCEvents.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//the events of a parse written out as one string
+typedef struct eventLog {
+    char text[4096];
+    size_t length;
+    int stopAtProperty;
+    int properties;
+} EventLog;
+
+static void logText(EventLog * log, const char * format, const char * data, size_t length){
+    if(log->length < sizeof(log->text)){
+        log->length += snprintf(log->text + log->length, sizeof(log->text) - log->length, format, (int)length, data);
+    }
+}
+
+static bool onBegin(void * data, int line){
+    char text[32];
+    sprintf(text, "[%d", line);
+    logText(data, "%.*s", text, strlen(text));
+    return true;
+}
+
+static bool onProperty(void * data, const VCardSpan * group, const VCardSpan * name,
+                       const VCardParameterSpan * parameters, int parameterCount, const VCardSpan * values, int valueCount){
+
+    EventLog * log = data;
+    logText(log, " %.*s", group->data, group->length);
+    logText(log, ".%.*s", name->data, name->length);
+    for(int i = 0; i < parameterCount; i++){
+        logText(log, ";%.*s", parameters[i].name.data, parameters[i].name.length);
+        logText(log, "=%.*s", parameters[i].value.data, parameters[i].value.length);
+    }
+    for(int i = 0; i < valueCount; i++){
+        logText(log, i == 0 ? ":%.*s" : ",%.*s", values[i].data, values[i].length);
+    }
+
+    log->properties++;
+    return log->stopAtProperty == 0 || log->properties < log->stopAtProperty;
+}
+
+static bool onEnd(void * data, int line){
+    char text[32];
+    sprintf(text, " %d]", line);
+    logText(data, "%.*s", text, strlen(text));
+    return true;
+}
+
+static bool onError(void * data, VCardErrorCode error, int line){
+    char text[32];
+    sprintf(text, " error %d at %d]", (int)error, line);
+    logText(data, "%.*s", text, strlen(text));
+    return true;
+}
+
+static const VCardEvents allEvents = { &onBegin, &onProperty, &onEnd, &onError };
+
+static void startLog(EventLog * log, int stopAtProperty){
+    log->text[0] = '\0';
+    log->length = 0;
+    log->stopAtProperty = stopAtProperty;
+    log->properties = 0;
+}
+
+static const char * cards =
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Ev\r\n ents\r\nwork.TEL;TYPE=cell;PREF=1: 555 ;b\\;c\r\nBDAY:19900101\r\nEND:VCARD\r\n"
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Bad\r\nno colon\r\nEND:VCARD\r\n"
+    "BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Old\r\nEND:VCARD\r\n"
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Last\r\nEND:VCARD\r\n";
+
+//spans, parameters, escapes, folding and errors, with the same lines as the parser reports
+static void testEvents(const char * path){
+
+    VCardContext ctx;
+    initializeContext(&ctx);
+
+    EventLog log;
+    startLog(&log, 0);
+    CHECK(parseCardEvents(&ctx, path, &allEvents, &log) == OK);
+    CHECK(strcmp(log.text,
+        "[1 .FN:Events work.TEL;TYPE=cell;PREF=1:555,b\\;c .BDAY:19900101 7]"
+        "[8 .FN:Bad error 3 at 11]"
+        "[13 error 2 at 14]"
+        "[17 .FN:Last 20]") == 0);
+
+    //a projection leaves out the unwanted properties, but not FN
+    const char * wanted[] = { "bday" };
+    ctx.wantedProperties = wanted;
+    ctx.wantedCount = 1;
+    startLog(&log, 0);
+    CHECK(parseCardEvents(&ctx, path, &allEvents, &log) == OK);
+    CHECK(strstr(log.text, "TEL") == NULL && strstr(log.text, ".BDAY:19900101") != NULL && strstr(log.text, ".FN:Last") != NULL);
+}
+
+//returning false stops the parse, and callbacks left NULL are skipped
+static void testStopAndMissingCallbacks(const char * path){
+
+    VCardContext ctx;
+    initializeContext(&ctx);
+
+    EventLog log;
+    startLog(&log, 2);
+    parseCardEvents(&ctx, path, &allEvents, &log);
+    CHECK(log.properties == 2);
+    CHECK(strstr(log.text, "Bad") == NULL);
+
+    VCardEvents onlyProperties = { NULL, &onProperty, NULL, NULL };
+    startLog(&log, 0);
+    CHECK(parseCardEvents(&ctx, path, &onlyProperties, &log) == OK);
+    CHECK(log.properties == 5);
+    CHECK(strchr(log.text, '[') == NULL && strchr(log.text, ']') == NULL);
+
+    VCardEvents none = { NULL, NULL, NULL, NULL };
+    CHECK(parseCardEvents(&ctx, path, &none, NULL) == OK);
+
+    CHECK(parseCardEvents(&ctx, "/nonexistent/cards.vcf", &allEvents, &log) == INV_FILE);
+    CHECK(parseCardEvents(&ctx, "cards.txt", &allEvents, &log) == INV_FILE);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("events");
+    if(!CHECK(dir != NULL)){
+        return finishTest("EventsTest");
+    }
+
+    char * path = writeTestFile(dir, "cards.vcf", cards, strlen(cards));
+    if(CHECK(path != NULL)){
+        testEvents(path);
+        testStopAndMissingCallbacks(path);
+    }
+    free(path);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("EventsTest");
+}
@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//the wrapper has no header, since only bin/A3Main.py calls it, so its struct is mirrored here the same way
+#define CARD_FIELD_LENGTH 256
+
+typedef struct cardFields {
+    int error;
+    int otherCount;
+    int truncated;
+    char fn[CARD_FIELD_LENGTH];
+    char birthday[CARD_FIELD_LENGTH];
+    char anniversary[CARD_FIELD_LENGTH];
+} CardFields;
+
+int getCardFields(const char * fileName, CardFields * fields);
+
+static bool isContinuationByte(char c){
+    return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+static bool fieldsOf(const char * dir, const char * text, CardFields * fields){
+
+    char * path = writeTestFile(dir, "fields.vcf", text, strlen(text));
+    if(path == NULL){
+        return false;
+    }
+    memset(fields, 'x', sizeof(CardFields));
+    getCardFields(path, fields);
+    free(path);
+    return true;
+}
+
+//the fields agree with the card and with dateToString, and FN parameters are not mistaken for the name
+static void testFields(const char * dir){
+
+    const char * text =
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN;LANGUAGE=en;TYPE=x:Ada Lovelace\r\nN:Lovelace;Ada;;;\r\nTEL:1\r\n"
+        "BDAY:18151210T120000\r\nANNIVERSARY;VALUE=text:circa 1835\r\nEND:VCARD\r\n";
+
+    CardFields fields;
+    if(!CHECK(fieldsOf(dir, text, &fields))){
+        return;
+    }
+    CHECK(fields.error == OK && fields.truncated == 0);
+    CHECK(strcmp(fields.fn, "Ada Lovelace") == 0);
+    CHECK(fields.otherCount == 2);
+
+    char * path = writeTestFile(dir, "fields.vcf", text, strlen(text));
+    Card * card = NULL;
+    if(CHECK(path != NULL) && CHECK(createCard(path, &card) == OK)){
+        char * birthday = dateToString(card->birthday);
+        char * anniversary = dateToString(card->anniversary);
+        CHECK(birthday != NULL && strcmp(fields.birthday, birthday) == 0);
+        CHECK(anniversary != NULL && strcmp(fields.anniversary, anniversary) == 0);
+        free(birthday);
+        free(anniversary);
+    }
+    deleteCard(card);
+    free(path);
+
+    //missing dates are empty rather than the text NULL
+    if(CHECK(fieldsOf(dir, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Plain\r\nEND:VCARD\r\n", &fields))){
+        CHECK(fields.error == OK && strcmp(fields.fn, "Plain") == 0);
+        CHECK(fields.birthday[0] == '\0' && fields.anniversary[0] == '\0' && fields.otherCount == 0);
+    }
+}
+
+//text too long for a field is cut short at a character boundary and flagged
+static void testTruncation(const char * dir){
+
+    char name[CARD_FIELD_LENGTH * 3];
+    size_t length = 0;
+    while(length + 3 < sizeof(name)){
+        memcpy(name + length, "\xE2\x82\xAC", 3);
+        length += 3;
+    }
+    name[length] = '\0';
+
+    char text[sizeof(name) + 128];
+    snprintf(text, sizeof(text), "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:a%s\r\nEND:VCARD\r\n", name);
+
+    CardFields fields;
+    if(CHECK(fieldsOf(dir, text, &fields))){
+        size_t fnLength = strnlen(fields.fn, CARD_FIELD_LENGTH);
+        CHECK(fields.error == OK && fields.truncated == 1);
+        CHECK(fnLength < CARD_FIELD_LENGTH && fnLength > CARD_FIELD_LENGTH - 4);
+        CHECK(fields.fn[0] == 'a' && !isContinuationByte(fields.fn[fnLength]));
+        CHECK((fnLength - 1) % 3 == 0 && memcmp(fields.fn + 1, name, fnLength - 1) == 0);
+    }
+
+    //a name that just fits is not cut
+    memset(name, 'n', CARD_FIELD_LENGTH - 1);
+    name[CARD_FIELD_LENGTH - 1] = '\0';
+    snprintf(text, sizeof(text), "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:%s\r\nEND:VCARD\r\n", name);
+    if(CHECK(fieldsOf(dir, text, &fields))){
+        CHECK(fields.error == OK && fields.truncated == 0 && strcmp(fields.fn, name) == 0);
+    }
+}
+
+//a file that does not parse leaves only the error, and the other fields empty
+static void testErrors(const char * dir){
+
+    CardFields fields;
+    if(CHECK(fieldsOf(dir, "BEGIN:VCARD\r\nVERSION:4.0\r\nEND:VCARD\r\n", &fields))){
+        CHECK(fields.error == INV_CARD);
+        CHECK(fields.fn[0] == '\0' && fields.birthday[0] == '\0' && fields.otherCount == 0 && fields.truncated == 0);
+    }
+
+    memset(&fields, 'x', sizeof(fields));
+    CHECK(getCardFields(NULL, &fields) == INV_FILE && fields.error == INV_FILE && fields.fn[0] == '\0');
+    CHECK(getCardFields("missing.vcf", &fields) == INV_FILE);
+    CHECK(getCardFields("missing.vcf", NULL) == OTHER_ERROR);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("fields");
+    if(!CHECK(dir != NULL)){
+        return finishTest("FieldsTest");
+    }
+
+    testFields(dir);
+    testTruncation(dir);
+    testErrors(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("FieldsTest");
+}
@@ -0,0 +1,187 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE_OCTETS 75
+
+//how far along the first line the payload starts, past the longest line
+#define MAX_OFFSET 80
+
+static bool isContinuationByte(char c){
+    return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+static char * copyText(const char * text, size_t length){
+    char * copy = malloc(length + 1);
+    if(copy != NULL){
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+static Property * makeProperty(const char * name, const char * value){
+
+    Property * prop = malloc(sizeof(Property));
+    if(prop == NULL){
+        return NULL;
+    }
+    prop->name = copyText(name, strlen(name));
+    prop->group = copyText("", 0);
+    prop->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
+    prop->values = initializeList(&valueToString, &deleteValue, &compareValues);
+    prop->id = propertyIdFromName(name, strlen(name));
+    char * copy = copyText(value, strlen(value));
+    if(prop->name == NULL || prop->group == NULL || prop->parameters == NULL || prop->values == NULL || copy == NULL){
+        free(copy);
+        deleteProperty(prop);
+        return NULL;
+    }
+    insertBack(prop->values, copy);
+    return prop;
+}
+
+//the written text, with every line checked for length and every fold taken out again
+typedef struct foldResult {
+    bool ok;
+    bool longLine;
+    bool splitCharacter;
+    char * unfolded;
+} FoldResult;
+
+static FoldResult writeAndUnfold(const Card * card){
+
+    FoldResult result = { false, false, false, NULL };
+    char * text = NULL;
+    size_t length = 0;
+    size_t measured = 0;
+    if(writeCardToString(card, &text, &length) != OK || writeCardToBuffer(card, NULL, 0, &measured) != OK || measured != length){
+        free(text);
+        return result;
+    }
+
+    result.unfolded = malloc(length + 1);
+    if(result.unfolded == NULL){
+        free(text);
+        return result;
+    }
+
+    size_t used = 0;
+    size_t column = 0;
+    for(size_t i = 0; i < length; i++){
+        if(text[i] == '\r' && text[i + 1] == '\n'){
+            if(column > MAX_LINE_OCTETS){
+                result.longLine = true;
+            }
+            if(text[i + 2] == ' '){
+                if(isContinuationByte(text[i + 3])){
+                    result.splitCharacter = true;
+                }
+                i += 2;
+                column = 1;
+            } else {
+                result.unfolded[used++] = '\r';
+                result.unfolded[used++] = '\n';
+                i++;
+                column = 0;
+            }
+            continue;
+        }
+        result.unfolded[used++] = text[i];
+        column++;
+    }
+    result.unfolded[used] = '\0';
+    result.ok = true;
+
+    free(text);
+    return result;
+}
+
+//each payload follows offset ASCII octets, so its first octet lands on every column of the first line and
+//of the ones after it.  Valid UTF-8 must never be split, and anything else must still be written in full
+static void testPayload(const char * payload, bool valid){
+
+    int failures = 0;
+    int longLines = 0;
+    int splits = 0;
+
+    for(int offset = 0; offset <= MAX_OFFSET; offset++){
+        char value[1024];
+        memset(value, 'a', offset);
+        strcpy(value + offset, payload);
+
+        Card * card = createEmptyCard();
+        if(card == NULL){
+            failures++;
+            continue;
+        }
+        card->fn = makeProperty("FN", "Folded");
+        Property * note = makeProperty("NOTE", value);
+        if(card->fn == NULL || note == NULL){
+            deleteProperty(note);
+            deleteCard(card);
+            failures++;
+            continue;
+        }
+        insertBack(card->optionalProperties, note);
+
+        FoldResult result = writeAndUnfold(card);
+        char expected[1100];
+        snprintf(expected, sizeof(expected), "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Folded\r\nNOTE:%s\r\nEND:VCARD\r\n", value);
+        if(!result.ok || strcmp(result.unfolded, expected) != 0){
+            failures++;
+        }
+        if(result.longLine){
+            longLines++;
+        }
+        if(result.splitCharacter && valid){
+            splits++;
+        }
+
+        free(result.unfolded);
+        deleteCard(card);
+    }
+
+    CHECK(failures == 0);
+    CHECK(longLines == 0);
+    CHECK(splits == 0);
+}
+
+//a payload of count copies of piece
+static void repeat(char * payload, const char * piece, int count){
+    payload[0] = '\0';
+    for(int i = 0; i < count; i++){
+        strcat(payload, piece);
+    }
+}
+
+int main(void){
+
+    char payload[600];
+
+    //two, three and four octet characters, and all of them mixed with ASCII
+    repeat(payload, "\xC3\xA9", 100);
+    testPayload(payload, true);
+    repeat(payload, "\xE2\x82\xAC", 70);
+    testPayload(payload, true);
+    repeat(payload, "\xF0\x9F\x98\x80", 50);
+    testPayload(payload, true);
+    repeat(payload, "x\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", 20);
+    testPayload(payload, true);
+
+    //a long run of continuation bytes with no lead byte
+    repeat(payload, "\x80", 200);
+    testPayload(payload, false);
+
+    //lead bytes with too many continuation bytes, or too few
+    repeat(payload, "\xF0\x80\x80\x80\x80\x80\x80", 30);
+    testPayload(payload, false);
+    repeat(payload, "\xE2\x82", 100);
+    testPayload(payload, false);
+    repeat(payload, "\xFF", 200);
+    testPayload(payload, false);
+
+    return finishTest("FoldTest");
+}
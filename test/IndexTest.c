@@ -0,0 +1,222 @@
+#include "VCParser.h"
+#include "SmallVectorAPI.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char * cardText =
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nitem1.FN:Indexed\r\nTEL:1\r\nitem1.TEL:2\r\nnote:first\r\n"
+    "EMAIL:a@example.com\r\nItem1.EMAIL:b@example.com\r\nTEL:3\r\nEND:VCARD\r\n";
+
+static const char * firstValue(const Property * prop){
+    return getFromFront(prop->values);
+}
+
+//the values of the matches in order, joined with commas
+static void matchValues(const SmallVector * matches, char * text, size_t size){
+
+    text[0] = '\0';
+    size_t length = 0;
+    for(int i = 0; i < vectorLength(matches) && length < size; i++){
+        length += snprintf(text + length, size - length, "%s%s", i ? "," : "", firstValue(vectorGet(matches, i)));
+    }
+}
+
+static bool matchesAre(const Card * card, const char * key, bool group, const char * expected){
+
+    const SmallVector * matches = group ? findPropertiesInGroup(card, key) : findPropertiesByName(card, key);
+    if(matches == NULL){
+        return expected == NULL;
+    }
+    char text[256];
+    matchValues(matches, text, sizeof(text));
+    return expected != NULL && strcmp(text, expected) == 0;
+}
+
+static Property * makeProperty(const char * name, const char * group, const char * value){
+
+    Property * prop = malloc(sizeof(Property));
+    if(prop == NULL){
+        return NULL;
+    }
+    prop->name = malloc(strlen(name) + 1);
+    prop->group = malloc(strlen(group) + 1);
+    prop->parameters = initializeList(&parameterToString, &deleteParameter, &compareParameters);
+    prop->values = initializeList(&valueToString, &deleteValue, &compareValues);
+    prop->id = propertyIdFromName(name, strlen(name));
+    char * copy = malloc(strlen(value) + 1);
+    if(prop->name == NULL || prop->group == NULL || prop->parameters == NULL || prop->values == NULL || copy == NULL){
+        free(copy);
+        deleteProperty(prop);
+        return NULL;
+    }
+    strcpy(prop->name, name);
+    strcpy(prop->group, group);
+    strcpy(copy, value);
+    insertBack(prop->values, copy);
+    return prop;
+}
+
+//lookups by name and group, in card order with fn first, for heap and arena cards alike
+static void testLookups(Card * card){
+
+    CHECK(matchesAre(card, "tel", false, "1,2,3"));
+    CHECK(matchesAre(card, "FN", false, "Indexed"));
+    CHECK(matchesAre(card, "Note", false, "first"));
+    CHECK(matchesAre(card, "ITEM1", true, "Indexed,2,b@example.com"));
+    CHECK(matchesAre(card, "photo", false, NULL));
+    CHECK(matchesAre(card, "TEL", true, NULL));
+    CHECK(findPropertiesByName(card, "") == NULL && findPropertiesByName(card, NULL) == NULL);
+    CHECK(findPropertiesByName(NULL, "TEL") == NULL);
+}
+
+//changes through the list API are noticed, even ones that keep the number of properties the same
+static void testListChanges(Card * card){
+
+    //replace a property with another of a different name
+    Property * note = findPropertiesByName(card, "NOTE") ? vectorGet(findPropertiesByName(card, "NOTE"), 0) : NULL;
+    if(!CHECK(note != NULL)){
+        return;
+    }
+    Property * removed = deleteDataFromList(card->optionalProperties, note);
+    CHECK(removed == note);
+    deleteProperty(removed);
+
+    Property * url = makeProperty("URL", "", "http://example.com");
+    if(!CHECK(url != NULL)){
+        return;
+    }
+    insertBack(card->optionalProperties, url);
+    CHECK(getLength(card->optionalProperties) == 6);
+    CHECK(matchesAre(card, "NOTE", false, NULL));
+    CHECK(matchesAre(card, "URL", false, "http://example.com"));
+
+    //removing and adding back the same count through different calls
+    Property * tel = getFromFront(card->optionalProperties);
+    CHECK(deleteDataFromList(card->optionalProperties, tel) == tel);
+    insertFront(card->optionalProperties, tel);
+    CHECK(matchesAre(card, "TEL", false, "1,2,3"));
+
+    Property * last = makeProperty("TEL", "item1", "0");
+    if(CHECK(last != NULL)){
+        insertSorted(card->optionalProperties, last);
+        char text[256];
+        const SmallVector * tels = findPropertiesByName(card, "TEL");
+        CHECK(tels != NULL && vectorLength(tels) == 4);
+        if(tels != NULL){
+            matchValues(tels, text, sizeof(text));
+            CHECK(strstr(text, "0") != NULL);
+        }
+    }
+
+    //sorting is noticed too
+    sortList(card->optionalProperties);
+    const SmallVector * emails = findPropertiesByName(card, "EMAIL");
+    CHECK(emails != NULL && vectorLength(emails) == 2);
+
+    //a new fn is noticed
+    Property * oldFN = card->fn;
+    card->fn = makeProperty("FN", "", "Replaced");
+    if(CHECK(card->fn != NULL)){
+        CHECK(matchesAre(card, "FN", false, "Replaced"));
+        CHECK(vectorLength(findPropertiesInGroup(card, "item1")) == 3);
+    }
+    deleteProperty(oldFN);
+
+    clearList(card->optionalProperties);
+    CHECK(matchesAre(card, "TEL", false, NULL));
+    CHECK(matchesAre(card, "FN", false, "Replaced"));
+}
+
+//a rename is not a list change, so it takes rebuildCardIndex
+static void testRename(Card * card){
+
+    Property * prop = makeProperty("NOTE", "", "renamed");
+    if(!CHECK(prop != NULL)){
+        return;
+    }
+    insertBack(card->optionalProperties, prop);
+    CHECK(matchesAre(card, "NOTE", false, "renamed"));
+
+    free(prop->name);
+    prop->name = malloc(strlen("TITLE") + 1);
+    if(CHECK(prop->name != NULL)){
+        strcpy(prop->name, "TITLE");
+        CHECK(rebuildCardIndex(card));
+        CHECK(matchesAre(card, "NOTE", false, NULL));
+        CHECK(matchesAre(card, "TITLE", false, "renamed"));
+    }
+    CHECK(!rebuildCardIndex(NULL));
+}
+
+//a card with enough distinct names to grow the table
+static void testManyNames(void){
+
+    Card * card = createEmptyCard();
+    if(!CHECK(card != NULL)){
+        return;
+    }
+    card->fn = makeProperty("FN", "", "Many");
+
+    int added = 0;
+    for(int i = 0; i < 200; i++){
+        char name[32];
+        char group[32];
+        char value[32];
+        sprintf(name, "X-NAME%d", i);
+        sprintf(group, "g%d", i % 50);
+        sprintf(value, "%d", i);
+        Property * prop = makeProperty(name, group, value);
+        if(prop != NULL){
+            insertBack(card->optionalProperties, prop);
+            added++;
+        }
+    }
+    CHECK(added == 200);
+
+    int wrong = 0;
+    for(int i = 0; i < 200; i++){
+        char name[32];
+        char value[32];
+        sprintf(name, "x-name%d", i);
+        sprintf(value, "%d", i);
+        if(!matchesAre(card, name, false, value)){
+            wrong++;
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(matchesAre(card, "G7", true, "7,57,107,157"));
+    deleteCard(card);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("index");
+    if(!CHECK(dir != NULL)){
+        return finishTest("IndexTest");
+    }
+
+    char * path = writeTestFile(dir, "index.vcf", cardText, strlen(cardText));
+    if(CHECK(path != NULL)){
+        Card * card = NULL;
+        if(CHECK(createCardInArena(path, &card) == OK)){
+            testLookups(card);
+        }
+        deleteCard(card);
+
+        card = NULL;
+        if(CHECK(createCard(path, &card) == OK)){
+            testLookups(card);
+            testListChanges(card);
+            testRename(card);
+        }
+        deleteCard(card);
+    }
+    free(path);
+    testManyNames();
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("IndexTest");
+}
@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCParser.h"
+#include "VCHelpers.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CARD_COUNT 20000
+
+//many cards, each with a folded line, several times bigger than the window the input is read through
+static char * writeManyCards(const char * dir, size_t * size){
+
+    size_t capacity = CARD_COUNT * 128;
+    char * text = malloc(capacity);
+    if(text == NULL){
+        return NULL;
+    }
+
+    size_t length = 0;
+    for(int i = 0; i < CARD_COUNT; i++){
+        length += sprintf(text + length, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Card %d\r\nNOTE:first half\r\n  second half\r\nEND:VCARD\r\n", i);
+    }
+
+    char * path = writeTestFile(dir, "many.vcf", text, length);
+    free(text);
+    *size = length;
+    return path;
+}
+
+//the window holds a line and a chunk after it, however big the file
+static void testBoundedWindow(const char * path, size_t size){
+
+    InputBuffer in;
+    if(!CHECK(openInputBuffer(path, &in))){
+        return;
+    }
+    CHECK(in.size == size);
+
+    int lines = 0;
+    int folded = 0;
+    size_t biggest = 0;
+    const char * line;
+    size_t length;
+    LineResult result;
+    while((result = nextUnfoldedLine(&in, &line, &length)) == LINE_OK){
+        lines++;
+        if(length == strlen("NOTE:first half second half") && strncmp(line, "NOTE:first half second half", length) == 0){
+            folded++;
+        }
+        if(in.capacity > biggest){
+            biggest = in.capacity;
+        }
+    }
+
+    CHECK(result == LINE_EOF);
+    CHECK(lines == CARD_COUNT * 5);
+    CHECK(folded == CARD_COUNT);
+    CHECK(size > 16 * biggest);
+    closeInputBuffer(&in);
+}
+
+//a line longer than the window grows it, and it is read back whole
+static void testLongLine(const char * dir){
+
+    size_t photoLength = 300000;
+    size_t capacity = photoLength * 2 + 256;
+    char * text = malloc(capacity);
+    if(!CHECK(text != NULL)){
+        return;
+    }
+
+    size_t length = sprintf(text, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Photo\r\nPHOTO:");
+    for(size_t i = 0; i < photoLength; i++){
+        text[length++] = 'A' + i % 26;
+        if(i % 74 == 73){
+            memcpy(text + length, "\r\n ", 3);
+            length += 3;
+        }
+    }
+    length += sprintf(text + length, "\r\nEND:VCARD\r\n");
+
+    char * path = writeTestFile(dir, "photo.vcf", text, length);
+    free(text);
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * card = NULL;
+    CHECK(createCard(path, &card) == OK);
+    if(card != NULL && CHECK(getLength(card->optionalProperties) == 1)){
+        Property * photo = getFromFront(card->optionalProperties);
+        const char * value = getFromFront(photo->values);
+        CHECK(strlen(value) == photoLength);
+        CHECK(value[0] == 'A' && value[photoLength - 1] == 'A' + (photoLength - 1) % 26);
+    }
+    deleteCard(card);
+    free(path);
+}
+
+//a file cut short while it is being read just ends early
+static void testTruncatedWhileReading(const char * path){
+
+    VCardReader * reader = NULL;
+    if(!CHECK(openCardReader(path, &reader) == OK)){
+        return;
+    }
+
+    Card * card = NULL;
+    CHECK(readNextCard(reader, &card) == OK && card != NULL);
+    deleteCard(card);
+
+    CHECK(truncate(path, 100) == 0);
+
+    //the cards already in the window are read, then the input stops part way through one
+    int cards = 1;
+    VCardErrorCode error;
+    while((error = readNextCard(reader, &card)) == OK && card != NULL){
+        deleteCard(card);
+        cards++;
+    }
+    CHECK(cards < CARD_COUNT);
+    CHECK(error == OK || error == INV_CARD);
+    closeCardReader(reader);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("input");
+    if(!CHECK(dir != NULL)){
+        return finishTest("InputTest");
+    }
+
+    size_t size = 0;
+    char * path = writeManyCards(dir, &size);
+    if(CHECK(path != NULL)){
+        testBoundedWindow(path, size);
+        testTruncatedWhileReading(path);
+    }
+    free(path);
+
+    testLongLine(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("InputTest");
+}
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCParser.h"
+#include "VCBatch.h"
+#include "NodePool.h"
+#include "TestUtils.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIST_COUNT 8
+#define NODES_PER_LIST 500
+#define ROUNDS 6
+
+static char * printNothing(void * data){
+    (void)data;
+    return NULL;
+}
+
+static void deleteNothing(void * data){
+    (void)data;
+}
+
+static int compareNothing(const void * first, const void * second){
+    (void)first;
+    (void)second;
+    return 0;
+}
+
+static List * fillList(ListAllocator * allocator, int nodes){
+
+    List * list = initializeListWithAllocator(&printNothing, &deleteNothing, &compareNothing, allocator);
+    if(list == NULL){
+        return NULL;
+    }
+    for(intptr_t i = 0; i < nodes; i++){
+        insertBack(list, (void*)(i + 1));
+    }
+    return list;
+}
+
+//every block is counted while in use and given back when its list is freed
+static void testBlocksInUse(NodePool * pool){
+
+    List * list = fillList(nodePoolAllocator(pool), 3000);
+    if(!CHECK(list != NULL)){
+        return;
+    }
+    CHECK(getLength(list) == 3000);
+    CHECK(nodePoolBlocksInUse(pool) == 3001);
+
+    clearList(list);
+    CHECK(nodePoolBlocksInUse(pool) == 1);
+    insertFront(list, (void*)1);
+    CHECK(nodePoolBlocksInUse(pool) == 2);
+    freeList(list);
+    CHECK(nodePoolBlocksInUse(pool) == 0);
+}
+
+//lists made on one thread and freed on another, a round at a time
+typedef struct handoff {
+    NodePool * pool;
+    pthread_barrier_t barrier;
+    List * lists[LIST_COUNT];
+    uintptr_t * seen;
+    size_t seenCount;
+    size_t reused;
+    size_t total;
+    bool failed;
+} Handoff;
+
+static int compareAddresses(const void * first, const void * second){
+    uintptr_t a = *(const uintptr_t*)first;
+    uintptr_t b = *(const uintptr_t*)second;
+    return a < b ? -1 : a > b;
+}
+
+static void * makeLists(void * data){
+
+    Handoff * handoff = data;
+    for(int round = 0; round < ROUNDS; round++){
+        for(int i = 0; i < LIST_COUNT; i++){
+            handoff->lists[i] = fillList(nodePoolAllocator(handoff->pool), NODES_PER_LIST);
+            if(handoff->lists[i] == NULL){
+                handoff->failed = true;
+            }
+        }
+
+        //after the first round, count the nodes that came from blocks freed on the other thread
+        for(int i = 0; i < LIST_COUNT && round > 0; i++){
+            for(Node * node = handoff->lists[i] ? handoff->lists[i]->head : NULL; node != NULL; node = node->next){
+                uintptr_t address = (uintptr_t)node;
+                if(bsearch(&address, handoff->seen, handoff->seenCount, sizeof(uintptr_t), &compareAddresses) != NULL){
+                    handoff->reused++;
+                }
+                handoff->total++;
+            }
+        }
+
+        //the first round's nodes are the ones to look for
+        if(round == 0){
+            for(int i = 0; i < LIST_COUNT; i++){
+                for(Node * node = handoff->lists[i] ? handoff->lists[i]->head : NULL; node != NULL; node = node->next){
+                    handoff->seen[handoff->seenCount++] = (uintptr_t)node;
+                }
+            }
+            qsort(handoff->seen, handoff->seenCount, sizeof(uintptr_t), &compareAddresses);
+        }
+
+        pthread_barrier_wait(&handoff->barrier);
+        pthread_barrier_wait(&handoff->barrier);
+    }
+    return NULL;
+}
+
+static void * freeLists(void * data){
+
+    Handoff * handoff = data;
+    for(int round = 0; round < ROUNDS; round++){
+        pthread_barrier_wait(&handoff->barrier);
+        for(int i = 0; i < LIST_COUNT; i++){
+            freeList(handoff->lists[i]);
+            handoff->lists[i] = NULL;
+        }
+        pthread_barrier_wait(&handoff->barrier);
+    }
+    return NULL;
+}
+
+//blocks freed on a thread that never allocates are reused by the thread that does, rather than piling up
+static void testCrossThreadReuse(NodePool * pool){
+
+    Handoff handoff;
+    memset(&handoff, 0, sizeof(handoff));
+    handoff.pool = pool;
+    handoff.seen = malloc(LIST_COUNT * NODES_PER_LIST * sizeof(uintptr_t));
+    if(!CHECK(handoff.seen != NULL) || !CHECK(pthread_barrier_init(&handoff.barrier, NULL, 2) == 0)){
+        free(handoff.seen);
+        return;
+    }
+
+    pthread_t maker;
+    pthread_t freer;
+    if(CHECK(pthread_create(&maker, NULL, &makeLists, &handoff) == 0)){
+        if(CHECK(pthread_create(&freer, NULL, &freeLists, &handoff) == 0)){
+            pthread_join(freer, NULL);
+        }
+        pthread_join(maker, NULL);
+    }
+
+    CHECK(!handoff.failed);
+    CHECK(handoff.total == (size_t)(ROUNDS - 1) * LIST_COUNT * NODES_PER_LIST);
+    CHECK(handoff.reused * 2 > handoff.total);
+    CHECK(nodePoolBlocksInUse(pool) == 0);
+
+    pthread_barrier_destroy(&handoff.barrier);
+    free(handoff.seen);
+}
+
+//cards parsed with a pool on several threads can be freed anywhere, and give every block back
+static void testPooledCards(NodePool * pool){
+
+    char * dir = makeTestDir("nodepool");
+    if(!CHECK(dir != NULL)){
+        return;
+    }
+
+    const char * text = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Pooled\r\nTEL;TYPE=a;TYPE=b:1;2;3\r\nNOTE:x\r\nEND:VCARD\r\n";
+    int written = 0;
+    for(int i = 0; i < 40; i++){
+        char name[32];
+        sprintf(name, "card%02d.vcf", i);
+        char * path = writeTestFile(dir, name, text, strlen(text));
+        if(path != NULL){
+            written++;
+        }
+        free(path);
+    }
+    CHECK(written == 40);
+
+    VCardContext options;
+    initializeContext(&options);
+    options.nodePool = pool;
+
+    CardBatch * batch = NULL;
+    if(CHECK(parseCardDirectory(dir, 4, &options, &batch) == OK)){
+        CHECK(batch->count == 40);
+        CHECK(batch->count == 0 || (batch->results[0].card != NULL && batch->results[0].card->listAllocator == nodePoolAllocator(pool)));
+        CHECK(nodePoolBlocksInUse(pool) > 0);
+    }
+    deleteCardBatch(batch);
+    CHECK(nodePoolBlocksInUse(pool) == 0);
+
+    removeTestDir(dir);
+    free(dir);
+}
+
+int main(void){
+
+    NodePool * pool = createNodePool();
+    if(!CHECK(pool != NULL)){
+        return finishTest("NodePoolTest");
+    }
+
+    //the pool only serves blocks the size of a Node or a List
+    ListAllocator * allocator = nodePoolAllocator(pool);
+    CHECK(allocator->maxBlock >= sizeof(Node) && allocator->maxBlock >= sizeof(List));
+
+    testBlocksInUse(pool);
+    testCrossThreadReuse(pool);
+    testPooledCards(pool);
+
+    deleteNodePool(pool);
+    deleteNodePool(NULL);
+    return finishTest("NodePoolTest");
+}
@@ -0,0 +1,144 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char * fullCard =
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Projected\r\nTEL:555\r\nEmail:a@example.com\r\n"
+    "work.EMAIL;TYPE=work:b@example.com\r\nBDAY:19900101\r\nANNIVERSARY:20100101\r\n"
+    "NOTE:lo\r\n ng\r\nX-CUSTOM;A=b:c\r\nEND:VCARD\r\n";
+
+static int countNamed(const Card * card, const char * name){
+
+    int count = 0;
+    ListIterator iter = createIterator(card->optionalProperties);
+    Property * prop;
+    while((prop = nextElement(&iter)) != NULL){
+        if(strcasecmp(prop->name, name) == 0){
+            count++;
+        }
+    }
+    return count;
+}
+
+//only the wanted properties are kept, matched without case and with or without a group
+static void testProjection(const char * path){
+
+    const char * wanted[] = { "EMAIL", "bday" };
+    VCardContext ctx;
+    initializeContext(&ctx);
+    ctx.wantedProperties = wanted;
+    ctx.wantedCount = 2;
+
+    for(int arena = 0; arena < 2; arena++){
+        ctx.useArena = arena;
+        Card * card = NULL;
+        if(CHECK(createCardWithContext(&ctx, (char*)path, &card) == OK)){
+            CHECK(card->fn != NULL && strcmp(getFromFront(card->fn->values), "Projected") == 0);
+            CHECK(getLength(card->optionalProperties) == 2);
+            CHECK(countNamed(card, "EMAIL") == 2);
+            CHECK(card->birthday != NULL && card->anniversary == NULL);
+        }
+        deleteCard(card);
+    }
+
+    //no names parses everything
+    ctx.wantedCount = 0;
+    Card * card = NULL;
+    if(CHECK(createCardWithContext(&ctx, (char*)path, &card) == OK)){
+        CHECK(getLength(card->optionalProperties) == 5);
+        CHECK(card->birthday != NULL && card->anniversary != NULL);
+    }
+    deleteCard(card);
+}
+
+//skipped lines are still checked for their colon, and BEGIN, END, VERSION and FN are still required
+static void testSkippedLinesChecked(const char * dir){
+
+    const char * wanted[] = { "TEL" };
+    VCardContext ctx;
+    initializeContext(&ctx);
+    ctx.wantedProperties = wanted;
+    ctx.wantedCount = 1;
+
+    const char * noColon = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:A\r\nNOTE;TYPE=x\r\nEND:VCARD\r\n";
+    const char * colonInParams = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:A\r\nNOTE;TYPE=x:text\r\nEND:VCARD\r\n";
+    const char * noVersion = "BEGIN:VCARD\r\nFN:A\r\nTEL:555\r\nEND:VCARD\r\n";
+    const char * noName = "BEGIN:VCARD\r\nVERSION:4.0\r\nTEL:555\r\nEND:VCARD\r\n";
+
+    struct { const char * name; const char * text; VCardErrorCode error; } cases[] = {
+        { "nocolon.vcf", noColon, INV_PROP },
+        { "params.vcf", colonInParams, OK },
+        { "noversion.vcf", noVersion, INV_CARD },
+        { "noname.vcf", noName, INV_CARD },
+    };
+
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++){
+        char * path = writeTestFile(dir, cases[i].name, cases[i].text, strlen(cases[i].text));
+        if(!CHECK(path != NULL)){
+            continue;
+        }
+        Card * card = NULL;
+        CHECK(createCardWithContext(&ctx, path, &card) == cases[i].error);
+        CHECK((card != NULL) == (cases[i].error == OK));
+        if(card != NULL){
+            CHECK(getLength(card->optionalProperties) == 0);
+        }
+        deleteCard(card);
+        free(path);
+    }
+}
+
+//a reader applies its projection to every card
+static void testReaderProjection(const char * dir){
+
+    size_t length = strlen(fullCard);
+    char * text = malloc(length * 3 + 1);
+    if(!CHECK(text != NULL)){
+        return;
+    }
+    for(int i = 0; i < 3; i++){
+        memcpy(text + i * length, fullCard, length);
+    }
+    char * path = writeTestFile(dir, "three.vcf", text, length * 3);
+    free(text);
+
+    const char * wanted[] = { "x-custom" };
+    VCardReader * reader = NULL;
+    if(CHECK(path != NULL) && CHECK(openCardReader(path, &reader) == OK)){
+        setReaderProjection(reader, wanted, 1);
+        int cards = 0;
+        Card * card = NULL;
+        while(readNextCard(reader, &card) == OK && card != NULL){
+            CHECK(getLength(card->optionalProperties) == 1 && countNamed(card, "X-CUSTOM") == 1);
+            CHECK(card->birthday == NULL);
+            deleteCard(card);
+            cards++;
+        }
+        CHECK(cards == 3);
+        closeCardReader(reader);
+    }
+    free(path);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("projection");
+    if(!CHECK(dir != NULL)){
+        return finishTest("ProjectionTest");
+    }
+
+    char * path = writeTestFile(dir, "full.vcf", fullCard, strlen(fullCard));
+    if(CHECK(path != NULL)){
+        testProjection(path);
+    }
+    free(path);
+    testSkippedLinesChecked(dir);
+    testReaderProjection(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("ProjectionTest");
+}
@@ -0,0 +1,125 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//every id resolves from its own name in any case, and from no other name
+static void testRoundTrip(void){
+
+    int wrong = 0;
+    for(int id = PROP_OTHER + 1; id < PROP_ID_COUNT; id++){
+        const char * name = propertyIdName(id);
+        size_t length = strlen(name);
+        if(length == 0 || propertyIdFromName(name, length) != (PropertyId)id){
+            wrong++;
+            continue;
+        }
+
+        char mixed[64];
+        for(size_t i = 0; i <= length && i < sizeof(mixed); i++){
+            mixed[i] = i % 2 ? tolower((unsigned char)name[i]) : name[i];
+        }
+        if(propertyIdFromName(mixed, length) != (PropertyId)id){
+            wrong++;
+        }
+
+        //a prefix or one extra letter is some other name
+        if(length > 1 && propertyIdFromName(name, length - 1) == (PropertyId)id){
+            wrong++;
+        }
+        char longer[64];
+        snprintf(longer, sizeof(longer), "%sX", name);
+        if(propertyIdFromName(longer, length + 1) == (PropertyId)id){
+            wrong++;
+        }
+    }
+    CHECK(wrong == 0);
+
+    CHECK(propertyIdFromName("X-CUSTOM", 8) == PROP_OTHER);
+    CHECK(propertyIdFromName("", 0) == PROP_OTHER);
+    CHECK(propertyIdFromName("FNX", 2) == PROP_FN);
+    CHECK(propertyIdFromName("NOTE:text", 4) == PROP_NOTE);
+    CHECK(strcmp(propertyIdName(PROP_OTHER), "") == 0);
+    CHECK(strcmp(propertyIdName(PROP_ID_COUNT), "") == 0);
+}
+
+static char * copyText(const char * text){
+    char * copy = malloc(strlen(text) + 1);
+    if(copy != NULL){
+        strcpy(copy, text);
+    }
+    return copy;
+}
+
+static void renameProperty(Property * prop, const char * name){
+    free(prop->name);
+    prop->name = copyText(name);
+}
+
+//validateCard goes by the name when the stored id is missing or out of date
+static void testValidateByName(const char * dir){
+
+    const char * text = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Ids\r\nNOTE:note\r\nX-CUSTOM:custom\r\nEND:VCARD\r\n";
+    char * path = writeTestFile(dir, "ids.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * card = NULL;
+    if(!CHECK(createCard(path, &card) == OK)){
+        free(path);
+        return;
+    }
+
+    Property * note = getFromFront(card->optionalProperties);
+    Property * custom = getFromBack(card->optionalProperties);
+    CHECK(note->id == PROP_NOTE && custom->id == PROP_OTHER);
+
+    //extensions are not accepted, until renamed to a known name without updating the id
+    CHECK(validateCard(card) == INV_PROP);
+    renameProperty(custom, "URL");
+    CHECK(validateCard(card) == OK);
+
+    //a known name renamed without updating the id
+    renameProperty(note, "VERSION");
+    CHECK(validateCard(card) == INV_CARD);
+    renameProperty(note, "bday");
+    CHECK(validateCard(card) == INV_DT);
+    renameProperty(note, "X-OTHER");
+    CHECK(validateCard(card) == INV_PROP);
+    renameProperty(note, "Note");
+    CHECK(validateCard(card) == OK);
+
+    //ids that were never set, or set to something else entirely
+    PropertyId garbage[] = { PROP_VERSION, PROP_BDAY, PROP_OTHER, (PropertyId)12345, (PropertyId)-7 };
+    for(size_t i = 0; i < sizeof(garbage) / sizeof(garbage[0]); i++){
+        note->id = garbage[i];
+        custom->id = garbage[i];
+        CHECK(validateCard(card) == OK);
+    }
+
+    //an N that claims to be NOTE is still checked for its five values
+    renameProperty(note, "N");
+    note->id = PROP_NOTE;
+    CHECK(validateCard(card) == INV_PROP);
+
+    deleteCard(card);
+    free(path);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("propertyid");
+    if(!CHECK(dir != NULL)){
+        return finishTest("PropertyIdTest");
+    }
+
+    testRoundTrip();
+    testValidateByName(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("PropertyIdTest");
+}
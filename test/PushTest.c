@@ -0,0 +1,171 @@
+#include "VCParser.h"
+#include "VCPush.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//every card, error and error line a parser handed over, as one string
+typedef struct record {
+    char text[1024];
+    size_t length;
+    int cards;
+    int stopAfter;
+} Record;
+
+static bool recordCard(void * data, Card * card, VCardErrorCode error, int errorLine){
+
+    Record * record = data;
+    const char * fn = "-";
+    if(card != NULL && card->fn != NULL && getLength(card->fn->values) > 0){
+        fn = getFromFront(card->fn->values);
+    }
+    if(record->length < sizeof(record->text)){
+        record->length += snprintf(record->text + record->length, sizeof(record->text) - record->length,
+            "%d:%d:%s|", (int)error, errorLine, fn);
+    }
+    deleteCard(card);
+
+    record->cards++;
+    return record->stopAfter == 0 || record->cards < record->stopAfter;
+}
+
+static void startRecord(Record * record, int stopAfter){
+    record->text[0] = '\0';
+    record->length = 0;
+    record->cards = 0;
+    record->stopAfter = stopAfter;
+}
+
+static const char * cards =
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Jo\r\n hn\r\nNOTE:a\r\n\tb\r\nEND:VCARD\r\n"
+    "\r\n"
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Bad\r\nno colon\r\nEND:VCARD\r\n"
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n"
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Last\r\nEND:VCARD\r\n";
+
+static VCardErrorCode pushSplit(const VCardContext * options, const char * text, size_t first, size_t second, Record * record){
+
+    VCardPushParser * parser = createPushParser(options, &recordCard, record);
+    if(parser == NULL){
+        return OTHER_ERROR;
+    }
+
+    size_t length = strlen(text);
+    VCardErrorCode error = pushCardBytes(parser, text, first);
+    if(error == OK){
+        error = pushCardBytes(parser, text + first, second - first);
+    }
+    if(error == OK){
+        error = pushCardBytes(parser, text + second, length - second);
+    }
+    if(error == OK){
+        error = finishPushParser(parser);
+    }
+    deletePushParser(parser);
+    return error;
+}
+
+//splitting the input at any two points, even inside a CRLF or before a fold, gives the same cards
+static void testSplits(void){
+
+    Record whole;
+    startRecord(&whole, 0);
+    CHECK(pushSplit(NULL, cards, 0, 0, &whole) == OK);
+    //the bad line is counted in raw lines, folds included
+    CHECK(strcmp(whole.text, "0:0:John|3:12:-|2:0:-|0:0:Last|") == 0);
+
+    VCardContext arena;
+    initializeContext(&arena);
+    arena.useArena = true;
+
+    size_t length = strlen(cards);
+    int different = 0;
+    for(size_t first = 0; first <= length; first += 3){
+        for(size_t second = first; second <= length; second += 5){
+            Record split;
+            startRecord(&split, 0);
+            if(pushSplit((first + second) % 2 ? &arena : NULL, cards, first, second, &split) != OK
+                || strcmp(split.text, whole.text) != 0){
+                different++;
+            }
+        }
+    }
+    CHECK(different == 0);
+}
+
+//a byte at a time, a card cut short is reported when the input finishes, and the parser can start again
+static void testFinish(void){
+
+    Record record;
+    startRecord(&record, 0);
+    VCardPushParser * parser = createPushParser(NULL, &recordCard, &record);
+    if(!CHECK(parser != NULL)){
+        return;
+    }
+
+    const char * partial = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Cut";
+    for(size_t i = 0; partial[i] != '\0'; i++){
+        CHECK(pushCardBytes(parser, partial + i, 1) == OK);
+    }
+    CHECK(record.cards == 0);
+    CHECK(finishPushParser(parser) == OK);
+    CHECK(record.cards == 1 && strncmp(record.text, "0:", 2) != 0);
+
+    //a second input through the same parser
+    startRecord(&record, 0);
+    const char * next = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Again\r\nEND:VCARD\r\n";
+    CHECK(pushCardBytes(parser, next, strlen(next)) == OK);
+    CHECK(finishPushParser(parser) == OK);
+    CHECK(strcmp(record.text, "0:0:Again|") == 0);
+
+    //nothing at all is fine too
+    startRecord(&record, 0);
+    CHECK(pushCardBytes(parser, "", 0) == OK);
+    CHECK(finishPushParser(parser) == OK && record.cards == 0);
+
+    deletePushParser(parser);
+
+    //a parser freed part way through a card frees the card too
+    parser = createPushParser(NULL, &recordCard, &record);
+    if(CHECK(parser != NULL)){
+        CHECK(pushCardBytes(parser, partial, strlen(partial)) == OK);
+        deletePushParser(parser);
+    }
+}
+
+//a handler returning false stops the parser, and bad text outside a card is a stream error
+static void testStopAndStrayLines(void){
+
+    Record record;
+    startRecord(&record, 1);
+    VCardPushParser * parser = createPushParser(NULL, &recordCard, &record);
+    if(CHECK(parser != NULL)){
+        pushCardBytes(parser, cards, strlen(cards));
+        finishPushParser(parser);
+        CHECK(record.cards == 1);
+        deletePushParser(parser);
+    }
+
+    startRecord(&record, 0);
+    parser = createPushParser(NULL, &recordCard, &record);
+    if(CHECK(parser != NULL)){
+        const char * stray = "stray text\nBEGIN:VCARD\r\nVERSION:4.0\r\nFN:After\r\nEND:VCARD\r\n";
+        CHECK(pushCardBytes(parser, stray, strlen(stray)) == INV_FILE);
+        CHECK(record.cards == 0);
+        CHECK(finishPushParser(parser) == OK);
+
+        startRecord(&record, 0);
+        CHECK(pushCardBytes(parser, "stray", 5) == OK);
+        CHECK(finishPushParser(parser) == INV_FILE);
+        deletePushParser(parser);
+    }
+}
+
+int main(void){
+
+    testSplits();
+    testFinish();
+    testStopAndStrayLines();
+    return finishTest("PushTest");
+}
@@ -0,0 +1,232 @@
+#include "VCParser.h"
+#include "VCPush.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//what one reader handed back for one card: the error, and the FN of a card that parsed
+typedef struct outcome {
+    VCardErrorCode error;
+    char fn[32];
+} Outcome;
+
+typedef struct outcomes {
+    Outcome items[16];
+    int count;
+} Outcomes;
+
+static void addOutcome(Outcomes * outcomes, VCardErrorCode error, const Card * card){
+
+    if(outcomes->count == 16){
+        return;
+    }
+
+    Outcome * outcome = &outcomes->items[outcomes->count++];
+    outcome->error = error;
+    outcome->fn[0] = '\0';
+    if(card != NULL && card->fn != NULL && card->fn->values->head != NULL){
+        snprintf(outcome->fn, sizeof(outcome->fn), "%s", (char*)card->fn->values->head->data);
+    }
+}
+
+static void readAll(const char * path, Outcomes * outcomes){
+
+    outcomes->count = 0;
+
+    VCardReader * reader = NULL;
+    if(!CHECK(openCardReader(path, &reader) == OK)){
+        return;
+    }
+
+    //a card that fails has to be followed by another card or the end, so the loop always ends
+    for(int i = 0; i < 16; i++){
+        Card * card = NULL;
+        VCardErrorCode error = readNextCard(reader, &card);
+        if(error == OK && card == NULL){
+            break;
+        }
+        addOutcome(outcomes, error, card);
+        deleteCard(card);
+    }
+    closeCardReader(reader);
+}
+
+static bool pushHandler(void * data, Card * card, VCardErrorCode error, int errorLine){
+    (void)errorLine;
+    addOutcome(data, error, card);
+    deleteCard(card);
+    return true;
+}
+
+static void pushAll(const char * text, size_t chunk, Outcomes * outcomes){
+
+    outcomes->count = 0;
+
+    VCardPushParser * parser = createPushParser(NULL, &pushHandler, outcomes);
+    if(!CHECK(parser != NULL)){
+        return;
+    }
+
+    size_t length = strlen(text);
+    for(size_t pos = 0; pos < length; pos += chunk){
+        size_t size = length - pos < chunk ? length - pos : chunk;
+        CHECK(pushCardBytes(parser, text + pos, size) == OK);
+    }
+    CHECK(finishPushParser(parser) == OK);
+    deletePushParser(parser);
+}
+
+static bool sameOutcomes(const Outcomes * first, const Outcomes * second){
+
+    if(first->count != second->count){
+        return false;
+    }
+    for(int i = 0; i < first->count; i++){
+        if(first->items[i].error != second->items[i].error || strcmp(first->items[i].fn, second->items[i].fn) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+#define CARD(fn) "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:" fn "\r\nEND:VCARD\r\n"
+
+//a bare LF in one card loses that card and no other, and both readers agree
+static void testBadLineEnding(const char * dir){
+
+    const char * text =
+        CARD("A")
+        "BEGIN:VCARD\r\nVERSION:4.0\nFN:B\r\nEND:VCARD\r\n"
+        CARD("C")
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n"
+        "\r\n"
+        CARD("E");
+
+    char * path = writeTestFile(dir, "mixed.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Outcomes read;
+    readAll(path, &read);
+    CHECK(read.count == 5);
+    CHECK(read.items[0].error == OK && strcmp(read.items[0].fn, "A") == 0);
+    CHECK(read.items[1].error == INV_CARD);
+    CHECK(read.items[2].error == OK && strcmp(read.items[2].fn, "C") == 0);
+    CHECK(read.items[3].error == INV_CARD);
+    CHECK(read.items[4].error == OK && strcmp(read.items[4].fn, "E") == 0);
+
+    //chunk sizes that split lines, line endings and cards
+    size_t chunks[] = { 1, 2, 7, 64, 4096 };
+    for(size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++){
+        Outcomes pushed;
+        pushAll(text, chunks[i], &pushed);
+        CHECK(sameOutcomes(&read, &pushed));
+    }
+
+    free(path);
+}
+
+//bad endings on a folded line, on a card's last line and on the file's last line
+static void testBadEndingPlaces(const char * dir){
+
+    const char * text =
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Fol\r\n ded\n" "END:VCARD\r\n"
+        CARD("B")
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:C\r\nEND:VCARD\n"
+        CARD("D")
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:E";
+
+    char * path = writeTestFile(dir, "places.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Outcomes read;
+    readAll(path, &read);
+    CHECK(read.count == 5);
+    CHECK(read.items[0].error == INV_CARD);
+    CHECK(read.items[1].error == OK && strcmp(read.items[1].fn, "B") == 0);
+    CHECK(read.items[2].error == INV_CARD);
+    CHECK(read.items[3].error == OK && strcmp(read.items[3].fn, "D") == 0);
+    CHECK(read.items[4].error == INV_CARD);
+
+    Outcomes pushed;
+    pushAll(text, 5, &pushed);
+    CHECK(sameOutcomes(&read, &pushed));
+
+    free(path);
+}
+
+//folded lines, blank lines between cards and the line an error is reported on
+static void testFoldingAndErrorLine(const char * dir){
+
+    const char * text =
+        "\r\nBEGIN:VCARD\r\nVERSION:4.0\r\nFN:Jo\r\n hn\r\n\tSmith\r\nEND:VCARD\r\n\r\n"
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Bad\r\nnot a property\r\nEND:VCARD\r\n"
+        CARD("Last");
+
+    char * path = writeTestFile(dir, "folded.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    VCardReader * reader = NULL;
+    if(CHECK(openCardReader(path, &reader) == OK)){
+        Card * card = NULL;
+        CHECK(readNextCard(reader, &card) == OK && card != NULL);
+        if(card != NULL){
+            CHECK(strcmp((char*)card->fn->values->head->data, "JohnSmith") == 0);
+        }
+        deleteCard(card);
+
+        CHECK(readNextCard(reader, &card) == INV_PROP && card == NULL);
+        CHECK(readerErrorLine(reader) == 12);
+
+        CHECK(readNextCard(reader, &card) == OK && card != NULL);
+        if(card != NULL){
+            CHECK(strcmp((char*)card->fn->values->head->data, "Last") == 0);
+        }
+        deleteCard(card);
+
+        CHECK(readNextCard(reader, &card) == OK && card == NULL);
+        CHECK(readNextCard(reader, &card) == OK && card == NULL);
+        closeCardReader(reader);
+    }
+
+    free(path);
+}
+
+static void testOpenErrors(const char * dir){
+
+    VCardReader * reader = NULL;
+    CHECK(openCardReader(NULL, &reader) == INV_FILE);
+    CHECK(openCardReader("cards.txt", &reader) == INV_FILE && reader == NULL);
+    CHECK(openCardReader("/nonexistent/cards.vcf", &reader) == INV_FILE && reader == NULL);
+
+    char * path = writeTestFile(dir, "empty.vcf", "", 0);
+    if(CHECK(path != NULL) && CHECK(openCardReader(path, &reader) == OK)){
+        Card * card = NULL;
+        CHECK(readNextCard(reader, &card) == OK && card == NULL);
+        closeCardReader(reader);
+    }
+    free(path);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("reader");
+    if(!CHECK(dir != NULL)){
+        return finishTest("ReaderTest");
+    }
+
+    testBadLineEnding(dir);
+    testBadEndingPlaces(dir);
+    testFoldingAndErrorLine(dir);
+    testOpenErrors(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("ReaderTest");
+}
@@ -0,0 +1,222 @@
+#include "VCParser.h"
+#include "VCHelpers.h"
+#include "VCScan.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool isDelimiter(char c){
+    return c == '\r' || c == '\n' || c == ':' || c == ';' || c == '=' || c == ',' || c == '.' || c == '\\';
+}
+
+//the bitmap and the cursor agree with a byte at a time check, at every length and alignment
+static void testScanner(void){
+
+    const char alphabet[] = "ab:;=,.\\\r\nXYZ \xc3\xa9";
+    size_t size = 1200;
+    char * data = malloc(size + 64);
+    uint64_t * bitmap = malloc(((size + 64 + 63) / 64) * sizeof(uint64_t));
+    if(!CHECK(data != NULL && bitmap != NULL)){
+        free(data);
+        free(bitmap);
+        return;
+    }
+
+    srand(4);
+    for(size_t i = 0; i < size + 64; i++){
+        data[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+
+    int bitmapMismatches = 0;
+    int cursorMismatches = 0;
+    for(size_t offset = 0; offset < 8; offset++){
+        for(size_t length = 0; length <= size; length += (length < 130 ? 1 : 37)){
+            const char * span = data + offset;
+
+            scanDelimiters(span, length, bitmap);
+            for(size_t i = 0; i < length; i++){
+                bool marked = (bitmap[i / 64] >> (i % 64)) & 1;
+                if(marked != isDelimiter(span[i])){
+                    bitmapMismatches++;
+                }
+            }
+
+            DelimiterCursor cursor;
+            startDelimiterCursor(&cursor, span, length);
+            const char * delim;
+            size_t expected = 0;
+            while((delim = nextDelimiter(&cursor)) != NULL){
+                while(expected < length && !isDelimiter(span[expected])){
+                    expected++;
+                }
+                if(delim != span + expected){
+                    cursorMismatches++;
+                    break;
+                }
+                expected++;
+            }
+            while(expected < length && !isDelimiter(span[expected])){
+                expected++;
+            }
+            if(expected != length){
+                cursorMismatches++;
+            }
+        }
+    }
+    CHECK(bitmapMismatches == 0);
+    CHECK(cursorMismatches == 0);
+    CHECK(strcmp(delimiterScannerName(), "avx2") == 0 || strcmp(delimiterScannerName(), "sse2") == 0 || strcmp(delimiterScannerName(), "scalar") == 0);
+
+    free(data);
+    free(bitmap);
+}
+
+static Property * parseLine(Card * card, const char * line, VCardContext * ctx){
+
+    int length = getLength(card->optionalProperties);
+    if(!parseSingleVCardLine(line, strlen(line), card, ctx) || getLength(card->optionalProperties) != length + 1){
+        return NULL;
+    }
+    return getFromBack(card->optionalProperties);
+}
+
+static bool hasValues(const Property * prop, const char * const * values, int count){
+
+    if(getLength(prop->values) != count){
+        return false;
+    }
+    ListIterator iter = createIterator(prop->values);
+    for(int i = 0; i < count; i++){
+        if(strcmp(nextElement(&iter), values[i]) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+//groups, parameters, escaped delimiters and values that run past the scanner's window
+static void testTokenizer(void){
+
+    //the lines are inside a card, as if BEGIN had been read
+    VCardContext ctx;
+    initializeContext(&ctx);
+    ctx.foundBegin = true;
+    Card * card = createEmptyCard();
+    if(!CHECK(card != NULL)){
+        return;
+    }
+
+    Property * prop = parseLine(card, "work.TEL;TYPE=voice;PREF=1:555;a\\;b;;c,d", &ctx);
+    if(CHECK(prop != NULL)){
+        const char * values[] = { "555", "a\\;b", "", "c,d" };
+        CHECK(strcmp(prop->group, "work") == 0 && strcmp(prop->name, "TEL") == 0);
+        CHECK(getLength(prop->parameters) == 2);
+        Parameter * first = getFromFront(prop->parameters);
+        Parameter * second = getFromBack(prop->parameters);
+        CHECK(strcmp(first->name, "TYPE") == 0 && strcmp(first->value, "voice") == 0);
+        CHECK(strcmp(second->name, "PREF") == 0 && strcmp(second->value, "1") == 0);
+        CHECK(hasValues(prop, values, 4));
+    }
+
+    //a colon in a value and a dot after the name are part of the value
+    prop = parseLine(card, "URL:http://example.com/a.b", &ctx);
+    if(CHECK(prop != NULL)){
+        const char * values[] = { "http://example.com/a.b" };
+        CHECK(strcmp(prop->group, "") == 0 && hasValues(prop, values, 1));
+    }
+
+    //a value split on both sides of every window boundary
+    char line[1400];
+    size_t length = sprintf(line, "NOTE:");
+    for(int i = 0; length < sizeof(line) - 2; i++){
+        line[length++] = i % 97 == 0 ? ';' : 'x';
+    }
+    line[length] = '\0';
+    prop = parseLine(card, line, &ctx);
+    if(CHECK(prop != NULL)){
+        size_t joined = 0;
+        ListIterator iter = createIterator(prop->values);
+        char * value;
+        while((value = nextElement(&iter)) != NULL){
+            joined += strlen(value) + 1;
+        }
+        CHECK(joined == length - strlen("NOTE:") + 1);
+    }
+
+    //no colon, or nothing in front of it
+    CHECK(!parseSingleVCardLine("NOTE;TYPE=x", strlen("NOTE;TYPE=x"), card, &ctx) && ctx.error == INV_PROP);
+    CHECK(!parseSingleVCardLine(":value", strlen(":value"), card, &ctx) && ctx.error == INV_PROP);
+
+    deleteCard(card);
+}
+
+//allocator that gives out limit blocks and then fails
+typedef struct limitedAllocator {
+    int given;
+    int limit;
+} LimitedAllocator;
+
+static void * limitedAlloc(void * context, size_t size){
+    LimitedAllocator * limited = context;
+    if(limited->given >= limited->limit){
+        return NULL;
+    }
+    limited->given++;
+    return malloc(size);
+}
+
+static void limitedRelease(void * context, void * block){
+    (void)context;
+    free(block);
+}
+
+//a line that runs out of memory part way through is dropped whole and reported as OTHER_ERROR
+static void testAllocationFailure(void){
+
+    LimitedAllocator limited = { 0, 1 };
+    ListAllocator allocator = { &limitedAlloc, &limitedRelease, &limited, NULL, 0 };
+
+    const char * lines[] = {
+        "item1.ADR;TYPE=home;LABEL=x:;;1 Main St;Town;;;",
+        "BDAY;VALUE=date:19900101",
+        "NOTE:plain",
+    };
+
+    for(size_t l = 0; l < sizeof(lines) / sizeof(lines[0]); l++){
+        bool parsed = false;
+        for(int limit = 0; limit < 40 && !parsed; limit++){
+            limited.given = 0;
+            limited.limit = 1;
+            Card * card = initializeCard(NULL, &allocator);
+            if(!CHECK(card != NULL)){
+                return;
+            }
+
+            VCardContext ctx;
+            initializeContext(&ctx);
+            ctx.foundBegin = true;
+            limited.given = 0;
+            limited.limit = limit;
+            parsed = parseSingleVCardLine(lines[l], strlen(lines[l]), card, &ctx);
+            if(parsed){
+                CHECK(getLength(card->optionalProperties) == 1 || card->birthday != NULL);
+            } else {
+                CHECK(ctx.error == OTHER_ERROR);
+                CHECK(getLength(card->optionalProperties) == 0 && card->birthday == NULL);
+            }
+
+            limited.limit = 1000;
+            deleteCard(card);
+        }
+        CHECK(parsed);
+    }
+}
+
+int main(void){
+
+    testScanner();
+    testTokenizer();
+    testAllocationFailure();
+    return finishTest("ScanTest");
+}
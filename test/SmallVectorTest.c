@@ -0,0 +1,169 @@
+#include "SmallVectorAPI.h"
+#include "NodePool.h"
+#include "TestUtils.h"
+
+static char * printNumber(void * data){
+    char * text = malloc(16);
+    if(text != NULL){
+        snprintf(text, 16, "%d,", *(int*)data);
+    }
+    return text;
+}
+
+static int compareNumbers(const void * first, const void * second){
+    return *(const int*)first - *(const int*)second;
+}
+
+static bool sameNumber(const void * first, const void * second){
+    return *(const int*)first == *(const int*)second;
+}
+
+static int * newNumber(int value){
+    int * number = malloc(sizeof(int));
+    if(number != NULL){
+        *number = value;
+    }
+    return number;
+}
+
+//the vector holds its elements in order through growth, removal and a move with memcpy
+static void testOrder(ListAllocator * allocator){
+
+    SmallVector vector;
+    initializeVector(&vector, &printNumber, &free, &compareNumbers, allocator);
+    CHECK(vectorLength(&vector) == 0 && vectorGet(&vector, 0) == NULL);
+
+    int count = 100;
+    int pushed = 0;
+    for(int i = 0; i < count; i++){
+        int * number = newNumber(i);
+        if(number != NULL && vectorPushBack(&vector, number)){
+            pushed++;
+        } else {
+            free(number);
+        }
+    }
+    CHECK(pushed == count && vectorLength(&vector) == count);
+
+    int wrong = 0;
+    void ** data = vectorData(&vector);
+    for(int i = 0; i < count; i++){
+        if(*(int*)vectorGet(&vector, i) != i || data[i] != vectorGet(&vector, i)){
+            wrong++;
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(vectorGet(&vector, count) == NULL && vectorGet(&vector, -1) == NULL);
+
+    //taking from the front keeps the rest in order
+    int * first = vectorRemoveAt(&vector, 0);
+    CHECK(first != NULL && *first == 0 && vectorLength(&vector) == count - 1);
+    CHECK(*(int*)vectorGet(&vector, 0) == 1 && *(int*)vectorGet(&vector, count - 2) == count - 1);
+    free(first);
+    CHECK(vectorRemoveAt(&vector, count) == NULL);
+
+    int key = 57;
+    int * found = findInVector(&vector, &sameNumber, &key);
+    CHECK(found != NULL && *found == 57);
+    key = 0;
+    CHECK(findInVector(&vector, &sameNumber, &key) == NULL);
+
+    //emptied, the vector can be filled again
+    clearVector(&vector);
+    CHECK(vectorLength(&vector) == 0);
+    int * again = newNumber(7);
+    CHECK(again != NULL && vectorPushBack(&vector, again));
+    CHECK(*(int*)vectorGet(&vector, 0) == 7);
+    releaseVector(&vector);
+    CHECK(vectorLength(&vector) == 0);
+    releaseVector(NULL);
+}
+
+//a vector small enough to stay inline is moved by copying the struct
+static void testInlineMove(void){
+
+    SmallVector vector;
+    initializeVector(&vector, &printNumber, &free, &compareNumbers, NULL);
+    for(int i = 0; i < SMALL_VECTOR_INLINE; i++){
+        vectorPushBack(&vector, newNumber(i + 1));
+    }
+
+    SmallVector moved;
+    memcpy(&moved, &vector, sizeof(SmallVector));
+    memset(&vector, 0, sizeof(SmallVector));
+
+    char * text = vectorToString(&moved);
+    CHECK(text != NULL && strcmp(text, "1,2,3,4,") == 0);
+    free(text);
+    releaseVector(&moved);
+
+    text = vectorToString(NULL);
+    CHECK(text != NULL && strcmp(text, "") == 0);
+    free(text);
+}
+
+//allocator that serves any size until it is told to fail
+typedef struct switchAllocator {
+    bool fail;
+    int blocks;
+} SwitchAllocator;
+
+static void * switchAlloc(void * context, size_t size){
+    SwitchAllocator * allocator = context;
+    if(allocator->fail){
+        return NULL;
+    }
+    allocator->blocks++;
+    return malloc(size);
+}
+
+static void switchRelease(void * context, void * block){
+    SwitchAllocator * allocator = context;
+    allocator->blocks--;
+    free(block);
+}
+
+//storage past the inline elements comes from the allocator, and a failed grow leaves the vector as it was
+static void testAllocator(void){
+
+    SwitchAllocator state = { false, 0 };
+    ListAllocator allocator = { &switchAlloc, &switchRelease, &state, NULL, 0 };
+
+    testOrder(&allocator);
+    CHECK(state.blocks == 0);
+
+    SmallVector vector;
+    initializeVector(&vector, &printNumber, &free, &compareNumbers, &allocator);
+    for(int i = 0; i < SMALL_VECTOR_INLINE; i++){
+        vectorPushBack(&vector, newNumber(i));
+    }
+    CHECK(state.blocks == 0);
+
+    state.fail = true;
+    int * extra = newNumber(99);
+    CHECK(!vectorPushBack(&vector, extra));
+    free(extra);
+    CHECK(vectorLength(&vector) == SMALL_VECTOR_INLINE && *(int*)vectorGet(&vector, SMALL_VECTOR_INLINE - 1) == SMALL_VECTOR_INLINE - 1);
+
+    state.fail = false;
+    CHECK(vectorPushBack(&vector, newNumber(SMALL_VECTOR_INLINE)));
+    CHECK(state.blocks == 1 && vectorLength(&vector) == SMALL_VECTOR_INLINE + 1);
+    releaseVector(&vector);
+    CHECK(state.blocks == 0);
+
+    //a NodePool only serves node sized blocks, so a vector given one grows with malloc instead
+    NodePool * pool = createNodePool();
+    if(CHECK(pool != NULL)){
+        testOrder(nodePoolAllocator(pool));
+        CHECK(nodePoolBlocksInUse(pool) == 0);
+        deleteNodePool(pool);
+    }
+}
+
+int main(void){
+
+    testOrder(NULL);
+    testInlineMove();
+    testAllocator();
+    return finishTest("SmallVectorTest");
+}
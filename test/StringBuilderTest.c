@@ -0,0 +1,188 @@
+#include "VCParser.h"
+#include "StringBuilder.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//a builder that starts with no room grows through many appends of every kind
+static void testGrowth(void){
+
+    StringBuilder builder;
+    initializeStringBuilder(&builder, 0);
+
+    char expected[20000];
+    size_t length = 0;
+    for(int i = 0; length < sizeof(expected) - 64; i++){
+        char piece[32];
+        int pieceLength = sprintf(piece, "%d;", i);
+        switch(i % 3){
+            case 0:
+                builderAppend(&builder, piece);
+                break;
+            case 1:
+                builderAppendN(&builder, piece, pieceLength);
+                break;
+            default:
+                for(int c = 0; c < pieceLength; c++){
+                    builderAppendChar(&builder, piece[c]);
+                }
+        }
+        memcpy(expected + length, piece, pieceLength);
+        length += pieceLength;
+    }
+    expected[length] = '\0';
+
+    CHECK(!builder.failed && builder.length == length);
+    char * text = builderTakeString(&builder);
+    CHECK(text != NULL && strcmp(text, expected) == 0);
+    free(text);
+
+    //appending nothing, and a reserve that already fits
+    initializeStringBuilder(&builder, 8);
+    builderAppendN(&builder, "", 0);
+    CHECK(builderReserve(&builder, 4));
+    char * before = builder.data;
+    builderAppend(&builder, "abcd");
+    CHECK(builder.data == before);
+    text = builderTakeString(&builder);
+    CHECK(text != NULL && strcmp(text, "abcd") == 0);
+    free(text);
+
+    //an unused builder can be freed as it is
+    initializeStringBuilder(&builder, 16);
+    freeStringBuilder(&builder);
+}
+
+//a fixed builder never goes past its buffer, and once full it stays failed
+static void testFixed(void){
+
+    char buffer[8];
+    memset(buffer, 'x', sizeof(buffer));
+
+    StringBuilder builder;
+    initializeFixedStringBuilder(&builder, buffer, sizeof(buffer));
+    builderAppend(&builder, "1234567");
+    CHECK(!builder.failed && builder.length == 7);
+    CHECK(memcmp(buffer, "1234567", 7) == 0);
+
+    builderAppendChar(&builder, '8');
+    CHECK(builder.failed);
+    builderAppend(&builder, "9");
+    CHECK(builder.length <= 7);
+    freeStringBuilder(&builder);
+
+    initializeFixedStringBuilder(&builder, buffer, sizeof(buffer));
+    builderAppend(&builder, "abc");
+    builderAppendN(&builder, "defghijk", 8);
+    CHECK(builder.failed);
+    freeStringBuilder(&builder);
+}
+
+//the same text built the slow way, one piece at a time
+static void appendPropertyText(char * text, size_t size, const Property * prop){
+
+    size_t length = strlen(text);
+    length += snprintf(text + length, size - length, "Name: %s\n", prop->name);
+    if(getLength(prop->parameters) > 0){
+        length += snprintf(text + length, size - length, "Parameters:\n");
+        ListIterator iter = createIterator(prop->parameters);
+        Parameter * param;
+        while((param = nextElement(&iter)) != NULL){
+            length += snprintf(text + length, size - length, "     - %s = %s\n", param->name, param->value);
+        }
+    }
+    length += snprintf(text + length, size - length, "Values:\n");
+    ListIterator iter = createIterator(prop->values);
+    char * value;
+    while((value = nextElement(&iter)) != NULL){
+        length += snprintf(text + length, size - length, "     - %s\n", value);
+    }
+}
+
+static void appendDateText(char * text, size_t size, const char * heading, const DateTime * date){
+
+    size_t length = strlen(text);
+    if(date == NULL){
+        snprintf(text + length, size - length, "%s: NULL\n\n", heading);
+    } else if(date->isText){
+        snprintf(text + length, size - length, "%s:\n%s\n\n", heading, date->text);
+    } else if(date->time[0] != '\0'){
+        snprintf(text + length, size - length, "%s:\n%sT%s\n\n", heading, date->date, date->time);
+    } else {
+        snprintf(text + length, size - length, "%s:\n%s\n\n", heading, date->date);
+    }
+}
+
+static void expectedCardText(char * text, size_t size, const Card * card){
+
+    snprintf(text, size, "Full Name:\n");
+    appendPropertyText(text, size, card->fn);
+    strncat(text, "\n\n\n---Optional Properties---\n", size - strlen(text) - 1);
+    ListIterator iter = createIterator(card->optionalProperties);
+    Property * prop;
+    while((prop = nextElement(&iter)) != NULL){
+        appendPropertyText(text, size, prop);
+        strncat(text, "\n", size - strlen(text) - 1);
+    }
+    appendDateText(text, size, "Birthday", card->birthday);
+    appendDateText(text, size, "Anniversary", card->anniversary);
+    strncat(text, "\n---End of Card---\n", size - strlen(text) - 1);
+}
+
+//cardToString and propertyToString measure their output first, and give the same text as building it piece by piece
+static void testCardStrings(const char * dir){
+
+    const char * texts[] = {
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Plain\r\nEND:VCARD\r\n",
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN;LANGUAGE=en:Full\r\nN:A;B;;;\r\nTEL;TYPE=a;PREF=1:1;2\r\n"
+        "BDAY:19900101T101010\r\nANNIVERSARY:circa 2000\r\nNOTE:\r\nEND:VCARD\r\n",
+        "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Dates\r\nBDAY:--0101\r\nANNIVERSARY:20100101\r\nEND:VCARD\r\n",
+    };
+
+    for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++){
+        char name[32];
+        sprintf(name, "card%zu.vcf", i);
+        char * path = writeTestFile(dir, name, texts[i], strlen(texts[i]));
+        if(!CHECK(path != NULL)){
+            continue;
+        }
+
+        Card * card = NULL;
+        if(CHECK(createCard(path, &card) == OK)){
+            char expected[2048];
+            expectedCardText(expected, sizeof(expected), card);
+            char * text = cardToString(card);
+            CHECK(text != NULL && strcmp(text, expected) == 0);
+            free(text);
+
+            expected[0] = '\0';
+            appendPropertyText(expected, sizeof(expected), card->fn);
+            text = propertyToString(card->fn);
+            CHECK(text != NULL && strcmp(text, expected) == 0);
+            free(text);
+        }
+        deleteCard(card);
+        free(path);
+    }
+
+    char * text = cardToString(NULL);
+    CHECK(text != NULL && strcmp(text, "Card is NULL") == 0);
+    free(text);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("stringbuilder");
+    if(!CHECK(dir != NULL)){
+        return finishTest("StringBuilderTest");
+    }
+
+    testGrowth();
+    testFixed();
+    testCardStrings(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("StringBuilderTest");
+}
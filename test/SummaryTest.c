@@ -0,0 +1,83 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//the wrapper has no header, since only bin/A3Main.py calls it
+char * getCardSummary(const char * fileName);
+void freeCardString(char * str);
+
+//a parsed card gives the text of cardToString, and the string goes back through freeCardString
+static void testSummary(const char * dir){
+
+    const char * text = "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Summed\r\nTEL;TYPE=cell:1\r\nBDAY:20000101\r\nEND:VCARD\r\n";
+    char * path = writeTestFile(dir, "summary.vcf", text, strlen(text));
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    Card * card = NULL;
+    if(CHECK(createCard(path, &card) == OK)){
+        char * expected = cardToString(card);
+        int different = 0;
+        for(int i = 0; i < 200; i++){
+            char * summary = getCardSummary(path);
+            if(summary == NULL || expected == NULL || strcmp(summary, expected) != 0){
+                different++;
+            }
+            freeCardString(summary);
+        }
+        CHECK(different == 0);
+        free(expected);
+    }
+    deleteCard(card);
+    free(path);
+}
+
+//errors come back as text the caller also frees, with the error named as errorToString names it
+static void testErrors(const char * dir){
+
+    const char * text = "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n";
+    char * path = writeTestFile(dir, "invalid.vcf", text, strlen(text));
+    if(CHECK(path != NULL)){
+        char * errorText = errorToString(INV_CARD);
+        char expected[128];
+        snprintf(expected, sizeof(expected), "Error: %s", errorText);
+        free(errorText);
+
+        for(int i = 0; i < 200; i++){
+            char * summary = getCardSummary(path);
+            if(i == 0){
+                CHECK(summary != NULL && strcmp(summary, expected) == 0);
+            }
+            freeCardString(summary);
+        }
+    }
+    free(path);
+
+    char * summary = getCardSummary("missing.vcf");
+    CHECK(summary != NULL && strncmp(summary, "Error: ", 7) == 0);
+    freeCardString(summary);
+
+    summary = getCardSummary(NULL);
+    CHECK(summary != NULL && strcmp(summary, "Error: File name is NULL") == 0);
+    freeCardString(summary);
+
+    freeCardString(NULL);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("summary");
+    if(!CHECK(dir != NULL)){
+        return finishTest("SummaryTest");
+    }
+
+    testSummary(dir);
+    testErrors(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("SummaryTest");
+}
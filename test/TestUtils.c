@@ -0,0 +1,131 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+static int checks = 0;
+static int failures = 0;
+
+bool checkCondition(bool condition, const char* text, const char* file, int line){
+
+    checks++;
+    if(!condition){
+        failures++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    }
+    return condition;
+}
+
+char* makeTestDir(const char* name){
+
+    char * dir = malloc(strlen(name) + 32);
+    if(dir == NULL){
+        return NULL;
+    }
+
+    sprintf(dir, "/tmp/vc%sXXXXXX", name);
+    if(mkdtemp(dir) == NULL){
+        free(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+char* writeTestFile(const char* dir, const char* fileName, const char* text, size_t length){
+
+    char * path = malloc(strlen(dir) + strlen(fileName) + 2);
+    if(path == NULL){
+        return NULL;
+    }
+    sprintf(path, "%s/%s", dir, fileName);
+
+    FILE * file = fopen(path, "wb");
+    if(file == NULL){
+        free(path);
+        return NULL;
+    }
+
+    bool written = fwrite(text, 1, length, file) == length;
+    if(fclose(file) != 0 || !written){
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+char* readTestFile(const char* path, size_t* length){
+
+    FILE * file = fopen(path, "rb");
+    if(file == NULL){
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    size_t used = 0;
+    char * data = malloc(capacity);
+
+    while(data != NULL){
+        used += fread(data + used, 1, capacity - used - 1, file);
+        if(used < capacity - 1){
+            break;
+        }
+
+        char * bigger = realloc(data, capacity * 2);
+        if(bigger == NULL){
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = bigger;
+        capacity *= 2;
+    }
+    fclose(file);
+
+    if(data != NULL){
+        data[used] = '\0';
+        if(length != NULL){
+            *length = used;
+        }
+    }
+    return data;
+}
+
+void removeTestDir(const char* dir){
+
+    if(dir == NULL){
+        return;
+    }
+
+    DIR * listing = opendir(dir);
+    if(listing != NULL){
+        struct dirent * entry;
+        while((entry = readdir(listing)) != NULL){
+            if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){
+                continue;
+            }
+
+            char * path = malloc(strlen(dir) + strlen(entry->d_name) + 2);
+            if(path != NULL){
+                sprintf(path, "%s/%s", dir, entry->d_name);
+                unlink(path);
+                free(path);
+            }
+        }
+        closedir(listing);
+    }
+    rmdir(dir);
+}
+
+int finishTest(const char* name){
+
+    if(failures > 0){
+        printf("%s: %d of %d checks failed\n", name, failures, checks);
+        return 1;
+    }
+    printf("%s: %d checks passed\n", name, checks);
+    return 0;
+}
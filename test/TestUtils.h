@@ -0,0 +1,56 @@
+/**
+ * @file TestUtils.h
+ * @brief Checks and scratch files shared by the tests run by make test
+ */
+
+#ifndef _TEST_UTILS_
+#define _TEST_UTILS_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Checks a condition, printing it with its file and line if it is false.  The test carries on either way,
+ * so one run shows every check that fails.
+ **/
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+
+/** Function behind CHECK.
+*@return condition, so a test can stop early when later checks depend on it
+**/
+bool checkCondition(bool condition, const char* text, const char* file, int line);
+
+/** Function to make an empty directory for a test's files.
+*@return the path of the directory, which the caller must free, or NULL if it cannot be made
+*@param name - part of the directory name, to tell the tests apart
+**/
+char* makeTestDir(const char* name);
+
+/** Function to write text to a file in a test directory, replacing anything already there.
+*@return the path of the file, which the caller must free, or NULL if it cannot be written
+*@param dir - the directory
+*@param fileName - name of the file inside the directory
+*@param text - bytes to write
+*@param length - number of bytes
+**/
+char* writeTestFile(const char* dir, const char* fileName, const char* text, size_t length);
+
+/** Function to read a whole file.
+*@return the bytes, NUL terminated, which the caller must free, or NULL if the file cannot be read
+*@param path - the file
+*@param length - set to the number of bytes, not counting the NUL.  May be NULL
+**/
+char* readTestFile(const char* path, size_t* length);
+
+/** Function to delete a test directory along with the files in it.
+*@param dir - the directory, may be NULL
+**/
+void removeTestDir(const char* dir);
+
+/** Function to report how a test went.
+*@return the exit status for main, 0 if every check passed
+*@param name - name of the test
+**/
+int finishTest(const char* name);
+
+#endif
@@ -0,0 +1,189 @@
+#include "VCParser.h"
+#include "VCHelpers.h"
+#include "VCPush.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PHOTO_LENGTH 400000
+
+//appending grows the buffer as needed and keeps it terminated
+static void testAppendBytes(void){
+
+    ByteBuffer buffer = { NULL, 0, 0 };
+    char expected[5000];
+    size_t length = 0;
+    bool appended = true;
+    for(int i = 0; i < 1000; i++){
+        char piece[16];
+        int pieceLength = sprintf(piece, "%d,", i);
+        appended = appendBytes(&buffer, piece, pieceLength) && appended;
+        memcpy(expected + length, piece, pieceLength);
+        length += pieceLength;
+    }
+    CHECK(appended);
+    CHECK(buffer.length == length && buffer.capacity > length);
+    CHECK(memcmp(buffer.data, expected, length) == 0 && buffer.data[length] == '\0');
+
+    //starting over reuses the room already there
+    size_t capacity = buffer.capacity;
+    buffer.length = 0;
+    CHECK(appendBytes(&buffer, "", 0) && buffer.data[0] == '\0');
+    CHECK(appendBytes(&buffer, "abc", 3) && strcmp(buffer.data, "abc") == 0);
+    CHECK(buffer.capacity == capacity);
+    free(buffer.data);
+}
+
+//reads every line of text, joined with | and each followed by its line number
+static void readLines(const char * dir, const char * text, char * lines, size_t size, LineResult * last){
+
+    lines[0] = '\0';
+    *last = LINE_NO_MEMORY;
+    char * path = writeTestFile(dir, "lines.vcf", text, strlen(text));
+    InputBuffer in;
+    if(path == NULL || !openInputBuffer(path, &in)){
+        free(path);
+        return;
+    }
+
+    size_t used = 0;
+    const char * line;
+    size_t length;
+    LineResult result;
+    while((result = nextUnfoldedLine(&in, &line, &length)) == LINE_OK && used < size){
+        used += snprintf(lines + used, size - used, "%.*s@%d|", (int)length, line, in.lineNumber);
+    }
+    if(result == LINE_BAD_ENDING && used < size){
+        snprintf(lines + used, size - used, "bad@%d", in.lineNumber);
+    }
+    *last = result;
+
+    closeInputBuffer(&in);
+    free(path);
+}
+
+//folds with a space or a tab, empty continuations, folds one after another, and a fold on the first line
+static void testLineJoining(const char * dir){
+
+    char lines[512];
+    LineResult result;
+
+    readLines(dir, "A:1\r\n 2\r\n\t3\r\nB:x\r\nC:\r\n \r\n y\r\n", lines, sizeof(lines), &result);
+    CHECK(result == LINE_EOF);
+    CHECK(strcmp(lines, "A:123@1|B:x@4|C:y@5|") == 0);
+
+    //two folded lines in a row start their joins from nothing
+    readLines(dir, "A:long\r\n first\r\nB:s\r\n 2\r\n", lines, sizeof(lines), &result);
+    CHECK(result == LINE_EOF);
+    CHECK(strcmp(lines, "A:longfirst@1|B:s2@3|") == 0);
+
+    //a continuation with nothing before it loses its whitespace, and keeps its own folds
+    readLines(dir, " A:1\r\n 2\r\nB:3\r\n", lines, sizeof(lines), &result);
+    CHECK(result == LINE_EOF);
+    CHECK(strcmp(lines, "A:12@1|B:3@3|") == 0);
+
+    //only the first whitespace octet of a continuation is taken away
+    readLines(dir, "A:1\r\n  2\r\n\t\t3\r\n", lines, sizeof(lines), &result);
+    CHECK(result == LINE_EOF);
+    CHECK(strcmp(lines, "A:1 2\t3@1|") == 0);
+
+    //a continuation without CRLF is found on its own line
+    readLines(dir, "A:1\r\nB:2\r\n 3\r\n 4\n", lines, sizeof(lines), &result);
+    CHECK(result == LINE_BAD_ENDING);
+    CHECK(strcmp(lines, "A:1@1|bad@4") == 0);
+}
+
+static bool keepCard(void * data, Card * card, VCardErrorCode error, int errorLine){
+    (void)errorLine;
+    Card ** kept = data;
+    if(error == OK && *kept == NULL){
+        *kept = card;
+    } else {
+        deleteCard(card);
+    }
+    return true;
+}
+
+static const char * photoValue(const Card * card){
+
+    if(card == NULL || getLength(card->optionalProperties) != 1){
+        return NULL;
+    }
+    Property * photo = getFromFront(card->optionalProperties);
+    return getFromFront(photo->values);
+}
+
+//a base64 photo folded over thousands of lines, with both kinds of fold, is joined back byte for byte
+//by the file parser and by the push parser fed in uneven pieces
+static void testFoldedPhoto(const char * dir){
+
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char * photo = malloc(PHOTO_LENGTH + 1);
+    char * text = malloc(PHOTO_LENGTH * 2 + 256);
+    if(!CHECK(photo != NULL && text != NULL)){
+        free(photo);
+        free(text);
+        return;
+    }
+
+    size_t length = sprintf(text, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Photo\r\nPHOTO:");
+    int folds = 0;
+    for(size_t i = 0; i < PHOTO_LENGTH; i++){
+        photo[i] = alphabet[(i * 7 + i / 64) % 64];
+        text[length++] = photo[i];
+        if(i % 70 == 69){
+            memcpy(text + length, folds % 2 ? "\r\n\t" : "\r\n ", 3);
+            length += 3;
+            folds++;
+        }
+    }
+    photo[PHOTO_LENGTH] = '\0';
+    length += sprintf(text + length, "\r\nEND:VCARD\r\n");
+    CHECK(folds > 5000);
+
+    char * path = writeTestFile(dir, "photo.vcf", text, length);
+    Card * card = NULL;
+    if(CHECK(path != NULL) && CHECK(createCard(path, &card) == OK)){
+        const char * value = photoValue(card);
+        CHECK(value != NULL && strcmp(value, photo) == 0);
+    }
+    deleteCard(card);
+    free(path);
+
+    Card * pushed = NULL;
+    VCardPushParser * parser = createPushParser(NULL, &keepCard, &pushed);
+    if(CHECK(parser != NULL)){
+        size_t sent = 0;
+        bool ok = true;
+        for(size_t piece = 1; sent < length; piece = piece * 3 % 4093 + 1){
+            size_t size = length - sent < piece ? length - sent : piece;
+            ok = pushCardBytes(parser, text + sent, size) == OK && ok;
+            sent += size;
+        }
+        CHECK(ok && finishPushParser(parser) == OK);
+        const char * value = photoValue(pushed);
+        CHECK(value != NULL && strcmp(value, photo) == 0);
+    }
+    deleteCard(pushed);
+    deletePushParser(parser);
+
+    free(photo);
+    free(text);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("unfold");
+    if(!CHECK(dir != NULL)){
+        return finishTest("UnfoldTest");
+    }
+
+    testAppendBytes();
+    testLineJoining(dir);
+    testFoldedPhoto(dir);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("UnfoldTest");
+}
@@ -0,0 +1,188 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCParser.h"
+#include "VCWatch.h"
+#include "TestUtils.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//long enough for events to arrive on a loaded machine, and only ever waited out when a test fails
+#define WAIT_MS 2000
+
+static char * joinPath(const char * dir, const char * name){
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char * path = malloc(length);
+    if(path != NULL){
+        snprintf(path, length, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+static bool writeCardFile(const char * dir, const char * name, const char * fn){
+
+    char text[256];
+    if(fn != NULL){
+        snprintf(text, sizeof(text), "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:%s\r\nNOTE:watched\r\nBDAY:20000101\r\nEND:VCARD\r\n", fn);
+    } else {
+        snprintf(text, sizeof(text), "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:no name\r\nEND:VCARD\r\n");
+    }
+    char * path = writeTestFile(dir, name, text, strlen(text));
+    free(path);
+    return path != NULL;
+}
+
+//the one change the last update made, or false if it made any other number of them
+static bool onlyChange(const VCardWatcher * watcher, CardChangeKind kind, const char * fileName){
+    const CardChange * change = cardChangeAt(watcher, 0);
+    return cardChangeCount(watcher) == 1 && change != NULL && change->kind == kind && strcmp(change->fileName, fileName) == 0;
+}
+
+static const char * fnOf(const VCardWatcher * watcher, const char * fileName){
+    const WatchedCard * card = findWatchedCard(watcher, fileName);
+    return card != NULL ? card->fn : NULL;
+}
+
+//the first scan finds every card file, with invalid ones kept along with their error
+static void testFirstScan(const VCardWatcher * watcher){
+
+    CHECK(watchedCardCount(watcher) == 3);
+    CHECK(fnOf(watcher, "a.vcf") != NULL && strcmp(fnOf(watcher, "a.vcf"), "Alpha") == 0);
+    CHECK(fnOf(watcher, "b.vcard") != NULL && strcmp(fnOf(watcher, "b.vcard"), "Beta") == 0);
+    CHECK(findWatchedCard(watcher, "notes.txt") == NULL);
+
+    const WatchedCard * bad = findWatchedCard(watcher, "bad.vcf");
+    CHECK(bad != NULL && bad->error == INV_CARD && bad->fn == NULL && bad->birthday == NULL);
+
+    const WatchedCard * alpha = findWatchedCard(watcher, "a.vcf");
+    CHECK(alpha != NULL && alpha->error == OK && alpha->otherCount == 1 && alpha->birthday != NULL && alpha->anniversary == NULL);
+
+    int found = 0;
+    for(int i = 0; i < watchedCardCount(watcher); i++){
+        if(watchedCardAt(watcher, i) != NULL){
+            found++;
+        }
+    }
+    CHECK(found == 3 && watchedCardAt(watcher, 3) == NULL && watchedCardAt(watcher, -1) == NULL);
+}
+
+//each kind of change to the directory shows up once, and the index follows it
+static void testChanges(const char * dir, VCardWatcher * watcher){
+
+    CHECK(updateCardWatcher(watcher, 0) == 0);
+
+    //a new file, and the descriptor says so before the update does
+    CHECK(writeCardFile(dir, "c.vcf", "Gamma"));
+    struct pollfd waitFor = { cardWatcherFd(watcher), POLLIN, 0 };
+    CHECK(poll(&waitFor, 1, WAIT_MS) == 1);
+    CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_ADDED, "c.vcf"));
+    CHECK(fnOf(watcher, "c.vcf") != NULL && strcmp(fnOf(watcher, "c.vcf"), "Gamma") == 0);
+
+    //many writes to one file are one update
+    for(int i = 0; i < 5; i++){
+        char fn[32];
+        sprintf(fn, "Gamma %d", i);
+        CHECK(writeCardFile(dir, "c.vcf", fn));
+    }
+    CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_UPDATED, "c.vcf"));
+    CHECK(strcmp(fnOf(watcher, "c.vcf"), "Gamma 4") == 0);
+
+    //writing the same card again changes nothing
+    CHECK(writeCardFile(dir, "c.vcf", "Gamma 4"));
+    CHECK(updateCardWatcher(watcher, WAIT_MS) == 0 && cardChangeCount(watcher) == 0);
+
+    //an atomic replace is one update, and its temporary file never shows up
+    char * path = joinPath(dir, "a.vcf");
+    Card * card = NULL;
+    char * cPath = joinPath(dir, "c.vcf");
+    if(CHECK(path != NULL && cPath != NULL) && CHECK(createCard(cPath, &card) == OK)){
+        CHECK(writeCardAtomic(path, card) == OK);
+        CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_UPDATED, "a.vcf"));
+        CHECK(strcmp(fnOf(watcher, "a.vcf"), "Gamma 4") == 0 && watchedCardCount(watcher) == 4);
+    }
+    deleteCard(card);
+
+    //a file renamed away and one renamed in from a name that is not a card file
+    char * moved = joinPath(dir, "moved.txt");
+    if(CHECK(moved != NULL)){
+        CHECK(rename(cPath, moved) == 0);
+        CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_REMOVED, "c.vcf"));
+        CHECK(findWatchedCard(watcher, "c.vcf") == NULL && watchedCardCount(watcher) == 3);
+
+        char * back = joinPath(dir, "d.vcard");
+        CHECK(back != NULL && rename(moved, back) == 0);
+        CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_ADDED, "d.vcard"));
+        free(back);
+    }
+    free(moved);
+
+    //an invalid card made valid, and then deleted
+    CHECK(writeCardFile(dir, "bad.vcf", "Fixed"));
+    CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_UPDATED, "bad.vcf"));
+    const WatchedCard * fixed = findWatchedCard(watcher, "bad.vcf");
+    CHECK(fixed != NULL && fixed->error == OK && strcmp(fixed->fn, "Fixed") == 0);
+
+    char * badPath = joinPath(dir, "bad.vcf");
+    CHECK(badPath != NULL && unlink(badPath) == 0);
+    CHECK(updateCardWatcher(watcher, WAIT_MS) == 1 && onlyChange(watcher, CARD_REMOVED, "bad.vcf"));
+    free(badPath);
+
+    //files that are not cards are never indexed
+    free(writeTestFile(dir, "other.txt", "x", 1));
+    CHECK(updateCardWatcher(watcher, 50) == 0);
+
+    //several files at once
+    CHECK(writeCardFile(dir, "e.vcf", "Epsilon") && writeCardFile(dir, "f.vcf", "Phi"));
+    CHECK(unlink(path) == 0);
+    int changes = updateCardWatcher(watcher, WAIT_MS);
+    for(int tries = 0; changes >= 0 && changes < 3 && tries < 10; tries++){
+        int more = updateCardWatcher(watcher, 100);
+        changes = more < 0 ? more : changes + more;
+    }
+    CHECK(changes == 3);
+    CHECK(findWatchedCard(watcher, "a.vcf") == NULL && fnOf(watcher, "e.vcf") != NULL && fnOf(watcher, "f.vcf") != NULL);
+    CHECK(watchedCardCount(watcher) == 4);
+
+    free(path);
+    free(cPath);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("watch");
+    if(!CHECK(dir != NULL)){
+        return finishTest("WatchTest");
+    }
+
+    CHECK(writeCardFile(dir, "a.vcf", "Alpha"));
+    CHECK(writeCardFile(dir, "b.vcard", "Beta"));
+    CHECK(writeCardFile(dir, "bad.vcf", NULL));
+    free(writeTestFile(dir, "notes.txt", "not a card", 10));
+
+    VCardWatcher * watcher = createCardWatcher(dir, 2, NULL);
+    if(CHECK(watcher != NULL)){
+        CHECK(cardWatcherFd(watcher) >= 0);
+        testFirstScan(watcher);
+        testChanges(dir, watcher);
+    }
+
+    //a directory that goes away ends the watch
+    removeTestDir(dir);
+    if(watcher != NULL){
+        int result = 0;
+        for(int tries = 0; result >= 0 && tries < 10; tries++){
+            result = updateCardWatcher(watcher, 200);
+        }
+        CHECK(result == -1);
+    }
+    deleteCardWatcher(watcher);
+    deleteCardWatcher(NULL);
+
+    CHECK(createCardWatcher("missing-directory", 1, NULL) == NULL);
+    CHECK(findWatchedCard(NULL, "a.vcf") == NULL && watchedCardCount(NULL) == 0 && cardChangeAt(NULL, 0) == NULL);
+
+    free(dir);
+    return finishTest("WatchTest");
+}
@@ -0,0 +1,203 @@
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_COUNT 60
+
+//the wrapper has no header, since only bin/A3Main.py calls it, so its struct is mirrored here the same way
+#define CARD_FIELD_LENGTH 256
+
+typedef struct cardFields {
+    int error;
+    int otherCount;
+    int truncated;
+    char fn[CARD_FIELD_LENGTH];
+    char birthday[CARD_FIELD_LENGTH];
+    char anniversary[CARD_FIELD_LENGTH];
+} CardFields;
+
+int getCardFields(const char * fileName, CardFields * fields);
+int getCardFieldsBatch(const char * const * fileNames, int count, CardFields * fields, int threads);
+int updateCardBatch(const char * const * fileNames, const char * const * newFNs, int count, int * errors, int threads);
+int createNewCardBatch(const char * const * fileNames, const char * const * fnValues, int count, int * errors, int threads);
+
+//every third file has no FN, so it does not parse
+static void cardText(int i, char * text, size_t size){
+    if(i % 3 == 2){
+        snprintf(text, size, "BEGIN:VCARD\r\nVERSION:4.0\r\nNOTE:%d\r\nEND:VCARD\r\n", i);
+    } else {
+        snprintf(text, size, "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Card %d\r\nBDAY:2000%02d01\r\nNOTE:%d\r\nEND:VCARD\r\n", i, i % 12 + 1, i);
+    }
+}
+
+static char * joinPath(const char * dir, const char * name){
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char * path = malloc(length);
+    if(path != NULL){
+        snprintf(path, length, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+//each slot of the batch holds what a call for that file alone gives
+static void testFieldsBatch(char ** paths){
+
+    CardFields * batch = calloc(FILE_COUNT, sizeof(CardFields));
+    if(!CHECK(batch != NULL)){
+        return;
+    }
+
+    int expectedParsed = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        if(i % 3 != 2){
+            expectedParsed++;
+        }
+    }
+
+    const int threadCounts[] = { 1, 4, 0 };
+    for(int t = 0; t < 3; t++){
+        memset(batch, 'x', FILE_COUNT * sizeof(CardFields));
+        CHECK(getCardFieldsBatch((const char * const *)paths, FILE_COUNT, batch, threadCounts[t]) == expectedParsed);
+
+        int different = 0;
+        for(int i = 0; i < FILE_COUNT; i++){
+            CardFields single;
+            getCardFields(paths[i], &single);
+            if(memcmp(&single, &batch[i], sizeof(CardFields)) != 0){
+                different++;
+            }
+        }
+        CHECK(different == 0);
+    }
+    CHECK(strcmp(batch[0].fn, "Card 0") == 0 && batch[2].error == INV_CARD);
+
+    free(batch);
+}
+
+//updates and creates report each file on its own, and what they write reads back
+static void testUpdateAndCreate(const char * dir, char ** paths){
+
+    int errors[FILE_COUNT];
+    const char * names[FILE_COUNT];
+    char nameText[FILE_COUNT][32];
+    for(int i = 0; i < FILE_COUNT; i++){
+        sprintf(nameText[i], "Updated %d", i);
+        names[i] = nameText[i];
+    }
+
+    int expectedUpdated = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        if(i % 3 != 2){
+            expectedUpdated++;
+        }
+    }
+    CHECK(updateCardBatch((const char * const *)paths, names, FILE_COUNT, errors, 4) == expectedUpdated);
+
+    int wrong = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        CardFields fields;
+        getCardFields(paths[i], &fields);
+        if(i % 3 == 2){
+            wrong += errors[i] != INV_CARD;
+        } else {
+            wrong += errors[i] != OK || fields.error != OK || strcmp(fields.fn, names[i]) != 0;
+        }
+    }
+    CHECK(wrong == 0);
+
+    //new files are made, while names that are taken or not card files fail on their own
+    char * created[FILE_COUNT];
+    int made = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        char name[32];
+        if(i % 10 == 3){
+            created[i] = paths[i];
+            continue;
+        }
+        sprintf(name, i % 10 == 7 ? "new%d.txt" : "new%d.vcf", i);
+        created[i] = joinPath(dir, name);
+        if(created[i] != NULL){
+            made++;
+        }
+    }
+    CHECK(made == FILE_COUNT - FILE_COUNT / 10);
+
+    int expectedCreated = FILE_COUNT - 2 * (FILE_COUNT / 10);
+    CHECK(createNewCardBatch((const char * const *)created, names, FILE_COUNT, errors, 0) == expectedCreated);
+
+    wrong = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        CardFields fields;
+        getCardFields(created[i], &fields);
+        if(i % 10 == 3){
+            wrong += errors[i] != INV_FILE;
+        } else if(i % 10 == 7){
+            wrong += errors[i] != WRITE_ERROR;
+        } else {
+            wrong += errors[i] != OK || fields.error != OK || strcmp(fields.fn, names[i]) != 0;
+        }
+    }
+    CHECK(wrong == 0);
+
+    for(int i = 0; i < FILE_COUNT; i++){
+        if(i % 10 != 3){
+            free(created[i]);
+        }
+    }
+}
+
+static void testBadArguments(char ** paths){
+
+    CardFields fields;
+    int errors[1];
+    const char * names[] = { "Name" };
+
+    CHECK(getCardFieldsBatch(NULL, 1, &fields, 1) == -1);
+    CHECK(getCardFieldsBatch((const char * const *)paths, 1, NULL, 1) == -1);
+    CHECK(getCardFieldsBatch((const char * const *)paths, -1, &fields, 1) == -1);
+    CHECK(getCardFieldsBatch(NULL, 0, NULL, 1) == 0);
+
+    CHECK(updateCardBatch((const char * const *)paths, NULL, 1, errors, 1) == -1);
+    CHECK(updateCardBatch((const char * const *)paths, names, 1, NULL, 1) == -1);
+    CHECK(updateCardBatch(NULL, NULL, 0, NULL, 1) == 0);
+
+    CHECK(createNewCardBatch(NULL, names, 1, errors, 1) == -1);
+    CHECK(createNewCardBatch((const char * const *)paths, names, -2, errors, 1) == -1);
+    CHECK(createNewCardBatch(NULL, NULL, 0, NULL, 1) == 0);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("wrapperbatch");
+    if(!CHECK(dir != NULL)){
+        return finishTest("WrapperBatchTest");
+    }
+
+    char * paths[FILE_COUNT];
+    int written = 0;
+    for(int i = 0; i < FILE_COUNT; i++){
+        char name[32];
+        char text[256];
+        sprintf(name, "card%02d.vcf", i);
+        cardText(i, text, sizeof(text));
+        paths[i] = writeTestFile(dir, name, text, strlen(text));
+        if(paths[i] != NULL){
+            written++;
+        }
+    }
+
+    if(CHECK(written == FILE_COUNT)){
+        testFieldsBatch(paths);
+        testUpdateAndCreate(dir, paths);
+        testBadArguments(paths);
+    }
+
+    for(int i = 0; i < FILE_COUNT; i++){
+        free(paths[i]);
+    }
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("WrapperBatchTest");
+}
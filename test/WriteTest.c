@@ -0,0 +1,210 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "VCParser.h"
+#include "TestUtils.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define WRITER_COUNT 4
+#define WRITES_PER_THREAD 50
+
+static const char * cardText =
+    "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Written\r\nN:A;B;;;\r\nitem1.TEL;TYPE=cell:555\r\n"
+    "BDAY:19900101T101010\r\nANNIVERSARY:circa 2000\r\nEND:VCARD\r\n";
+
+static char * joinPath(const char * dir, const char * name){
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char * path = malloc(length);
+    if(path != NULL){
+        snprintf(path, length, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+//files in the directory other than the ones the test made on purpose
+static int countFiles(const char * dir){
+
+    DIR * handle = opendir(dir);
+    if(handle == NULL){
+        return -1;
+    }
+    int count = 0;
+    struct dirent * entry;
+    while((entry = readdir(handle)) != NULL){
+        if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0){
+            count++;
+        }
+    }
+    closedir(handle);
+    return count;
+}
+
+//what is written reads back as the same card, in place or atomically
+static void testRoundTrip(const char * dir, const Card * card){
+
+    const char * names[] = { "plain.vcf", "atomic.vcf" };
+    for(int atomic = 0; atomic < 2; atomic++){
+        char * path = joinPath(dir, names[atomic]);
+        if(!CHECK(path != NULL)){
+            continue;
+        }
+
+        CHECK((atomic ? writeCardAtomic(path, card) : writeCard(path, card)) == OK);
+        char * written = readTestFile(path, NULL);
+        CHECK(written != NULL && strcmp(written, cardText) == 0);
+        free(written);
+
+        Card * again = NULL;
+        CHECK(createCard(path, &again) == OK && validateCard(again) == OK);
+        if(again != NULL){
+            char * first = cardToString(card);
+            char * second = cardToString(again);
+            CHECK(first != NULL && second != NULL && strcmp(first, second) == 0);
+            free(first);
+            free(second);
+        }
+        deleteCard(again);
+        free(path);
+    }
+
+    //the source file and the two written ones, no temporary files
+    CHECK(countFiles(dir) == 3);
+}
+
+//a replaced file keeps its permissions and loses its old contents entirely
+static void testReplace(const char * dir, const Card * card){
+
+    char * path = joinPath(dir, "replace.vcf");
+    if(!CHECK(path != NULL)){
+        return;
+    }
+
+    size_t longLength = strlen(cardText) * 4;
+    char * longText = malloc(longLength);
+    if(CHECK(longText != NULL)){
+        memset(longText, 'x', longLength);
+        char * old = writeTestFile(dir, "replace.vcf", longText, longLength);
+        free(old);
+        free(longText);
+    }
+    CHECK(chmod(path, 0600) == 0);
+
+    CHECK(writeCardAtomic(path, card) == OK);
+    struct stat info;
+    CHECK(stat(path, &info) == 0 && (info.st_mode & 0777) == 0600);
+    CHECK(info.st_size == (off_t)strlen(cardText));
+
+    free(path);
+}
+
+//names that can not be written leave nothing behind
+static void testWriteErrors(const char * dir, const Card * card){
+
+    int before = countFiles(dir);
+
+    char * wrongExtension = joinPath(dir, "card.txt");
+    char * noDirectory = joinPath(dir, "missing/card.vcf");
+    if(CHECK(wrongExtension != NULL && noDirectory != NULL)){
+        CHECK(writeCard(wrongExtension, card) == WRITE_ERROR);
+        CHECK(writeCardAtomic(wrongExtension, card) == WRITE_ERROR);
+        CHECK(writeCard(noDirectory, card) == WRITE_ERROR);
+        CHECK(writeCardAtomic(noDirectory, card) == WRITE_ERROR);
+    }
+    CHECK(writeCard(NULL, card) == WRITE_ERROR);
+    CHECK(writeCardAtomic(NULL, card) == WRITE_ERROR);
+
+    char * path = joinPath(dir, "null.vcf");
+    if(CHECK(path != NULL)){
+        CHECK(writeCard(path, NULL) == WRITE_ERROR);
+        CHECK(writeCardAtomic(path, NULL) == WRITE_ERROR);
+    }
+
+    CHECK(countFiles(dir) == before);
+    free(wrongExtension);
+    free(noDirectory);
+    free(path);
+}
+
+typedef struct writer {
+    const char * path;
+    const Card * card;
+    int failures;
+} Writer;
+
+static void * writeOften(void * data){
+    Writer * writer = data;
+    for(int i = 0; i < WRITES_PER_THREAD; i++){
+        if(writeCardAtomic(writer->path, writer->card) != OK){
+            writer->failures++;
+        }
+    }
+    return NULL;
+}
+
+//threads replacing the same file at once each put a whole card there, and readers never see part of one
+static void testConcurrentReplace(const char * dir, const Card * card){
+
+    char * path = joinPath(dir, "shared.vcf");
+    if(!CHECK(path != NULL)){
+        return;
+    }
+    CHECK(writeCardAtomic(path, card) == OK);
+
+    Writer writers[WRITER_COUNT];
+    pthread_t threads[WRITER_COUNT];
+    int started = 0;
+    for(int i = 0; i < WRITER_COUNT; i++){
+        writers[i].path = path;
+        writers[i].card = card;
+        writers[i].failures = 0;
+        if(pthread_create(&threads[i], NULL, &writeOften, &writers[i]) == 0){
+            started++;
+        }
+    }
+    CHECK(started == WRITER_COUNT);
+
+    int partial = 0;
+    for(int i = 0; i < 100; i++){
+        char * text = readTestFile(path, NULL);
+        if(text == NULL || strcmp(text, cardText) != 0){
+            partial++;
+        }
+        free(text);
+    }
+
+    for(int i = 0; i < started; i++){
+        pthread_join(threads[i], NULL);
+        CHECK(writers[i].failures == 0);
+    }
+    CHECK(partial == 0);
+
+    free(path);
+}
+
+int main(void){
+
+    char * dir = makeTestDir("write");
+    if(!CHECK(dir != NULL)){
+        return finishTest("WriteTest");
+    }
+
+    char * source = writeTestFile(dir, "source.vcf", cardText, strlen(cardText));
+    Card * card = NULL;
+    if(CHECK(source != NULL) && CHECK(createCard(source, &card) == OK)){
+        testRoundTrip(dir, card);
+        testReplace(dir, card);
+        testWriteErrors(dir, card);
+        testConcurrentReplace(dir, card);
+        CHECK(countFiles(dir) == 5);
+    }
+    deleteCard(card);
+    free(source);
+
+    removeTestDir(dir);
+    free(dir);
+    return finishTest("WriteTest");
+}